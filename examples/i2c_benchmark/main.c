@@ -0,0 +1,142 @@
+/*
+ * Poll a Thermo3 Click in mikrobus 1 and a Proximity Click in mikrobus 2, and
+ * print the average time of each iteration and the syscalls saved by the slave
+ * address cache of the I2C bus.
+ *
+ * The Thermo3 Click driver uses i2c_write and i2c_read: without the cache,
+ * each of these transfers would be preceded by an I2C_SLAVE ioctl. The
+ * Proximity Click driver uses combined transfers (I2C_RDWR) which carry the
+ * slave address, so it never needs I2C_SLAVE. Polling both clicks checks that
+ * switching between buses does not invalidate the cache.
+ *
+ * This program counts the syscalls by wrapping ioctl, read and write.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <linux/i2c-dev.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <letmecreate/letmecreate.h>
+
+#define DEFAULT_ITERATION_CNT   (1000)
+#define MAX_FD                  (1024)
+
+static bool i2c_fds[MAX_FD];    /* Set for file descriptors used by an I2C bus */
+static unsigned long slave_ioctl_cnt = 0;
+static unsigned long rdwr_ioctl_cnt = 0;
+static unsigned long transfer_cnt = 0;
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    static int (*real_ioctl)(int, unsigned long, ...) = NULL;
+    va_list args;
+    void *arg;
+
+    va_start(args, request);
+    arg = va_arg(args, void *);
+    va_end(args);
+
+    if (real_ioctl == NULL)
+        real_ioctl = dlsym(RTLD_NEXT, "ioctl");
+
+    if (request == I2C_SLAVE || request == I2C_RDWR) {
+        if (fd >= 0 && fd < MAX_FD)
+            i2c_fds[fd] = true;
+        if (request == I2C_SLAVE)
+            ++slave_ioctl_cnt;
+        else
+            ++rdwr_ioctl_cnt;
+    }
+
+    return real_ioctl(fd, request, arg);
+}
+
+ssize_t read(int fd, void *buffer, size_t count)
+{
+    static ssize_t (*real_read)(int, void *, size_t) = NULL;
+
+    if (real_read == NULL)
+        real_read = dlsym(RTLD_NEXT, "read");
+
+    if (fd >= 0 && fd < MAX_FD && i2c_fds[fd])
+        ++transfer_cnt;
+
+    return real_read(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void *buffer, size_t count)
+{
+    static ssize_t (*real_write)(int, const void *, size_t) = NULL;
+
+    if (real_write == NULL)
+        real_write = dlsym(RTLD_NEXT, "write");
+
+    if (fd >= 0 && fd < MAX_FD && i2c_fds[fd])
+        ++transfer_cnt;
+
+    return real_write(fd, buffer, count);
+}
+
+static double get_time(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int i, iteration_cnt = DEFAULT_ITERATION_CNT;
+    float temperature = 0.f;
+    uint16_t measure = 0;
+    double start, duration;
+
+    if (argc > 1)
+        iteration_cnt = strtoul(argv[1], NULL, 10);
+    if (iteration_cnt == 0)
+        iteration_cnt = DEFAULT_ITERATION_CNT;
+
+    i2c_init();
+
+    i2c_select_bus(MIKROBUS_1);
+    thermo3_click_enable(0);
+    i2c_select_bus(MIKROBUS_2);
+    proximity_click_enable();
+
+    slave_ioctl_cnt = 0;
+    rdwr_ioctl_cnt = 0;
+    transfer_cnt = 0;
+
+    start = get_time();
+    for (i = 0; i < iteration_cnt; ++i) {
+        i2c_select_bus(MIKROBUS_1);
+        if (thermo3_click_get_temperature(&temperature) < 0)
+            break;
+
+        i2c_select_bus(MIKROBUS_2);
+        if (proximity_click_get_measure(&measure) < 0)
+            break;
+    }
+    duration = get_time() - start;
+
+    printf("%u iterations, %.1f us per iteration\n", i, i ? duration * 1000000. / i : 0.);
+    printf("temperature: %.3f°C, measure: %d\n", temperature, measure);
+    printf("read/write transfers: %lu, I2C_RDWR ioctls: %lu\n", transfer_cnt, rdwr_ioctl_cnt);
+    printf("I2C_SLAVE ioctls: %lu (%lu without the slave address cache)\n",
+           slave_ioctl_cnt, transfer_cnt);
+    printf("syscalls saved: %lu\n", transfer_cnt - slave_ioctl_cnt);
+
+    proximity_click_disable();
+    i2c_select_bus(MIKROBUS_1);
+    thermo3_click_disable();
+
+    i2c_release();
+
+    return 0;
+}
@@ -23,4 +23,14 @@
  */
 int air_quality_click_set_callback(uint8_t mikrobus_index, void(*callback)(uint8_t));
 
+/**
+ * @brief Give up the GPIO used by the air click.
+ *
+ * Callbacks attached with #air_quality_click_set_callback must be removed before.
+ *
+ * @param mikrobus_index Index of the mikrobus used by the click (see #MIKROBUS_INDEX)
+ * @return 0 if successful, -1 otherwise.
+ */
+int air_quality_click_release(uint8_t mikrobus_index);
+
 #endif
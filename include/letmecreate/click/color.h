@@ -4,6 +4,9 @@
  * @date 2016
  * @copyright 3-clause BSD
  *
+ * Functions taking a bus can be called from several threads. Other functions use the current I²C
+ * bus (see #i2c_select_bus).
+ *
  * @example color/main.c
  */
 
@@ -12,6 +15,35 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Enables color click in a mikrobus.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int color_click_bus_enable(uint8_t mikrobus_index);
+
+/**
+ * @brief Reads color measurement from sensor in a mikrobus.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @param[out] clear Light intensity
+ * @param[out] red Red light intensity
+ * @param[out] green Green light intensity
+ * @param[out] blue Blue light intensity
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int color_click_bus_get_color(uint8_t mikrobus_index,
+                              uint16_t *clear, uint16_t *red, uint16_t *green, uint16_t *blue);
+
+/**
+ * @brief Disables color click in a mikrobus.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int color_click_bus_disable(uint8_t mikrobus_index);
+
 /**
  * @brief Enables color click.
  *
@@ -9,10 +9,95 @@
 #define __LETMECREATE_CLICK_COMMON_H__
 
 #include <stdint.h>
+#include "letmecreate/core/i2c.h"
+
+/**
+ * @brief Write one byte value to a register of a device.
+ *
+ * Unlike #i2c_write_register, this function does not use the current bus, so it can be called
+ * from several threads (see #i2c_device_write).
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] reg_address Address of the register on the slave
+ * @param[in] value New value of the register
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_write_register(const struct i2c_device *device, uint8_t reg_address, uint8_t value);
+
+/**
+ * @brief Read a one-byte register from a device.
+ *
+ * The address of the register is sent and its value is read in a single transaction (see
+ * #i2c_transfer) on the bus of the device.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] reg_address Address of the register to read on the slave.
+ * @param[out] data Pointer to a 8-bit variable to store the value of the register read from the slave
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_read_register(const struct i2c_device *device, uint8_t reg_address, uint8_t *data);
+
+/**
+ * @brief Write several consecutive registers of a device.
+ *
+ * See #i2c_write_registers.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] start_reg_address Address of the first register to write on the slave
+ * @param[in] data Array of values to write (must not be null)
+ * @param[in] count Number of registers to write (must not be zero)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_write_registers(const struct i2c_device *device, uint8_t start_reg_address,
+                               const uint8_t *data, uint8_t count);
+
+/**
+ * @brief Read several consecutive registers of a device.
+ *
+ * See #i2c_read_registers.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] start_reg_address Address of the first register to read on the slave
+ * @param[out] data Array to store values of registers (must not be null)
+ * @param[in] count Number of registers to read (must not be zero)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_read_registers(const struct i2c_device *device, uint8_t start_reg_address,
+                              uint8_t *data, uint8_t count);
+
+/**
+ * @brief Read a 16bit register from a device.
+ *
+ * See #i2c_read_16b_register.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] reg_low_address Address of the lower half of the register on the slave
+ * @param[in] reg_high_address Address of the upper half of the register on the slave
+ * @param[out] data Pointer to a 16-bit variable to store the value of the register read from the slave
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_read_16b_register(const struct i2c_device *device, uint8_t reg_low_address,
+                                 uint8_t reg_high_address, uint16_t *data);
+
+/**
+ * @brief Read a 16bit register of a device in a single transaction.
+ *
+ * See #i2c_read_16b_register_burst.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] reg_low_address Address of the lower half of the register on the slave
+ * @param[in] reg_high_address Address of the upper half of the register on the slave
+ * @param[out] data Pointer to a 16-bit variable to store the value of the register read from the slave
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_device_read_16b_register_burst(const struct i2c_device *device, uint8_t reg_low_address,
+                                       uint8_t reg_high_address, uint16_t *data);
 
 /**
  * @brief Write one byte value to a register over I²C.
  *
+ * The register is written on the current bus (see #i2c_device_write_register).
+ *
  * @param[in] address Address (7 bits or 10 bits) of the slave
  * @param[in] reg_address Address of the register on the slave
  * @param[in] value New value of the register
@@ -23,6 +108,9 @@ int i2c_write_register(uint16_t address, uint8_t reg_address, uint8_t value);
 /**
  * @brief Read a one-byte register from a slave over I²C.
  *
+ * The address of the register is sent and its value is read in a single transaction (see
+ * #i2c_transfer), on the current bus (see #i2c_device_read_register).
+ *
  * @param[in] address Address (7 bits or 10 bits) of the slave
  * @param[in] reg_address Address of the register to read on the slave.
  * @param[out] data Pointer to a 8-bit variable to store the value of the register read from the slave
@@ -30,9 +118,40 @@ int i2c_write_register(uint16_t address, uint8_t reg_address, uint8_t value);
  */
 int i2c_read_register(uint16_t address, uint8_t reg_address, uint8_t *data);
 
+/**
+ * @brief Write several consecutive registers of a slave over I²C.
+ *
+ * The address of the first register is followed by all values in a single write, so the slave must
+ * increment its register address after each byte.
+ *
+ * @param[in] address Address (7 bits or 10 bits) of the slave
+ * @param[in] start_reg_address Address of the first register to write on the slave
+ * @param[in] data Array of values to write (must not be null)
+ * @param[in] count Number of registers to write (must not be zero)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_write_registers(uint16_t address, uint8_t start_reg_address, const uint8_t *data, uint8_t count);
+
+/**
+ * @brief Read several consecutive registers of a slave over I²C.
+ *
+ * All registers are read in a single transaction (see #i2c_transfer), on the current bus, so the
+ * slave must increment its register address after each byte.
+ *
+ * @param[in] address Address (7 bits or 10 bits) of the slave
+ * @param[in] start_reg_address Address of the first register to read on the slave
+ * @param[out] data Array to store values of registers (must not be null)
+ * @param[in] count Number of registers to read (must not be zero)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_read_registers(uint16_t address, uint8_t start_reg_address, uint8_t *data, uint8_t count);
+
 /**
  * @brief Read a 16bit register from a slave over I²C.
  *
+ * Each half is read in its own transaction, lower half first, on the current bus. To read both
+ * halves in a single transaction, see #i2c_read_16b_register_burst.
+ *
  * @param[in] address Address (7 bits or 10 bits) of the slave
  * @param[in] reg_low_address Address of the lower half of the register on the slave
  * @param[in] reg_high_address Address of the upper half of the register on the slave
@@ -41,6 +160,22 @@ int i2c_read_register(uint16_t address, uint8_t reg_address, uint8_t *data);
  */
 int i2c_read_16b_register(uint16_t address, uint8_t reg_low_address, uint8_t reg_high_address, uint16_t *data);
 
+/**
+ * @brief Read a 16bit register from a slave over I²C in a single transaction.
+ *
+ * Both halves must be at consecutive addresses, in any order. They are read in a row (see
+ * #i2c_read_registers), on the current bus, so that the value cannot change between the two
+ * halves. The slave must increment its register address after each byte.
+ *
+ * @param[in] address Address (7 bits or 10 bits) of the slave
+ * @param[in] reg_low_address Address of the lower half of the register on the slave
+ * @param[in] reg_high_address Address of the upper half of the register on the slave
+ * @param[out] data Pointer to a 16-bit variable to store the value of the register read from the slave
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int i2c_read_16b_register_burst(uint16_t address, uint8_t reg_low_address, uint8_t reg_high_address,
+                                uint16_t *data);
+
 /**
  * @brief Write one byte to a register over SPI.
  *
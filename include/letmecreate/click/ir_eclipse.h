@@ -15,4 +15,14 @@
  */
 int ir_eclipse_click_add_callback(uint8_t mikrobus_index, void (*callback)(uint8_t));
 
+/**
+ * @brief Give up the GPIO used by the IR Eclipse click.
+ *
+ * Callbacks attached with ir_eclipse_click_add_callback must be removed before.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus
+ * @return 0 if successful, -1 otherwise
+ */
+int ir_eclipse_click_release(uint8_t mikrobus_index);
+
 #endif
@@ -4,6 +4,9 @@
  * @date 2016
  * @copyright 3-clause BSD
  *
+ * Functions taking a bus can be called from several threads. Other functions use the current I²C
+ * bus (see #i2c_select_bus).
+ *
  * @example joystick/main.c
  */
 
@@ -12,6 +15,38 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Get the x coordinate of the joystick in a mikrobus
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @param[out] x Pointer to an 8-bit variable to retrieve the x
+ * coordinate of the click (must not be null)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int joystick_click_bus_get_x(uint8_t mikrobus_index, int8_t * x);
+
+/**
+ * @brief Get the y coordinate of the joystick in a mikrobus
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @param[out] y Pointer to an 8-bit variable to retrieve the y
+ * coordinate of the click (must not be null)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int joystick_click_bus_get_y(uint8_t mikrobus_index, int8_t * y);
+
+/**
+ * @brief Get the x and y coordinates of the joystick in a mikrobus
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @param[out] x Pointer to an 8-bit variable to retrieve the x
+ * coordinate of the click (must not be null)
+ * @param[out] y Pointer to an 8-bit variable to retrieve the y
+ * coordinate of the click (must not be null)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int joystick_click_bus_get_position(uint8_t mikrobus_index, int8_t * x, int8_t * y);
+
 /**
  * @brief Get the x coordinate of the joystick
  *
@@ -38,4 +38,14 @@ int motion_click_attach_callback(uint8_t mikrobus_index, void(*callback)(uint8_t
  */
 int motion_click_disable(uint8_t mikrobus_index);
 
+/**
+ * @brief Give up the GPIO's used by the Motion Click.
+ *
+ * Callbacks attached with #motion_click_attach_callback must be removed before.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus used by the click board (see #MIKROBUS_INDEX)
+ * @return 0 if successful, -1 otherwise
+ */
+int motion_click_release(uint8_t mikrobus_index);
+
 #endif
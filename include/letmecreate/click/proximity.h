@@ -4,6 +4,10 @@
  * @date 2016
  * @copyright 3-clause BSD
  *
+ * Functions taking a bus can be called from several threads, for instance to use one Proximity
+ * Click in each mikrobus at the same time. Other functions use the current I²C bus (see
+ * #i2c_select_bus).
+ *
  * @example proximity/main.c
  */
 
@@ -12,6 +16,33 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Enable the proximity click in a mikrobus.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int proximity_click_bus_enable(uint8_t mikrobus_index);
+
+/**
+ * @brief Get a measure from the proximity click in a mikrobus.
+ *
+ * The proximity click must be enabled before calling this function.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @param[out] measure Pointer to a 16-bit variable to retrieve the output from the click (must not be null)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int proximity_click_bus_get_measure(uint8_t mikrobus_index, uint16_t *measure);
+
+/**
+ * @brief Shutdown the proximity click in a mikrobus.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int proximity_click_bus_disable(uint8_t mikrobus_index);
+
 /**
  * @brief Enable the proximity click.
  *
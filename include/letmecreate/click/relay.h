@@ -31,4 +31,12 @@ int relay_click_enable_relay_1(uint8_t mikrobus_index);
  */
 int relay_click_disable_relay_1(uint8_t mikrobus_index);
 
+/**
+ * @brief Give up the GPIO used by Relay Click.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, -1 otherwise
+ */
+int relay_click_release(uint8_t mikrobus_index);
+
 #endif
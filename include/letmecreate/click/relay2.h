@@ -44,4 +44,12 @@ int relay2_click_enable_relay_2(uint8_t mikrobus_index);
  */
 int relay2_click_disable_relay_2(uint8_t mikrobus_index);
 
+/**
+ * @brief Give up the GPIO's used by Relay2 Click.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus (see #MIKROBUS_INDEX)
+ * @return 0 if successful, -1 otherwise
+ */
+int relay2_click_release(uint8_t mikrobus_index);
+
 #endif
@@ -49,4 +49,14 @@ int thermo3_click_set_alarm(uint8_t mikrobus_index, float threshold, void(*callb
  */
 int thermo3_click_disable(void);
 
+/**
+ * @brief Give up the alarm pin acquired by #thermo3_click_set_alarm.
+ *
+ * Callbacks attached with #thermo3_click_set_alarm must be removed before.
+ *
+ * @param[in] mikrobus_index Index of the mikrobus used by the click (see #MIKROBUS_INDEX)
+ * @return 0 if successful, otherwise it returns -1.
+ */
+int thermo3_click_release(uint8_t mikrobus_index);
+
 #endif
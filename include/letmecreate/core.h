@@ -10,7 +10,9 @@
 #define __LETMECREATE_CORE_H__
 
 #include "letmecreate/core/adc.h"
+#include "letmecreate/core/bitbang.h"
 #include "letmecreate/core/common.h"
+#include "letmecreate/core/event_loop.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/core/gpio_monitor.h"
 #include "letmecreate/core/i2c.h"
@@ -6,8 +6,8 @@
  */
 
 
-#ifndef __LETMECREATE_CORE_GPIO_H__
-#define __LETMECREATE_CORE_GPIO_H__
+#ifndef __LETMECREATE_CORE_ADC_H__
+#define __LETMECREATE_CORE_ADC_H__
 
 #include <stdint.h>
 
@@ -20,4 +20,32 @@
  */
 int adc_get_value(uint8_t mikrobus_index, float *value);
 
+/**
+ * @brief Read an ADC periodically.
+ *
+ * The callback is called from the event loop (see event_loop.h) with the reading of the ADC
+ * in Volt, every @p period milliseconds.
+ *
+ * @param[in] mikrobus_index Index of the ADC (see #MIKROBUS_INDEX)
+ * @param[in] period Time between two readings in milliseconds (must not be zero)
+ * @param[in] callback Function called with each reading (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int adc_start_sampling(uint8_t mikrobus_index, uint32_t period, void (*callback)(float value));
+
+/**
+ * @brief Stop reading an ADC periodically.
+ *
+ * @param[in] mikrobus_index Index of the ADC (see #MIKROBUS_INDEX)
+ * @return 0 if successful, -1 otherwise
+ */
+int adc_stop_sampling(uint8_t mikrobus_index);
+
+/**
+ * @brief Stop sampling and close file descriptors used to read ADC's.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int adc_release(void);
+
 #endif
@@ -0,0 +1,148 @@
+/**
+ * @file bitbang.h
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ *
+ * Software SPI, I²C and 1-Wire buses driven through GPIO's. It is meant for
+ * pins which are not connected to a hardware controller, such as GPIO_80 to
+ * GPIO_85 on the Raspberry Pi header.
+ *
+ * Each edge costs one access to the GPIO (one ioctl using the character
+ * device backend, one write using sysfs), so the actual speed of the bus is
+ * lower than the speed requested. 1-Wire timings cannot be met through sysfs,
+ * so the 1-Wire bus requires the character device backend (see #GPIO_BACKEND).
+ */
+
+
+#ifndef __LETMECREATE_CORE_BITBANG_H__
+#define __LETMECREATE_CORE_BITBANG_H__
+
+#include <stdint.h>
+
+/**
+ * @brief Initialise a software SPI bus.
+ *
+ * Pins are initialised as GPIO's and chip select is deselected (high). Words are 8-bit long and
+ * sent MSB first.
+ *
+ * @param[in] sck_pin Clock pin (see #GPIO_PIN)
+ * @param[in] mosi_pin Master output pin (see #GPIO_PIN)
+ * @param[in] miso_pin Master input pin (see #GPIO_PIN)
+ * @param[in] cs_pin Chip select pin, active low (see #GPIO_PIN)
+ * @param[in] mode Mode of the SPI bus (mode 0, 1, 2 or 3)
+ * @param[in] speed Speed of the clock in Hz (must not be zero)
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_spi_init(uint8_t sck_pin, uint8_t mosi_pin, uint8_t miso_pin, uint8_t cs_pin,
+                     uint32_t mode, uint32_t speed);
+
+/**
+ * @brief Make a transfer of bytes over the software SPI bus.
+ *
+ * Chip select is held low during the whole transfer. Either @p tx_buffer or @p rx_buffer can be
+ * set to NULL if no data has to be sent/received. Zeros are sent if @p tx_buffer is NULL.
+ *
+ * @param[in] tx_buffer Address of the array of bytes to send
+ * @param[out] rx_buffer Address of the array of bytes to receive from the bus
+ * @param[in] count Number of bytes to read or write
+ * @return @p count if successful, otherwise it returns -1.
+ */
+int bitbang_spi_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count);
+
+/**
+ * @brief Release pins of the software SPI bus.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_spi_release(void);
+
+/**
+ * @brief Initialise a software I²C bus.
+ *
+ * Outputs are emulated as open-drain: a line is driven low by configuring the GPIO as an output,
+ * and released by configuring it as an input. Both lines need a pull-up resistor. Clock
+ * stretching is supported.
+ *
+ * @param[in] sda_pin Data pin (see #GPIO_PIN)
+ * @param[in] scl_pin Clock pin (see #GPIO_PIN)
+ * @param[in] speed Speed of the clock in Hz (must not be zero)
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_i2c_init(uint8_t sda_pin, uint8_t scl_pin, uint32_t speed);
+
+/**
+ * @brief Send some data to a slave over the software I²C bus.
+ *
+ * @param[in] slave_address 7-bit address of the slave
+ * @param[in] buffer Array of bytes to send (must not be null)
+ * @param[in] count Number of bytes to send
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int bitbang_i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Read data from a slave over the software I²C bus.
+ *
+ * @param[in] slave_address 7-bit address of the slave
+ * @param[out] buffer Allocated memory where data is stored (must not be null)
+ * @param[in] count Number of bytes to read from slave
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int bitbang_i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Release pins of the software I²C bus.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_i2c_release(void);
+
+/**
+ * @brief Initialise a software 1-Wire bus.
+ *
+ * The line is emulated as open-drain and needs a pull-up resistor. Standard speed is used.
+ *
+ * GPIO's must be controlled through the character device backend (see #gpio_select_backend). The
+ * time of GPIO accesses is measured, and initialisation fails if any access takes more than 3us,
+ * which would break 1-Wire timings. Transfers fail if the thread is delayed past a deadline of a
+ * slot, so running it with a real-time policy is recommended.
+ *
+ * @param[in] pin Data pin (see #GPIO_PIN)
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_onewire_init(uint8_t pin);
+
+/**
+ * @brief Send a reset pulse on the 1-Wire bus.
+ *
+ * @return 1 if at least one device answered, 0 if no device is present, -1 if an error occurred
+ */
+int bitbang_onewire_reset(void);
+
+/**
+ * @brief Send bytes over the 1-Wire bus, LSB first.
+ *
+ * @param[in] buffer Array of bytes to send (must not be null)
+ * @param[in] count Number of bytes to send
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int bitbang_onewire_write(const uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Read bytes from the 1-Wire bus, LSB first.
+ *
+ * @param[out] buffer Allocated memory where data is stored (must not be null)
+ * @param[in] count Number of bytes to read
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int bitbang_onewire_read(uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Release the pin of the software 1-Wire bus.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int bitbang_onewire_release(void);
+
+#endif
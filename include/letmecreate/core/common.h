@@ -12,6 +12,8 @@
 #include <stdint.h>
 
 #define MAX_STR_LENGTH          (255)
+#define MAX_BATCH_WRITE_CNT     (32)
+#define MAX_BATCH_STR_LENGTH    (16)
 
 /** Index of Mikrobus interfaces */
 enum MIKROBUS_INDEX {
@@ -19,6 +21,35 @@ enum MIKROBUS_INDEX {
     MIKROBUS_2
 };
 
+/**
+ * @brief Set the directory prepended to the path of every device file.
+ *
+ * By default, the root is read from environment variable LETMECREATE_DEVICE_ROOT, or is empty if
+ * the variable is not set. This makes it possible to run the library against a fake tree of
+ * device files, for instance /tmp/ci40 containing /tmp/ci40/sys/class/gpio/export. It must be
+ * called before initialising any module, files already opened are not affected.
+ *
+ * @param[in] root Path to the root directory, null or empty string to use /
+ * @return 0 if successful, -1 otherwise
+ */
+int set_device_root(const char *root);
+
+/**
+ * @brief Get the directory prepended to the path of every device file.
+ *
+ * @return Path to the root directory, empty string if device files are accessed from /
+ */
+const char *get_device_root(void);
+
+/**
+ * @brief Build the path to a device file, prefixed with the device root.
+ *
+ * @param[out] path Buffer of MAX_STR_LENGTH characters (must not be null)
+ * @param[in] format printf-like format of the absolute path to the file (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int create_device_path(char *path, const char *format, ...);
+
 /**
  * @brief Write a string to a device file.
  *
@@ -56,6 +87,108 @@ int read_str_file(const char *path, char *str, uint32_t max_str_length);
  */
 int read_int_file(const char *path, uint32_t *value);
 
+/**
+ * @brief Open a device file and keep the file descriptor for later accesses.
+ *
+ * Device files opened with this function are meant to be accessed with write_str_fd,
+ * write_int_fd, read_str_fd and read_int_fd. These functions always access the file at offset 0
+ * so the same file descriptor can be reused for every operation, which saves an open and a close
+ * for each access. The caller is responsible for closing the file descriptor.
+ *
+ * @param[in] path Path to the file (must not be null)
+ * @param[in] flags Access mode of the file (O_RDONLY, O_WRONLY or O_RDWR)
+ * @return File descriptor if successful, -1 otherwise
+ */
+int open_device_file(const char *path, int flags);
+
+/**
+ * @brief Write a string to an opened device file.
+ *
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[in] str String to write (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int write_str_fd(int fd, const char *str);
+
+/**
+ * @brief Write an integer to an opened device file.
+ *
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[in] value Value to write
+ * @return 0 if successful, -1 otherwise
+ */
+int write_int_fd(int fd, uint32_t value);
+
+/**
+ * @brief Read a string from an opened device file.
+ *
+ * The string is always null-terminated.
+ *
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[out] str
+ * @param[in] max_str_length Size of @p str, including null character
+ * @return 0 if successful, -1 otherwise
+ */
+int read_str_fd(int fd, char *str, uint32_t max_str_length);
+
+/**
+ * @brief Read an integer from an opened device file.
+ *
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[out] value
+ * @return 0 if successful, -1 otherwise
+ */
+int read_int_fd(int fd, uint32_t *value);
+
+/** List of writes to opened device files, submitted at once by write_batch_submit */
+struct write_batch {
+    uint32_t cnt;                                       /**< Number of writes in the batch */
+    int fds[MAX_BATCH_WRITE_CNT];                       /**< File descriptor of each write */
+    char strs[MAX_BATCH_WRITE_CNT][MAX_BATCH_STR_LENGTH]; /**< String written by each write */
+};
+
+/**
+ * @brief Empty a batch of writes.
+ *
+ * @param[out] batch Batch to initialise (must not be null)
+ */
+void write_batch_init(struct write_batch *batch);
+
+/**
+ * @brief Add the write of a string to a batch.
+ *
+ * @param[in,out] batch Batch of writes (must not be null)
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[in] str String to write (must not be null, less than MAX_BATCH_STR_LENGTH characters)
+ * @return 0 if successful, -1 otherwise
+ */
+int write_batch_add_str(struct write_batch *batch, int fd, const char *str);
+
+/**
+ * @brief Add the write of an integer to a batch.
+ *
+ * @param[in,out] batch Batch of writes (must not be null)
+ * @param[in] fd File descriptor returned by open_device_file
+ * @param[in] value Value to write
+ * @return 0 if successful, -1 otherwise
+ */
+int write_batch_add_int(struct write_batch *batch, int fd, uint32_t value);
+
+/**
+ * @brief Perform all writes of a batch.
+ *
+ * Writes are performed in the order they were added, each one starting once the previous one
+ * completed. If a write fails, the following writes are not performed. When the kernel supports
+ * io_uring, all writes are submitted with a single syscall, otherwise they are performed one
+ * after the other using write_str_fd. Writes are never performed twice: if only some of them
+ * could be submitted to io_uring, the batch fails without performing the remaining ones. The
+ * batch is emptied, even if it fails.
+ *
+ * @param[in,out] batch Batch of writes (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int write_batch_submit(struct write_batch *batch);
+
 /**
  * @brief Export a pin.
  *
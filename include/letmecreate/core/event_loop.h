@@ -0,0 +1,178 @@
+/**
+ * @file event_loop.h
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ *
+ * Single event loop handling every asynchronous source of the library: GPIO monitor, switches,
+ * UART receive callbacks and periodic ADC sampling. By default, the loop runs on a thread of the
+ * library started by the first module which needs it. Alternatively, the application can run
+ * the loop itself by calling #letmecreate_poll, for instance from its own main loop.
+ *
+ * Handlers of all sources are called from the same thread, one at a time.
+ *
+ * Scheduling policy, CPU affinity and stack size of threads started by the library (event loop
+ * and workers of the GPIO monitor) can be configured before these threads start.
+ */
+
+
+#ifndef __LETMECREATE_CORE_EVENT_LOOP_H__
+#define __LETMECREATE_CORE_EVENT_LOOP_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+/** Thread running the event loop */
+enum EVENT_LOOP_MODE {
+    EVENT_LOOP_THREAD,      /**< Loop runs on a thread of the library (default) */
+    EVENT_LOOP_POLL         /**< Loop runs when the application calls #letmecreate_poll */
+};
+
+/** Scheduling policy of threads started by the library */
+enum THREAD_POLICY {
+    THREAD_POLICY_DEFAULT,  /**< SCHED_OTHER, or policy inherited from the creating thread */
+    THREAD_POLICY_FIFO,     /**< SCHED_FIFO */
+    THREAD_POLICY_RR        /**< SCHED_RR */
+};
+
+/**
+ * @brief Select which thread runs the event loop.
+ *
+ * This function must be called before initialising any module using the event loop.
+ *
+ * @param[in] mode Mode of the event loop (see #EVENT_LOOP_MODE)
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_select_mode(uint8_t mode);
+
+/**
+ * @brief Get the mode of the event loop.
+ *
+ * @return Mode of the event loop (see #EVENT_LOOP_MODE)
+ */
+uint8_t event_loop_get_mode(void);
+
+/**
+ * @brief Set scheduling policy and priority of threads started by the library.
+ *
+ * Real-time policies usually require CAP_SYS_NICE, otherwise starting threads fails. This function
+ * must be called before initialising any module using the event loop.
+ *
+ * @param[in] policy Scheduling policy (see #THREAD_POLICY)
+ * @param[in] priority Real-time priority, in range returned by sched_get_priority_min and
+ * sched_get_priority_max (ignored for THREAD_POLICY_DEFAULT)
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_set_thread_scheduling(uint8_t policy, uint8_t priority);
+
+/**
+ * @brief Set CPU's on which threads started by the library can run.
+ *
+ * This function must be called before initialising any module using the event loop.
+ *
+ * @param[in] cpu_mask Bit N set allows CPU N, 0 allows all CPU's (default)
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_set_thread_affinity(uint32_t cpu_mask);
+
+/**
+ * @brief Set stack size of threads started by the library.
+ *
+ * This function must be called before initialising any module using the event loop.
+ *
+ * @param[in] stack_size Size in bytes, at least PTHREAD_STACK_MIN, 0 to use the default size
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_set_thread_stack_size(uint32_t stack_size);
+
+/**
+ * @brief Lock all current and future pages of the process in memory.
+ *
+ * This prevents page faults from delaying handlers and callbacks. Stacks of threads are locked as
+ * well, so a small stack size should be set (see #event_loop_set_thread_stack_size).
+ *
+ * @param[in] enable 1 to lock memory, 0 to unlock it
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_lock_memory(uint8_t enable);
+
+/**
+ * @brief Start a thread with scheduling policy, CPU affinity and stack size of threads of the
+ * library.
+ *
+ * @param[out] thread Thread started (must not be null)
+ * @param[in] start_routine Function run by the thread (must not be null)
+ * @param[in] arg Argument given to @p start_routine
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_create_thread(pthread_t *thread, void *(*start_routine)(void *), void *arg);
+
+/**
+ * @brief Start the event loop, or take another reference on it.
+ *
+ * Modules call this function when they need the event loop. The loop is stopped when
+ * #event_loop_release has been called as many times as this function.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_init(void);
+
+/**
+ * @brief Wait for events on a file descriptor.
+ *
+ * The handler is called from the event loop as long as the file descriptor is ready (level
+ * triggered). The event loop must be initialised first.
+ *
+ * @param[in] fd File descriptor to wait on (must not be negative)
+ * @param[in] events Mask of epoll events (EPOLLIN, EPOLLPRI...)
+ * @param[in] handler Function called with the events which occurred and @p arg (must not be null)
+ * @param[in] arg Argument given to handler
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_add_fd(int fd, uint32_t events, void (*handler)(uint32_t events, void *arg), void *arg);
+
+/**
+ * @brief Stop waiting for events on a file descriptor.
+ *
+ * Unless it is called from a handler, the handler of @p fd is not running anymore when this
+ * function returns.
+ *
+ * @param[in] fd File descriptor given to #event_loop_add_fd
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_remove_fd(int fd);
+
+/**
+ * @brief Release a reference on the event loop, and stop it if it was the last one.
+ *
+ * The event loop cannot be stopped from a handler.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int event_loop_release(void);
+
+/**
+ * @brief Get the time at which the event loop woke up to handle the current batch of events.
+ *
+ * The clock is read as soon as the event loop stops waiting, before calling any handler. Handlers
+ * of sources which do not timestamp their events can use it as the closest time to the events.
+ * Time spent by the kernel to wake up the event loop is not included.
+ *
+ * @return Time in nanoseconds (CLOCK_MONOTONIC) if called from a handler, undefined otherwise
+ */
+uint64_t event_loop_get_wakeup_time(void);
+
+/**
+ * @brief Wait for events and call their handlers.
+ *
+ * The event loop must be in EVENT_LOOP_POLL mode and initialised. This function fails if it is
+ * called from a handler, or while another thread is polling: handlers are called from one thread
+ * at a time.
+ *
+ * @param[in] timeout Maximum time to wait in milliseconds, -1 to wait indefinitely, 0 to return
+ * immediately
+ * @return Number of events handled if successful, -1 otherwise
+ */
+int letmecreate_poll(int timeout);
+
+#endif
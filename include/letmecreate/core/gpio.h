@@ -47,17 +47,96 @@ enum GPIO_PIN {
     GPIO_85        = 85
 };
 
+/** Mask of GPIO's, used to access several GPIO's at once */
+enum GPIO_MASK {
+    GPIO_14_MASK        = 0x00001,
+    GPIO_21_MASK        = 0x00002,
+    GPIO_22_MASK        = 0x00004,
+    GPIO_23_MASK        = 0x00008,
+    GPIO_24_MASK        = 0x00010,
+    GPIO_25_MASK        = 0x00020,
+    GPIO_27_MASK        = 0x00040,
+    GPIO_31_MASK        = 0x00080,
+    GPIO_72_MASK        = 0x00100,
+    GPIO_73_MASK        = 0x00200,
+    GPIO_74_MASK        = 0x00400,
+    GPIO_75_MASK        = 0x00800,
+    GPIO_80_MASK        = 0x01000,
+    GPIO_81_MASK        = 0x02000,
+    GPIO_82_MASK        = 0x04000,
+    GPIO_83_MASK        = 0x08000,
+    GPIO_84_MASK        = 0x10000,
+    GPIO_85_MASK        = 0x20000,
+    GPIO_88_MASK        = 0x40000,
+    GPIO_89_MASK        = 0x80000,
+    ALL_GPIO_MASK       = 0xFFFFF,
+
+    MIKROBUS_1_AN_MASK  = GPIO_22_MASK,
+    MIKROBUS_1_RST_MASK = GPIO_23_MASK,
+    MIKROBUS_1_PWM_MASK = GPIO_73_MASK,
+    MIKROBUS_1_INT_MASK = GPIO_21_MASK,
+    MIKROBUS_1_MASK     = GPIO_21_MASK | GPIO_22_MASK | GPIO_23_MASK | GPIO_73_MASK,
+    MIKROBUS_2_AN_MASK  = GPIO_25_MASK,
+    MIKROBUS_2_RST_MASK = GPIO_27_MASK,
+    MIKROBUS_2_PWM_MASK = GPIO_74_MASK,
+    MIKROBUS_2_INT_MASK = GPIO_24_MASK,
+    MIKROBUS_2_MASK     = GPIO_24_MASK | GPIO_25_MASK | GPIO_27_MASK | GPIO_74_MASK
+};
+
 /** GPIO direction */
 enum GPIO_DIR {
     GPIO_OUTPUT,
     GPIO_INPUT
 };
 
+/** Interface used to control GPIO's */
+enum GPIO_BACKEND {
+    GPIO_BACKEND_SYSFS,
+    GPIO_BACKEND_CHARDEV
+};
+
+/** State of all GPIO's at a given time, bit N of each mask is GPIO N of #GPIO_MASK */
+struct gpio_snapshot {
+    uint32_t initialised;       /**< GPIO's initialised */
+    uint32_t outputs;           /**< Initialised GPIO's configured as outputs */
+    uint32_t values;            /**< State of initialised GPIO's, bit set means high */
+    uint64_t timestamp;         /**< Time of the snapshot in nanoseconds (CLOCK_MONOTONIC) */
+};
+
+/**
+ * @brief Select the interface used to control GPIO's.
+ *
+ * By default, GPIO's are controlled through /sys/class/gpio, unless the library was built with
+ * option GPIO_CHARDEV. The default can also be overridden by setting environment variable
+ * LETMECREATE_GPIO_BACKEND to "sysfs" or "chardev".
+ *
+ * The character device backend requests lines through /dev/gpiochipN (Linux 5.10 or later) and
+ * is only available if the kernel headers used to build the library support it. GPIO's
+ * controlled through this backend are not exported in /sys/class/gpio, hence they cannot be
+ * monitored using gpio_monitor.
+ *
+ * The backend cannot be changed while some GPIO's are initialised through the character device.
+ *
+ * @param[in] backend Interface to use (see #GPIO_BACKEND)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_select_backend(uint8_t backend);
+
+/**
+ * @brief Get the interface used to control GPIO's.
+ *
+ * @return Current backend (see #GPIO_BACKEND)
+ */
+uint8_t gpio_get_backend(void);
+
 /**
  * @brief Initialise a GPIO.
  *
  * Export a GPIO if needed and configure it as an input
  *
+ * The library keeps track of the direction of GPIO's it initialised, so they must not be
+ * reconfigured or unexported by another process until gpio_release is called.
+ *
  * @param[in] gpio_pin Index of the GPIO
  * @return 0 if successful, -1 otherwise
  */
@@ -101,14 +180,81 @@ int gpio_set_value(uint8_t gpio_pin, uint8_t value);
  */
 int gpio_get_value(uint8_t gpio_pin, uint8_t *value);
 
+/**
+ * @brief Set the output state of several GPIO's.
+ *
+ * All GPIO's in @p mask must be initialised and configured as outputs, otherwise no output is
+ * changed. Using the character device backend, outputs requested together change simultaneously
+ * (one ioctl per line request). GPIO's of a gpiochip are requested together if they are all
+ * initialised before any of them is configured as an output, otherwise a GPIO initialised after an
+ * output of its gpiochip gets a request of its own, so that outputs are never released while they
+ * are driven. Using sysfs, outputs are changed one after the other.
+ *
+ * @param[in] mask GPIO's to change (see #GPIO_MASK)
+ * @param[in] values New state of GPIO's, bit set means high (see #GPIO_MASK)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_set_values(uint32_t mask, uint32_t values);
+
+/**
+ * @brief Get the state of several GPIO's.
+ *
+ * All GPIO's in @p mask must be initialised. Bits of @p values which are not in @p mask are
+ * cleared.
+ *
+ * @param[in] mask GPIO's to read (see #GPIO_MASK)
+ * @param[out] values State of GPIO's, bit set means high (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_get_values(uint32_t mask, uint32_t *values);
+
+/**
+ * @brief Read the state of all GPIO's at once.
+ *
+ * Only GPIO's known to the library are reported: GPIO's initialised by this process, or exported
+ * before and already accessed through this library. Directions are cached by the library, so only
+ * values are read (one ioctl per line request using the character device backend, one read per
+ * GPIO using sysfs).
+ *
+ * @param[out] snapshot State of GPIO's (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_snapshot(struct gpio_snapshot *snapshot);
+
 /**
  * @brief Release a GPIO.
  *
- * Unexport a GPIO if needed.
+ * Unexport a GPIO if needed. It fails if the GPIO is acquired (see gpio_acquire). Using the
+ * character device backend, a GPIO requested together with outputs still in use is configured as
+ * an input and stays requested by the library until these outputs are released.
  *
  * @param gpio_pin Index of the GPIO
  * @return 0 if successful, -1 otherwise
  */
 int gpio_release(uint8_t gpio_pin);
 
+/**
+ * @brief Acquire a GPIO configured in a given direction.
+ *
+ * GPIO's shared by several drivers (clicks for instance) should be acquired instead of initialised.
+ * The first call initialises the GPIO and configures its direction. Following calls with the same
+ * direction only increment a counter, without accessing the GPIO. Acquiring a GPIO in another
+ * direction than the current owners fails.
+ *
+ * @param[in] gpio_pin Index of the GPIO
+ * @param[in] dir Direction of the gpio (must be GPIO_OUTPUT or GPIO_INPUT)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_acquire(uint8_t gpio_pin, uint8_t dir);
+
+/**
+ * @brief Give up a GPIO acquired with gpio_acquire.
+ *
+ * The GPIO is released when its last owner gives it up.
+ *
+ * @param[in] gpio_pin Index of the GPIO
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_relinquish(uint8_t gpio_pin);
+
 #endif
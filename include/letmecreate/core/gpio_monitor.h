@@ -3,6 +3,18 @@
  * @author Francois Berder
  * @date 2016
  * @copyright 3-clause BSD
+ *
+ * Edges are detected through sysfs: the kernel notifies the event loop that the level changed,
+ * and the event loop reads the new level. Edges occurring before the event loop read the level
+ * are merged into one notification, so edges closer than the time needed to handle a
+ * notification are lost: sysfs does not allow capturing edges without loss. When the level did
+ * not change since the previous notification, two edges are inferred: they are reported with the
+ * same timestamp and flagged as inferred (see #gpio_event and #gpio_monitor_get_stats). More edges
+ * may have been merged, and three edges merged into one notification cannot be told from a single
+ * edge.
+ *
+ * The monitor only uses sysfs: GPIO's initialised through the character device backend (see
+ * #gpio_select_backend) cannot be monitored.
  */
 
 
@@ -19,9 +31,52 @@ enum GPIO_EVENT {
     GPIO_EDGE      = 0x03
 };
 
+/** Edge recorded by the event loop */
+struct gpio_event {
+    uint8_t gpio_pin;       /**< GPIO which changed (see #GPIO_PIN) */
+    uint8_t type;           /**< GPIO_RAISING or GPIO_FALLING */
+    uint8_t inferred;       /**< 1 if the edge was not seen but inferred, because the level did
+                                 not change after a notification, 0 otherwise */
+    uint64_t timestamp;     /**< Time at which the event loop woke up to handle the edge in
+                                 nanoseconds (CLOCK_MONOTONIC), not the time of the edge itself */
+};
+
+/** Dispatch latency of callbacks in nanoseconds (see #gpio_monitor_get_dispatch_latency) */
+struct gpio_monitor_latency {
+    uint64_t count;         /**< Number of callback calls measured */
+    uint64_t min;           /**< Shortest latency */
+    uint64_t avg;           /**< Average latency */
+    uint64_t p99;           /**< 99th percentile, rounded up by less than 7% */
+    uint64_t max;           /**< Longest latency */
+};
+
+/** Edges inferred or dropped since #gpio_monitor_init (see #gpio_monitor_get_stats) */
+struct gpio_monitor_stats {
+    uint32_t inferred_cnt;      /**< Edges reported without being seen (see #gpio_event) */
+    uint32_t ring_drop_cnt;     /**< Edges not recorded because the buffer read by
+                                     #gpio_monitor_read_events was full */
+    uint32_t queue_drop_cnt;    /**< Edges not given to callbacks because the queue of a worker
+                                     was full */
+};
+
 
 /**
- * @brief Initialise variables and start monitoring thread.
+ * @brief Run callbacks on a pool of worker threads instead of the event loop.
+ *
+ * The event loop then only records edges and queues them to workers, so slow callbacks
+ * do not delay the detection of edges. Edges of a GPIO are always handled by the same worker,
+ * in order. Each worker queues up to 64 edges, further edges are not given to callbacks and are
+ * counted (see #gpio_monitor_get_stats). By default, no worker is used.
+ *
+ * This function must be called before #gpio_monitor_init.
+ *
+ * @param[in] count Number of worker threads (0 to 8), 0 to call callbacks from the event loop
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_monitor_set_worker_count(uint8_t count);
+
+/**
+ * @brief Initialise variables and start handling GPIO events in the event loop.
  *
  * This function must be called before adding/removing callbacks.
  *
@@ -32,6 +87,10 @@ int gpio_monitor_init(void);
 /**
  * @brief Attach a callback to a GPIO.
  *
+ * Callbacks are called from the event loop, or from a worker thread (see
+ * #gpio_monitor_set_worker_count). This function can be called from any thread, including from a
+ * callback. It fails if the GPIO is initialised through the character device backend.
+ *
  * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
  * @param[in] event_mask Events which trigger callback (see #GPIO_EVENT)
  * @param[in] callback Function to call (uint8_t argument is the event type)
@@ -39,16 +98,152 @@ int gpio_monitor_init(void);
  */
 int gpio_monitor_add_callback(uint8_t gpio_pin, uint8_t event_mask, void(*callback)(uint8_t));
 
+/**
+ * @brief Attach a callback to a GPIO, filtering bounces and glitches.
+ *
+ * Edges are filtered by the event loop. A change of level is reported once the GPIO
+ * stayed at this level for @p stable_time, and at least @p window after the previous change
+ * reported to this callback. Pulses shorter than @p stable_time are ignored. Events recorded for
+ * #gpio_monitor_read_events are not filtered.
+ *
+ * This function can be called from any thread, including from a callback.
+ *
+ * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
+ * @param[in] event_mask Events which trigger callback (see #GPIO_EVENT)
+ * @param[in] window Minimum time between two calls in milliseconds
+ * @param[in] stable_time Time the level must remain stable before being reported in milliseconds
+ * @param[in] callback Function to call (uint8_t argument is the event type)
+ * @return ID of the callback (non-negative integer) if successful, -1 otherwise
+ */
+int gpio_monitor_add_debounced_callback(uint8_t gpio_pin, uint8_t event_mask,
+                                        uint32_t window, uint32_t stable_time,
+                                        void(*callback)(uint8_t));
+
 /**
  * @brief Detach a callback from a GPIO
  *
+ * This function can be called from any thread, including from a callback. Unless it is called
+ * from a callback, the callback is not running anymore when this function returns.
+ *
  * @param[in] callback_ID ID of the callback (must not be negative)
  * @return 0 if successful, -1 otherwise
  */
 int gpio_monitor_remove_callback(int callback_ID);
 
 /**
- * @brief Remove all callbacks and stop monitoring thread.
+ * @brief Read edges recorded by the event loop, oldest first.
+ *
+ * Every edge of a GPIO which has at least one callback attached is recorded, whatever the
+ * event mask of its callbacks. Up to 256 edges are kept, newer edges are dropped and counted
+ * when the buffer is full (see #gpio_monitor_get_stats). Edges are still available
+ * after #gpio_monitor_release and are discarded by #gpio_monitor_init. This function must not
+ * be called from several threads at the same time.
+ *
+ * @param[out] events Array where edges are stored (must not be null)
+ * @param[in] count Maximum number of edges to read
+ * @return Number of edges read if successful, -1 otherwise
+ */
+int gpio_monitor_read_events(struct gpio_event *events, uint32_t count);
+
+/**
+ * @brief Get the number of edges dropped since #gpio_monitor_init.
+ *
+ * Edges are dropped when the buffer read by #gpio_monitor_read_events is full, or when the queue
+ * of a worker is full (see #gpio_monitor_set_worker_count). Inferred edges are not counted, see
+ * #gpio_monitor_get_stats to tell both apart.
+ *
+ * @param[out] count Number of dropped edges (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_monitor_get_overflow_count(uint32_t *count);
+
+/**
+ * @brief Get the number of edges inferred and dropped since #gpio_monitor_init.
+ *
+ * Edges merged by sysfs without changing the level are inferred, other merged edges are lost
+ * without being counted.
+ *
+ * @param[out] stats Counters of inferred and dropped edges (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_monitor_get_stats(struct gpio_monitor_stats *stats);
+
+/**
+ * @brief Start counting edges of a GPIO.
+ *
+ * Edges are counted by the event loop without calling any callback. Callbacks can still
+ * be attached to the GPIO. Edges are detected through sysfs notifications, so edges closer than
+ * the latency of the event loop may not be counted.
+ *
+ * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
+ * @param[in] event_mask Edges to count (see #GPIO_EVENT)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_counter_start(uint8_t gpio_pin, uint8_t event_mask);
+
+/**
+ * @brief Read the counter of a GPIO.
+ *
+ * The period is the average time between counted edges, measured over the last 8 batches of
+ * edges handled by the event loop. If no edge occurred for longer than this average, the
+ * time since the last edge is returned instead, so that the period grows when the signal stops.
+ *
+ * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
+ * @param[out] count Number of edges counted since #gpio_counter_start (must not be null)
+ * @param[out] period Period of the signal in nanoseconds, 0 if not enough edges were counted
+ * (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_counter_read(uint8_t gpio_pin, uint64_t *count, uint64_t *period);
+
+/**
+ * @brief Get the frequency of edges counted on a GPIO.
+ *
+ * The frequency is computed from the period returned by #gpio_counter_read.
+ *
+ * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
+ * @param[out] frequency Frequency of counted edges in Hz, 0 if unknown (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_counter_get_frequency(uint8_t gpio_pin, float *frequency);
+
+/**
+ * @brief Stop counting edges of a GPIO.
+ *
+ * @param[in] gpio_pin GPIO to monitor (see #GPIO_PIN)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_counter_stop(uint8_t gpio_pin);
+
+/**
+ * @brief Get dispatch latency of callbacks since #gpio_monitor_init or
+ * #gpio_monitor_reset_dispatch_latency.
+ *
+ * This is not the latency from the interrupt to the callback. Edges are detected through sysfs,
+ * which does not timestamp them, so latency is measured from the time at which the event loop
+ * woke up (see #event_loop_get_wakeup_time) to the call of each callback. It shows delays added
+ * by other handlers of the event loop, workers and other callbacks. The time taken by the kernel
+ * to wake up the event loop after an edge, which real-time scheduling reduces, is not included.
+ *
+ * For debounced callbacks, latency is measured from the deadline at which the level became stable
+ * long enough. The event loop is woken up by a timer at this deadline, so the time taken by the
+ * kernel to wake up the event loop is included. Debounced callbacks can be used to check the
+ * effect of thread attributes (see #event_loop_set_thread_scheduling).
+ *
+ * @param[out] report Dispatch latency of callbacks called so far (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_monitor_get_dispatch_latency(struct gpio_monitor_latency *report);
+
+/**
+ * @brief Discard dispatch latency measured so far.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int gpio_monitor_reset_dispatch_latency(void);
+
+/**
+ * @brief Remove all callbacks and stop handling GPIO events.
  *
  * @return 0 if successful, -1 otherwise
  */
@@ -3,6 +3,10 @@
  * @author Francois Berder
  * @date 2016
  * @copyright 3-clause BSD
+ *
+ * Functions taking a bus or a device (see #i2c_device) can be called from several threads: each
+ * bus is locked during a transfer, so both buses can be used at the same time. Other functions use
+ * the bus selected by #i2c_select_bus, which is shared by all threads.
  */
 
 #ifndef __LETMECREATE_CORE_I2C_H__
@@ -10,6 +14,21 @@
 
 #include <stdint.h>
 
+/** Slave on an I²C bus */
+struct i2c_device {
+    uint8_t mikrobus_index;     /**< Index of the bus (see #MIKROBUS_INDEX) */
+    uint16_t slave_address;     /**< Address (7-bit or 10-bit) of the slave */
+};
+
+/** Part of an I²C transaction, see #i2c_transfer */
+struct i2c_message {
+    uint16_t slave_address;     /**< Address of the slave, 7-bit unless ten_bit_address is set */
+    uint8_t read;               /**< 1 to read data from the slave, 0 to send data */
+    uint8_t *buffer;            /**< Data to send, or memory where data read is stored */
+    uint32_t count;             /**< Number of bytes to send or to read (at most 65535) */
+    uint8_t ten_bit_address;    /**< 1 if slave_address is a 10-bit address, 0 otherwise */
+};
+
 /**
  * @brief Initialise all I²C bus.
  *
@@ -37,11 +56,37 @@ void i2c_select_bus(uint8_t mikrobus_index);
  */
 uint8_t i2c_get_current_bus(void);
 
+/**
+ * @brief Send some data to a device.
+ *
+ * The buffer must be non-null and the bus of the device must be initialised before calling this
+ * function.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[in] buffer Array of bytes to send
+ * @param[in] count Number of bytes to send
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int i2c_device_write(const struct i2c_device *device, const uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Read data from a device.
+ *
+ * The buffer must be non-null and the bus of the device must be initialised before calling this
+ * function.
+ *
+ * @param[in] device Bus and address of the slave (must not be null)
+ * @param[out] buffer Allocated memory where data is stored (must be non-null)
+ * @param[in] count Number of bytes to read from slave
+ * @return Returns @p count if successful, otherwise it returns -1.
+ */
+int i2c_device_read(const struct i2c_device *device, uint8_t *buffer, uint32_t count);
+
 /**
  * @brief Send some data to a slave.
  *
- * This sends some data to the slave. The buffer must be non-null and the current bus selected must
- * be initialised before calling this function.
+ * This sends some data to the slave on the current bus (see #i2c_device_write). The buffer must be
+ * non-null and the current bus selected must be initialised before calling this function.
  *
  * @param[in] slave_address Address (7-bit or 10-bit) of the slave
  * @param[in] buffer Array of bytes to send
@@ -53,8 +98,9 @@ int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count);
 /**
  * @brief Read data from a slave.
  *
- * This function sends some data to the slave. The buffer must be non-null and the current bus
- * selected must be initialised before calling this function.
+ * This function reads some data from the slave on the current bus (see #i2c_device_read). The
+ * buffer must be non-null and the current bus selected must be initialised before calling this
+ * function.
  *
  * @param[in] slave_address Address (7-bit or 10-bit) of the slave to read from
  * @param[out] buffer Allocated memory where data is stored (must be non-null)
@@ -63,6 +109,24 @@ int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count);
  */
 int i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count);
 
+/**
+ * @brief Send and receive several messages in a single transaction.
+ *
+ * Messages are separated by a repeated start condition instead of a stop condition, so that no
+ * other master can use the bus between them. For instance, a register is read with a message
+ * writing its address followed by a message reading its value. All messages are given to the
+ * kernel in a single ioctl.
+ *
+ * Messages are rejected if they are longer than 65535 bytes, or if their address does not fit in
+ * 7 bits, or 10 bits when ten_bit_address is set (see #i2c_message).
+ *
+ * @param[in] mikrobus_index Index of the bus (see #MIKROBUS_INDEX), must be initialised
+ * @param[in] messages Array of messages (must not be null)
+ * @param[in] count Number of messages (at most 42)
+ * @return 0 if successful, -1 otherwise
+ */
+int i2c_transfer(uint8_t mikrobus_index, const struct i2c_message *messages, uint32_t count);
+
 /**
  * @brief Send one byte to a slave.
  *
@@ -3,6 +3,10 @@
  * @author Francois Berder
  * @date 2016
  * @copyright 3-clause BSD
+ *
+ * Functions taking a bus can be called from several threads: each bus is locked during a transfer,
+ * so both buses can be used at the same time. Other functions use the bus selected by
+ * #spi_select_bus, which is shared by all threads.
  */
 
 
@@ -75,12 +79,26 @@ void spi_select_bus(uint8_t mikrobus_index);
  */
 uint8_t spi_get_current_bus(void);
 
+/**
+ * @brief Make a transfer of bytes over an SPI bus.
+ *
+ * @p tx_buffer and @p rx_buffer can be set to NULL if no data has to be sent/received. The bus must
+ * be initialised before calling this function.
+ *
+ * @param[in] mikrobus_index Index of the bus (see #MIKROBUS_INDEX)
+ * @param[in] tx_buffer Address of the array of bytes to send
+ * @param[out] rx_buffer Address of the array of bytes to receive from the bus
+ * @param[in] count Number of bytes to read or write from the bus.
+ * @return 0 if successful, -1 otherwise
+ */
+int spi_bus_transfer(uint8_t mikrobus_index, const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count);
+
 /**
  * @brief Make a transfer of bytes over SPI.
  *
- * Make a transfer using the currently selected bus. @p tx_buffer and @p rx_buffer can be set to
- * NULL if no data has to be sent/received. The bus must be initialised before calling this
- * function.
+ * Make a transfer using the currently selected bus (see #spi_bus_transfer). @p tx_buffer and
+ * @p rx_buffer can be set to NULL if no data has to be sent/received. The bus must be initialised
+ * before calling this function.
  *
  * @param[in] tx_buffer Address of the array of bytes to send
  * @param[out] rx_buffer Address of the array of bytes to receive from the bus
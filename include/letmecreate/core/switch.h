@@ -20,8 +20,26 @@ enum SWITCH_EVENT {
     SWITCH_ALL_EVENTS   = 0x0F
 };
 
+/** Index of switches */
+enum SWITCH_INDEX {
+    SWITCH_1,
+    SWITCH_2
+};
+
+/** Gestures recognised on each switch */
+enum SWITCH_GESTURE {
+    SWITCH_CLICK        = 0x01,     /**< Pressed and released once */
+    SWITCH_DOUBLE_CLICK = 0x02,     /**< Clicked twice */
+    SWITCH_MULTI_CLICK  = 0x04,     /**< Clicked three times or more */
+    SWITCH_LONG_PRESS   = 0x08,     /**< Held longer than long press time */
+    SWITCH_HOLD_REPEAT  = 0x10,     /**< Held longer than repeat delay, then every repeat period */
+    SWITCH_ALL_GESTURES = 0x1F
+};
+
 /**
- * @brief Start a thread monitoring switch events
+ * @brief Start monitoring switch events
+ *
+ * Callbacks are called from the event loop (see event_loop.h).
  *
  * @return 0 if successful, -1 otherwise.
  */
@@ -36,16 +54,83 @@ int switch_init(void);
  */
 int switch_add_callback(uint8_t event_mask, void (*callback)(void));
 
+/**
+ * @brief Attach a callback to switch events, receiving the time of each event
+ *
+ * The timestamp is set by the kernel when the switch changed, in nanoseconds (CLOCK_MONOTONIC,
+ * CLOCK_REALTIME before Linux 3.4).
+ *
+ * @param[in] event_mask Events which will trigger a call to callback function
+ * @param[in] callback Function called with the event (see #SWITCH_EVENT) and its timestamp (must
+ * not be null)
+ * @return ID of the callback, -1 if it fails.
+ */
+int switch_add_timestamped_callback(uint8_t event_mask, void (*callback)(uint8_t event, uint64_t timestamp));
+
+/**
+ * @brief Set timing of gestures of both switches.
+ *
+ * Default timing is 300ms for multi-clicks, 800ms for long presses, and 500ms delay then 100ms
+ * period for hold-repeat.
+ *
+ * @param[in] multi_click_time Maximum time between a release and the next press of a series of
+ * clicks in milliseconds (must not be zero)
+ * @param[in] long_press_time Time a switch must be held to report a long press in milliseconds
+ * (must not be zero)
+ * @param[in] repeat_delay Time a switch must be held before the first repetition in milliseconds
+ * (must not be zero)
+ * @param[in] repeat_period Time between two repetitions in milliseconds (must not be zero)
+ * @return 0 if successful, -1 otherwise
+ */
+int switch_set_gesture_timing(uint32_t multi_click_time, uint32_t long_press_time,
+                              uint32_t repeat_delay, uint32_t repeat_period);
+
+/**
+ * @brief Attach a callback to gestures of a switch
+ *
+ * Gestures are recognised in the event loop (see event_loop.h) using a single timer. A series of
+ * clicks is reported once no click followed for the multi-click time, as SWITCH_CLICK,
+ * SWITCH_DOUBLE_CLICK or SWITCH_MULTI_CLICK. If no callback of the switch waits for double or
+ * multi-clicks, SWITCH_CLICK is reported on release without delay. Releasing a switch after a
+ * long press or repetitions is not a click.
+ *
+ * @param[in] switch_index Index of the switch (see #SWITCH_INDEX)
+ * @param[in] gesture_mask Gestures which will trigger a call to callback function (see
+ * #SWITCH_GESTURE)
+ * @param[in] callback Function called with the switch index, the gesture and a count: number of
+ * clicks, number of repetitions since the switch was pressed, or 1 for a long press (must not be
+ * null)
+ * @return ID of the callback, -1 if it fails.
+ */
+int switch_add_gesture_callback(uint8_t switch_index, uint8_t gesture_mask,
+                                void (*callback)(uint8_t switch_index, uint8_t gesture, uint32_t count));
+
 /**
  * @brief Remove a callback
  *
+ * Callbacks can add or remove callbacks. A callback removed while the event loop handles an event
+ * or a gesture may still be called for it.
+ *
  * @param[in] callback_ID ID of the callback to remove
  * @return 0 if successful, -1 otherwise
  */
 int switch_remove_callback(int callback_ID);
 
 /**
- * @brief Stop monitoring switch events
+ * @brief Get which switches are currently held
+ *
+ * The state is read from the input device with a single ioctl, so this function does not need
+ * #switch_init. If #switch_init was not called, the device file is opened on first call and
+ * kept open until #switch_release is called.
+ *
+ * @param[out] mask Mask of SWITCH_1_PRESSED and SWITCH_2_PRESSED for switches currently held (must
+ * not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int switch_get_state(uint8_t *mask);
+
+/**
+ * @brief Stop monitoring switch events and close device file
  *
  * @return 0 if successful, -1 otherwise
  */
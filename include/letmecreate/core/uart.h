@@ -3,6 +3,12 @@
  * @author Francois Berder
  * @date 2016
  * @copyright 3-clause BSD
+ *
+ * Functions taking a bus can be called from several threads: sending and receiving are locked
+ * separately on each device, so both devices can be used at the same time, and a thread can send
+ * data while another one waits for data on the same device. Other functions use the device
+ * selected by #uart_select_bus, which is shared by all threads. #uart_init and #uart_release must
+ * not be called while another thread uses a UART device.
  */
 
 
@@ -47,6 +53,62 @@ void uart_select_bus(uint8_t mikrobus_index);
  */
 uint8_t uart_get_current_bus(void);
 
+/**
+ * @brief Set the baud rate of a UART device.
+ *
+ * The device must be initialised first.
+ *
+ * @param[in] mikrobus_index Index of the device (see #MIKROBUS_INDEX)
+ * @param[in] baudrate Set the new baud rate of the UART device (see #UART_BAUDRATE for valid baud rates)
+ * @return 0 if successful, -1 otherwise
+ */
+int uart_bus_set_baudrate(uint8_t mikrobus_index, uint32_t baudrate);
+
+/**
+ * @brief Get the speed of a UART device.
+ *
+ * The device must be initialised first.
+ *
+ * @param[in] mikrobus_index Index of the device (see #MIKROBUS_INDEX)
+ * @param[out] baudrate Current baud rate of the UART device (must not be null)
+ * @return 0 if successful, -1 otherwise
+ */
+int uart_bus_get_baudrate(uint8_t mikrobus_index, uint32_t *baudrate);
+
+/**
+ * @brief Send some data using a UART device.
+ *
+ * @param[in] mikrobus_index Index of the device (see #MIKROBUS_INDEX)
+ * @param[in] buffer Array of bytes
+ * @param[in] count Number of bytes to send
+ * @return Number of bytes sent if successful, -1 otherwise
+ */
+int uart_bus_send(uint8_t mikrobus_index, const uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Receive some data using a UART device.
+ *
+ * Block until @p count bytes have been received.
+ *
+ * @param[in] mikrobus_index Index of the device (see #MIKROBUS_INDEX)
+ * @param[out] buffer Array of bytes
+ * @param[in] count Number of bytes to receive
+ * @return Number of bytes received if successful, -1 otherwise
+ */
+int uart_bus_receive(uint8_t mikrobus_index, uint8_t *buffer, uint32_t count);
+
+/**
+ * @brief Receive data of a UART device asynchronously.
+ *
+ * See #uart_set_receive_callback.
+ *
+ * @param[in] mikrobus_index Index of the device (see #MIKROBUS_INDEX)
+ * @param[in] callback Function called with received bytes, null to stop receiving data
+ * asynchronously
+ * @return 0 if successful, -1 otherwise
+ */
+int uart_bus_set_receive_callback(uint8_t mikrobus_index, void (*callback)(const uint8_t *buffer, uint32_t count));
+
 /**
  * @brief Set the baud rate of the current UART device.
  *
@@ -85,10 +147,26 @@ int uart_send(const uint8_t *buffer, uint32_t count);
  */
 int uart_receive(uint8_t *buffer, uint32_t count);
 
+/**
+ * @brief Receive data of current UART device asynchronously.
+ *
+ * The callback is called from the event loop (see event_loop.h) each time some data is
+ * received, with up to 64 bytes. #uart_receive must not be used on this device while a callback
+ * is set. Setting a callback replaces the previous one. The callback can be removed or replaced
+ * from inside the callback. The event loop is kept running until the device is released. Use
+ * #uart_bus_set_receive_callback to select the device explicitly.
+ *
+ * @param[in] callback Function called with received bytes, null to stop receiving data
+ * asynchronously
+ * @return 0 if successful, -1 otherwise
+ */
+int uart_set_receive_callback(void (*callback)(const uint8_t *buffer, uint32_t count));
+
 /**
  * @brief Release all UART devices.
  *
- * Close device file and restore old parameters.
+ * Close device file and restore old parameters. Sending and receiving data in progress on other
+ * threads complete first.
  *
  * @return 0 if successful, -1 otherwise
  */
@@ -1,9 +1,12 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include "letmecreate/click/air_quality.h"
 #include "letmecreate/core/common.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/core/gpio_monitor.h"
 
+static bool pin_acquired[] = { false, false };
+
 int air_quality_click_set_callback(uint8_t mikrobus_index, void(*callback)(uint8_t))
 {
     uint8_t output_pin = 0;
@@ -26,10 +29,12 @@ int air_quality_click_set_callback(uint8_t mikrobus_index, void(*callback)(uint8
         return -1;
     }
 
-    if (gpio_init(output_pin) < 0
-    ||  gpio_set_direction(output_pin, GPIO_INPUT) < 0) {
-        fprintf(stderr, "air quality: Failed to configure pin as an input.\n");
-        return -1;
+    if (!pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(output_pin, GPIO_INPUT) < 0) {
+            fprintf(stderr, "air quality: Failed to configure pin as an input.\n");
+            return -1;
+        }
+        pin_acquired[mikrobus_index] = true;
     }
 
     if (gpio_monitor_init() < 0)
@@ -40,3 +45,27 @@ int air_quality_click_set_callback(uint8_t mikrobus_index, void(*callback)(uint8
 
     return callback_ID;
 }
+
+int air_quality_click_release(uint8_t mikrobus_index)
+{
+    uint8_t output_pin = 0;
+
+    switch (mikrobus_index) {
+    case MIKROBUS_1:
+        output_pin = MIKROBUS_1_AN;
+        break;
+    case MIKROBUS_2:
+        output_pin = MIKROBUS_2_AN;
+        break;
+    default:
+        fprintf(stderr, "air quality: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    if (!pin_acquired[mikrobus_index])
+        return 0;
+
+    pin_acquired[mikrobus_index] = false;
+
+    return gpio_relinquish(output_pin);
+}
@@ -27,11 +27,13 @@ void sleep_5ms(void)
         req = rem;
 }
 
-int color_click_enable(void)
+int color_click_bus_enable(uint8_t mikrobus_index)
 {
-    if (i2c_write_register(TCS3471_ADDRESS,
-                           REPEATED_TRANSACTION | ENABLE_REG_ADDRESS,
-                           PON | AEN) < 0) {
+    struct i2c_device device = { mikrobus_index, TCS3471_ADDRESS };
+
+    if (i2c_device_write_register(&device,
+                                  REPEATED_TRANSACTION | ENABLE_REG_ADDRESS,
+                                  PON | AEN) < 0) {
         fprintf(stderr, "color: Failed to configure sensor.\n");
         return -1;
     }
@@ -42,11 +44,11 @@ int color_click_enable(void)
     return 0;
 }
 
-int color_click_get_color(uint16_t *clear, uint16_t *red, uint16_t *green, uint16_t *blue)
+int color_click_bus_get_color(uint8_t mikrobus_index,
+                              uint16_t *clear, uint16_t *red, uint16_t *green, uint16_t *blue)
 {
+    struct i2c_device device = { mikrobus_index, TCS3471_ADDRESS };
     uint8_t buffer[8];
-    const uint8_t check_status_cmd = REPEATED_TRANSACTION | STATUS_REG_ADDRESS;
-    const uint8_t get_measure_cmd = INCREMENT_TRANSACTION | COLOR_REG_ADDRESS;
     uint8_t status;
 
     if (clear == NULL || red == NULL || green == NULL || blue == NULL) {
@@ -54,25 +56,20 @@ int color_click_get_color(uint16_t *clear, uint16_t *red, uint16_t *green, uint1
         return -1;
     }
 
-    if (i2c_write(TCS3471_ADDRESS, &check_status_cmd, sizeof(check_status_cmd)) < 0) {
-        fprintf(stderr, "color: Failed to send status check command.");
-        return -1;
-    }
-
+    /*
+     * The status register is addressed again for each read, so that another
+     * thread using the bus between two reads cannot change the register read.
+     */
     do {
-        if (i2c_read(TCS3471_ADDRESS, &status, sizeof(status)) < 0) {
+        if (i2c_device_read_register(&device, REPEATED_TRANSACTION | STATUS_REG_ADDRESS, &status) < 0) {
             fprintf(stderr, "color: Failed to read status register.\n");
             return -1;
         }
     } while(!(RGBC_VALID_BIT & status));
 
 
-    if (i2c_write(TCS3471_ADDRESS, &get_measure_cmd, sizeof(get_measure_cmd)) < 0) {
-        fprintf(stderr, "color: Failed to send measurement request.\n");
-        return -1;
-    }
-
-    if (i2c_read(TCS3471_ADDRESS, buffer, sizeof(buffer)) < 0) {
+    if (i2c_device_read_registers(&device, INCREMENT_TRANSACTION | COLOR_REG_ADDRESS,
+                                  buffer, sizeof(buffer)) < 0) {
         fprintf(stderr, "color: Failed to read measurement.\n");
         return -1;
     }
@@ -85,9 +82,26 @@ int color_click_get_color(uint16_t *clear, uint16_t *red, uint16_t *green, uint1
     return 0;
 }
 
+int color_click_bus_disable(uint8_t mikrobus_index)
+{
+    struct i2c_device device = { mikrobus_index, TCS3471_ADDRESS };
+
+    return i2c_device_write_register(&device,
+                                     REPEATED_TRANSACTION | ENABLE_REG_ADDRESS,
+                                     SHUTDOWN_MODE);
+}
+
+int color_click_enable(void)
+{
+    return color_click_bus_enable(i2c_get_current_bus());
+}
+
+int color_click_get_color(uint16_t *clear, uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    return color_click_bus_get_color(i2c_get_current_bus(), clear, red, green, blue);
+}
+
 int color_click_disable(void)
 {
-    return i2c_write_register(TCS3471_ADDRESS,
-                              REPEATED_TRANSACTION | ENABLE_REG_ADDRESS,
-                              SHUTDOWN_MODE);
+    return color_click_bus_disable(i2c_get_current_bus());
 }
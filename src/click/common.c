@@ -1,35 +1,106 @@
 #include <stddef.h>
+#include <string.h>
 #include "letmecreate/click/common.h"
 #include "letmecreate/core/i2c.h"
 #include "letmecreate/core/spi.h"
 
-int i2c_write_register(uint16_t address, uint8_t reg_address, uint8_t value)
+int i2c_device_write_register(const struct i2c_device *device, uint8_t reg_address, uint8_t value)
 {
     uint8_t buffer[2];
     buffer[0] = reg_address;
     buffer[1] = value;
-    return i2c_write(address, buffer, sizeof(buffer));
+    return i2c_device_write(device, buffer, sizeof(buffer));
 }
 
-int i2c_read_register(uint16_t address, uint8_t reg_address, uint8_t *data)
+int i2c_device_read_register(const struct i2c_device *device, uint8_t reg_address, uint8_t *data)
 {
-    if (i2c_write_byte(address, reg_address) < 0)
+    struct i2c_message messages[2];
+
+    if (device == NULL || data == NULL)
         return -1;
 
-    return i2c_read_byte(address, data);
+    messages[0] = (struct i2c_message) { device->slave_address, 0, &reg_address, 1, 0 };
+    messages[1] = (struct i2c_message) { device->slave_address, 1, data, 1, 0 };
+
+    return i2c_transfer(device->mikrobus_index, messages, 2);
 }
 
-int i2c_read_16b_register(uint16_t address,
-                          uint8_t reg_low_address, uint8_t reg_high_address,
-                          uint16_t *data)
+int i2c_device_write_registers(const struct i2c_device *device, uint8_t start_reg_address,
+                               const uint8_t *data, uint8_t count)
+{
+    uint8_t buffer[256];
+
+    if (data == NULL || count == 0)
+        return -1;
+
+    /* Register address and values must be sent in the same message to be written in a row. */
+    buffer[0] = start_reg_address;
+    memcpy(&buffer[1], data, count);
+    if (i2c_device_write(device, buffer, count + 1) < 0)
+        return -1;
+
+    return 0;
+}
+
+int i2c_device_read_registers(const struct i2c_device *device, uint8_t start_reg_address,
+                              uint8_t *data, uint8_t count)
+{
+    struct i2c_message messages[2];
+
+    if (device == NULL || data == NULL || count == 0)
+        return -1;
+
+    messages[0] = (struct i2c_message) { device->slave_address, 0, &start_reg_address, 1, 0 };
+    messages[1] = (struct i2c_message) { device->slave_address, 1, data, count, 0 };
+
+    return i2c_transfer(device->mikrobus_index, messages, 2);
+}
+
+int i2c_device_read_16b_register(const struct i2c_device *device,
+                                 uint8_t reg_low_address, uint8_t reg_high_address,
+                                 uint16_t *data)
+{
+    uint8_t low = 0, high = 0;
+
+    if (data == NULL)
+        return -1;
+
+    if (i2c_device_read_register(device, reg_low_address, &low) < 0)
+        return -1;
+    if (i2c_device_read_register(device, reg_high_address, &high) < 0)
+        return -1;
+
+    *data = high;
+    *data <<= 8;
+    *data |= low;
+
+    return 0;
+}
+
+int i2c_device_read_16b_register_burst(const struct i2c_device *device,
+                                       uint8_t reg_low_address, uint8_t reg_high_address,
+                                       uint16_t *data)
 {
+    uint8_t buffer[2];
     uint8_t low = 0, high = 0;
 
-    if (i2c_read_register(address, reg_low_address, &low) < 0)
+    if (device == NULL || data == NULL)
         return -1;
 
-    if (i2c_read_register(address, reg_high_address, &high) < 0)
+    /* Halves are read in a row, relying on auto-increment of the register address. */
+    if (reg_high_address == reg_low_address + 1) {
+        if (i2c_device_read_registers(device, reg_low_address, buffer, 2) < 0)
+            return -1;
+        low = buffer[0];
+        high = buffer[1];
+    } else if (reg_low_address == reg_high_address + 1) {
+        if (i2c_device_read_registers(device, reg_high_address, buffer, 2) < 0)
+            return -1;
+        high = buffer[0];
+        low = buffer[1];
+    } else {
         return -1;
+    }
 
     *data = high;
     *data <<= 8;
@@ -38,6 +109,54 @@ int i2c_read_16b_register(uint16_t address,
     return 0;
 }
 
+int i2c_write_register(uint16_t address, uint8_t reg_address, uint8_t value)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_write_register(&device, reg_address, value);
+}
+
+int i2c_read_register(uint16_t address, uint8_t reg_address, uint8_t *data)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_read_register(&device, reg_address, data);
+}
+
+int i2c_write_registers(uint16_t address, uint8_t start_reg_address,
+                        const uint8_t *data, uint8_t count)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_write_registers(&device, start_reg_address, data, count);
+}
+
+int i2c_read_registers(uint16_t address, uint8_t start_reg_address,
+                       uint8_t *data, uint8_t count)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_read_registers(&device, start_reg_address, data, count);
+}
+
+int i2c_read_16b_register(uint16_t address,
+                          uint8_t reg_low_address, uint8_t reg_high_address,
+                          uint16_t *data)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_read_16b_register(&device, reg_low_address, reg_high_address, data);
+}
+
+int i2c_read_16b_register_burst(uint16_t address,
+                                uint8_t reg_low_address, uint8_t reg_high_address,
+                                uint16_t *data)
+{
+    struct i2c_device device = { i2c_get_current_bus(), address };
+
+    return i2c_device_read_16b_register_burst(&device, reg_low_address, reg_high_address, data);
+}
+
 int spi_write_register(uint8_t reg_address, uint8_t data)
 {
     uint8_t tx_buffer[2];
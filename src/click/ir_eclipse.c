@@ -1,9 +1,11 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include "letmecreate/click/ir_eclipse.h"
 #include "letmecreate/core/common.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/core/gpio_monitor.h"
 
+static bool pin_acquired[] = { false, false };
 
 int ir_eclipse_click_add_callback(uint8_t mikrobus_index, void (*callback)(uint8_t))
 {
@@ -26,10 +28,38 @@ int ir_eclipse_click_add_callback(uint8_t mikrobus_index, void (*callback)(uint8
         return -1;
     }
 
-    if (gpio_init(gpio_pin) < 0
-    ||  gpio_set_direction(gpio_pin, GPIO_INPUT) < 0
-    ||  gpio_monitor_init() < 0)
+    if (!pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(gpio_pin, GPIO_INPUT) < 0)
+            return -1;
+        pin_acquired[mikrobus_index] = true;
+    }
+
+    if (gpio_monitor_init() < 0)
         return -1;
 
     return gpio_monitor_add_callback(gpio_pin, GPIO_EDGE, callback);
 }
+
+int ir_eclipse_click_release(uint8_t mikrobus_index)
+{
+    uint8_t gpio_pin;
+
+    switch (mikrobus_index) {
+    case MIKROBUS_1:
+        gpio_pin = MIKROBUS_1_INT;
+        break;
+    case MIKROBUS_2:
+        gpio_pin = MIKROBUS_2_INT;
+        break;
+    default:
+        fprintf(stderr, "ir_eclipse: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    if (!pin_acquired[mikrobus_index])
+        return 0;
+
+    pin_acquired[mikrobus_index] = false;
+
+    return gpio_relinquish(gpio_pin);
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include "letmecreate/click/joystick.h"
 #include "letmecreate/click/common.h"
+#include "letmecreate/core/i2c.h"
 
 
 #define JOYSTICK_ADDRESS (0x40)
@@ -8,14 +9,16 @@
 #define X_REG (0x10)
 #define Y_REG (0x11)
 
-int joystick_click_get_x(int8_t * x)
+int joystick_click_bus_get_x(uint8_t mikrobus_index, int8_t * x)
 {
+    struct i2c_device device = { mikrobus_index, JOYSTICK_ADDRESS };
+
     if (x == NULL) {
         fprintf(stderr, "joystick: Cannot store X coordinate using null pointer.\n");
         return -1;
     }
 
-    if (i2c_read_register(JOYSTICK_ADDRESS, X_REG, (uint8_t*)x) == -1) {
+    if (i2c_device_read_register(&device, X_REG, (uint8_t*)x) == -1) {
         fprintf(stderr, "joystick: Failed to read X coordinate from device.\n");
         return -1;
     }
@@ -23,14 +26,16 @@ int joystick_click_get_x(int8_t * x)
     return 0;
 }
 
-int joystick_click_get_y(int8_t * y)
+int joystick_click_bus_get_y(uint8_t mikrobus_index, int8_t * y)
 {
+    struct i2c_device device = { mikrobus_index, JOYSTICK_ADDRESS };
+
     if (y == NULL) {
         fprintf(stderr, "joystick: Cannot store Y coordinate using null pointer.\n");
         return -1;
     }
 
-    if (i2c_read_register(JOYSTICK_ADDRESS, Y_REG, (uint8_t*)y) == -1) {
+    if (i2c_device_read_register(&device, Y_REG, (uint8_t*)y) == -1) {
         fprintf(stderr, "joystick: Failed to read Y coordinate from device.\n");
         return -1;
     }
@@ -38,21 +43,41 @@ int joystick_click_get_y(int8_t * y)
     return 0;
 }
 
-int joystick_click_get_position(int8_t * x, int8_t * y)
+int joystick_click_bus_get_position(uint8_t mikrobus_index, int8_t * x, int8_t * y)
 {
-    // We read to temp variables to make sure we do not write
+    struct i2c_device device = { mikrobus_index, JOYSTICK_ADDRESS };
+    // We read to a temp variable to make sure we do not write
     // to only one coordinate if read fails halfway through
-    int8_t tempX, tempY;
+    uint16_t position;
 
-    if (joystick_click_get_x(&tempX) == -1)
+    if (x == NULL || y == NULL) {
+        fprintf(stderr, "joystick: Cannot store coordinates using null pointers.\n");
         return -1;
+    }
 
-    if (joystick_click_get_y(&tempY) == -1)
+    // X and Y are read in a single transaction so that they are sampled together
+    if (i2c_device_read_16b_register_burst(&device, X_REG, Y_REG, &position) == -1) {
+        fprintf(stderr, "joystick: Failed to read position from device.\n");
         return -1;
+    }
 
-    *x = tempX;
-    *y = tempY;
+    *x = (int8_t)(position & 0xFF);
+    *y = (int8_t)(position >> 8);
 
     return 0;
 }
 
+int joystick_click_get_x(int8_t * x)
+{
+    return joystick_click_bus_get_x(i2c_get_current_bus(), x);
+}
+
+int joystick_click_get_y(int8_t * y)
+{
+    return joystick_click_bus_get_y(i2c_get_current_bus(), y);
+}
+
+int joystick_click_get_position(int8_t * x, int8_t * y)
+{
+    return joystick_click_bus_get_position(i2c_get_current_bus(), x, y);
+}
@@ -1,68 +1,84 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include "letmecreate/click/motion.h"
 #include "letmecreate/core/common.h"
+#include "letmecreate/core/gpio.h"
 #include "letmecreate/core/gpio_monitor.h"
 
-int motion_click_enable(uint8_t mikrobus_index)
+static const uint8_t enable_pins[] = { MIKROBUS_1_RST, MIKROBUS_2_RST };
+static const uint8_t output_pins[] = { MIKROBUS_1_INT, MIKROBUS_2_INT };
+static bool enable_pin_acquired[] = { false, false };
+static bool output_pin_acquired[] = { false, false };
+
+static bool check_mikrobus_index(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_RST)
-        &&  !gpio_set_direction(MIKROBUS_1_RST, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_RST, 1))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_RST)
-        &&  !gpio_set_direction(MIKROBUS_2_RST, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_RST, 1))
-            return 0;
-    default:
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
         fprintf(stderr, "motion: Invalid mikrobus index.\n");
+        return false;
+    }
+
+    return true;
+}
+
+static int set_enable_pin(uint8_t mikrobus_index, uint8_t value)
+{
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
+
+    if (!enable_pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(enable_pins[mikrobus_index], GPIO_OUTPUT) < 0)
+            return -1;
+        enable_pin_acquired[mikrobus_index] = true;
     }
 
-    return -1;
+    return gpio_set_value(enable_pins[mikrobus_index], value);
+}
+
+int motion_click_enable(uint8_t mikrobus_index)
+{
+    return set_enable_pin(mikrobus_index, 1);
 }
 
 int motion_click_attach_callback(uint8_t mikrobus_index, void(*callback)(uint8_t))
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_INT)
-         && !gpio_set_direction(MIKROBUS_1_INT, GPIO_INPUT)
-         && !gpio_monitor_init())
-            return gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_RAISING, callback);
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_INT)
-         && !gpio_set_direction(MIKROBUS_2_INT, GPIO_INPUT)
-         && !gpio_monitor_init())
-            return gpio_monitor_add_callback(MIKROBUS_2_INT, GPIO_RAISING, callback);
-    default:
-        fprintf(stderr, "motion: Invalid mikrobus index.\n");
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
+
+    if (!output_pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(output_pins[mikrobus_index], GPIO_INPUT) < 0)
+            return -1;
+        output_pin_acquired[mikrobus_index] = true;
     }
 
-    return -1;
+    if (gpio_monitor_init() < 0)
+        return -1;
+
+    return gpio_monitor_add_callback(output_pins[mikrobus_index], GPIO_RAISING, callback);
 }
 
 int motion_click_disable(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_RST)
-        &&  !gpio_set_direction(MIKROBUS_1_RST, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_RST, 0))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_RST)
-        &&  !gpio_set_direction(MIKROBUS_2_RST, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_RST, 0))
-            return 0;
-    default:
-        fprintf(stderr, "motion: Invalid mikrobus index.\n");
+    return set_enable_pin(mikrobus_index, 0);
+}
+
+int motion_click_release(uint8_t mikrobus_index)
+{
+    int ret = 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
+
+    if (enable_pin_acquired[mikrobus_index]) {
+        enable_pin_acquired[mikrobus_index] = false;
+        if (gpio_relinquish(enable_pins[mikrobus_index]) < 0)
+            ret = -1;
     }
 
-    return -1;
-}
+    if (output_pin_acquired[mikrobus_index]) {
+        output_pin_acquired[mikrobus_index] = false;
+        if (gpio_relinquish(output_pins[mikrobus_index]) < 0)
+            ret = -1;
+    }
 
+    return ret;
+}
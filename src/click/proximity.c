@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include "letmecreate/click/proximity.h"
 #include "letmecreate/click/common.h"
+#include "letmecreate/core/common.h"
+#include "letmecreate/core/i2c.h"
 
 #define COMMAND_REG             (0x80)
 #define PRIDREV_REG             (0x81)
@@ -21,36 +23,52 @@
 #define PROXIMITY_RATE          (1)         /* 3.90625 measurements per second */
 #define LED_CURRENT             (4)         /* 40mA */
 
-static bool enabled = false;
+/* Sensor state on each mikrobus */
+static bool enabled[] = { false, false };
 
-int proximity_click_enable(void)
+static bool check_mikrobus_index(uint8_t mikrobus_index)
 {
-    if (enabled)
+    if (mikrobus_index == MIKROBUS_1 || mikrobus_index == MIKROBUS_2)
+        return true;
+
+    fprintf(stderr, "proximity: Invalid mikrobus index.\n");
+    return false;
+}
+
+int proximity_click_bus_enable(uint8_t mikrobus_index)
+{
+    struct i2c_device device = { mikrobus_index, VCNL4010_ADDRESS };
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    if (enabled[mikrobus_index])
         return 0;
 
-    if (i2c_write_register(VCNL4010_ADDRESS, PROXRATE_REG, PROXIMITY_RATE) < 0) {
+    if (i2c_device_write_register(&device, PROXRATE_REG, PROXIMITY_RATE) < 0) {
         fprintf(stderr, "proximity: Failed to set measurement rate.\n");
         return -1;
     }
 
-    if (i2c_write_register(VCNL4010_ADDRESS, LED_REG, LED_CURRENT) < 0) {
+    if (i2c_device_write_register(&device, LED_REG, LED_CURRENT) < 0) {
         fprintf(stderr, "proximity: Failed to configure led current.\n");
         return -1;
     }
 
-    if (i2c_write_register(VCNL4010_ADDRESS, COMMAND_REG,
-                             COMMAND_SELFTIMED_EN | COMMAND_PROX_EN) < 0) {
+    if (i2c_device_write_register(&device, COMMAND_REG,
+                                  COMMAND_SELFTIMED_EN | COMMAND_PROX_EN) < 0) {
         fprintf(stderr, "proximity: Failed to enable sensor.\n");
         return -1;
     }
 
-    enabled = true;
+    enabled[mikrobus_index] = true;
 
     return 0;
 }
 
-int proximity_click_get_measure(uint16_t *measure)
+int proximity_click_bus_get_measure(uint8_t mikrobus_index, uint16_t *measure)
 {
+    struct i2c_device device = { mikrobus_index, VCNL4010_ADDRESS };
     bool measure_available = false;
 
     if (measure == NULL) {
@@ -58,7 +76,10 @@ int proximity_click_get_measure(uint16_t *measure)
         return -1;
     }
 
-    if (enabled == false) {
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    if (enabled[mikrobus_index] == false) {
         fprintf(stderr, "proximity: Cannot get measure from disabled sensor.\n");
         return -1;
     }
@@ -66,7 +87,7 @@ int proximity_click_get_measure(uint16_t *measure)
     while (measure_available == false) {
         uint8_t value;
 
-        if (i2c_read_register(VCNL4010_ADDRESS, COMMAND_REG, &value) < 0) {
+        if (i2c_device_read_register(&device, COMMAND_REG, &value) < 0) {
             fprintf(stderr, "proximity: Failed to read command register.\n");
             return -1;
         }
@@ -75,20 +96,40 @@ int proximity_click_get_measure(uint16_t *measure)
             measure_available = true;
     }
 
-    return i2c_read_16b_register(VCNL4010_ADDRESS, PROX_RESULT_LOW_REG, PROX_RESULT_HIGH_REG, measure);
+    return i2c_device_read_16b_register(&device, PROX_RESULT_LOW_REG, PROX_RESULT_HIGH_REG, measure);
 }
 
-int proximity_click_disable(void)
+int proximity_click_bus_disable(uint8_t mikrobus_index)
 {
-    if (enabled == false)
+    struct i2c_device device = { mikrobus_index, VCNL4010_ADDRESS };
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    if (enabled[mikrobus_index] == false)
         return 0;
 
-    if (i2c_write_register(VCNL4010_ADDRESS, COMMAND_REG, 0) < 0) {
+    if (i2c_device_write_register(&device, COMMAND_REG, 0) < 0) {
         fprintf(stderr, "proximity: Failed to disable sensor.\n");
         return -1;
     }
 
-    enabled = false;
+    enabled[mikrobus_index] = false;
 
     return 0;
 }
+
+int proximity_click_enable(void)
+{
+    return proximity_click_bus_enable(i2c_get_current_bus());
+}
+
+int proximity_click_get_measure(uint16_t *measure)
+{
+    return proximity_click_bus_get_measure(i2c_get_current_bus(), measure);
+}
+
+int proximity_click_disable(void)
+{
+    return proximity_click_bus_disable(i2c_get_current_bus());
+}
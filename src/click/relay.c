@@ -1,47 +1,50 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include "letmecreate/core/common.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/click/relay.h"
 
 
-int relay_click_enable_relay_1(uint8_t mikrobus_index)
+static const uint8_t relay_pins[] = { MIKROBUS_1_PWM, MIKROBUS_2_PWM };
+static bool pin_acquired[] = { false, false };
+
+static int set_relay_1(uint8_t mikrobus_index, uint8_t value)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_PWM)
-        &&  !gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_PWM, 1))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_PWM)
-        &&  !gpio_set_direction(MIKROBUS_2_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_PWM, 1))
-            return 0;
-        default:
-            fprintf(stderr, "relay: Invalid mikrobus index.\n");
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "relay: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    if (!pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(relay_pins[mikrobus_index], GPIO_OUTPUT) < 0)
             return -1;
+        pin_acquired[mikrobus_index] = true;
     }
 
-    return -1;
+    return gpio_set_value(relay_pins[mikrobus_index], value);
+}
+
+int relay_click_enable_relay_1(uint8_t mikrobus_index)
+{
+    return set_relay_1(mikrobus_index, 1);
 }
 
 int relay_click_disable_relay_1(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_PWM)
-        &&  !gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_PWM, 0))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_PWM)
-        &&  !gpio_set_direction(MIKROBUS_2_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_PWM, 0))
-            return 0;
-        default:
-            fprintf(stderr, "relay: Invalid mikrobus index.\n");
-            return -1;
+    return set_relay_1(mikrobus_index, 0);
+}
+
+int relay_click_release(uint8_t mikrobus_index)
+{
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "relay: Invalid mikrobus index.\n");
+        return -1;
     }
 
-    return -1;
+    if (!pin_acquired[mikrobus_index])
+        return 0;
+
+    pin_acquired[mikrobus_index] = false;
+
+    return gpio_relinquish(relay_pins[mikrobus_index]);
 }
@@ -1,89 +1,79 @@
+#include <stdbool.h>
 #include <stdio.h>
 #include "letmecreate/core/common.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/click/relay2.h"
 
+enum RELAY {
+    RELAY_1,
+    RELAY_2,
+    RELAY_CNT
+};
 
-int relay2_click_enable_relay_1(uint8_t mikrobus_index)
+/* Relay 1 is controlled by PWM pin, relay 2 by AN pin */
+static const uint8_t relay_pins[2][RELAY_CNT] = {
+    { MIKROBUS_1_PWM, MIKROBUS_1_AN },
+    { MIKROBUS_2_PWM, MIKROBUS_2_AN }
+};
+static bool pin_acquired[2][RELAY_CNT] = {
+    { false, false },
+    { false, false }
+};
+
+static int set_relay(uint8_t mikrobus_index, uint8_t relay, uint8_t value)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_PWM)
-        &&  !gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_PWM, 1))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_PWM)
-        &&  !gpio_set_direction(MIKROBUS_2_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_PWM, 1))
-            return 0;
-        default:
-            fprintf(stderr, "relay2: Invalid mikrobus index.\n");
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "relay2: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    if (!pin_acquired[mikrobus_index][relay]) {
+        if (gpio_acquire(relay_pins[mikrobus_index][relay], GPIO_OUTPUT) < 0)
             return -1;
+        pin_acquired[mikrobus_index][relay] = true;
     }
 
-    return -1;
+    return gpio_set_value(relay_pins[mikrobus_index][relay], value);
 }
 
-int relay2_click_disable_relay_1(uint8_t mikrobus_index)
+int relay2_click_enable_relay_1(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_PWM)
-        &&  !gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_PWM, 0))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_PWM)
-        &&  !gpio_set_direction(MIKROBUS_2_PWM, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_PWM, 0))
-            return 0;
-        default:
-            fprintf(stderr, "relay2: Invalid mikrobus index.\n");
-            return -1;
-    }
+    return set_relay(mikrobus_index, RELAY_1, 1);
+}
 
-    return -1;
+int relay2_click_disable_relay_1(uint8_t mikrobus_index)
+{
+    return set_relay(mikrobus_index, RELAY_1, 0);
 }
 
 int relay2_click_enable_relay_2(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_AN)
-        &&  !gpio_set_direction(MIKROBUS_1_AN, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_AN, 1))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_AN)
-        &&  !gpio_set_direction(MIKROBUS_2_AN, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_AN, 1))
-            return 0;
-        default:
-            fprintf(stderr, "relay2: Invalid mikrobus index.\n");
-            return -1;
-    }
-
-    return -1;
+    return set_relay(mikrobus_index, RELAY_2, 1);
 }
 
 int relay2_click_disable_relay_2(uint8_t mikrobus_index)
 {
-    switch (mikrobus_index) {
-    case MIKROBUS_1:
-        if (!gpio_init(MIKROBUS_1_AN)
-        &&  !gpio_set_direction(MIKROBUS_1_AN, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_1_AN, 0))
-            return 0;
-    case MIKROBUS_2:
-        if (!gpio_init(MIKROBUS_2_AN)
-        &&  !gpio_set_direction(MIKROBUS_2_AN, GPIO_OUTPUT)
-        &&  !gpio_set_value(MIKROBUS_2_AN, 0))
-            return 0;
-        default:
-            fprintf(stderr, "relay2: Invalid mikrobus index.\n");
-            return -1;
+    return set_relay(mikrobus_index, RELAY_2, 0);
+}
+
+int relay2_click_release(uint8_t mikrobus_index)
+{
+    uint8_t relay;
+    int ret = 0;
+
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "relay2: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    for (relay = 0; relay < RELAY_CNT; ++relay) {
+        if (!pin_acquired[mikrobus_index][relay])
+            continue;
+
+        pin_acquired[mikrobus_index][relay] = false;
+        if (gpio_relinquish(relay_pins[mikrobus_index][relay]) < 0)
+            ret = -1;
     }
 
-    return -1;
+    return ret;
 }
@@ -18,6 +18,7 @@
 
 static bool enabled = false;
 static uint8_t last_address_bit = 0;
+static bool alarm_pin_acquired[] = { false, false };
 
 int thermo3_click_enable(uint8_t add_bit)
 {
@@ -91,10 +92,12 @@ int thermo3_click_set_alarm(uint8_t mikrobus_index, float threshold, void(*callb
         return -1;
     }
 
-    if (gpio_init(alarm_pin) < 0
-    ||  gpio_set_direction(alarm_pin, GPIO_INPUT) < 0) {
-        fprintf(stderr, "thermo3: Failed to configure alert pin as an input.\n");
-        return -1;
+    if (!alarm_pin_acquired[mikrobus_index]) {
+        if (gpio_acquire(alarm_pin, GPIO_INPUT) < 0) {
+            fprintf(stderr, "thermo3: Failed to configure alert pin as an input.\n");
+            return -1;
+        }
+        alarm_pin_acquired[mikrobus_index] = true;
     }
 
     buffer[0] = TEMPERATURE_HIGH_REG_ADDRESS;
@@ -131,3 +134,27 @@ int thermo3_click_disable(void)
 
     return 0;
 }
+
+int thermo3_click_release(uint8_t mikrobus_index)
+{
+    uint8_t alarm_pin = 0;
+
+    switch (mikrobus_index) {
+    case MIKROBUS_1:
+        alarm_pin = MIKROBUS_1_INT;
+        break;
+    case MIKROBUS_2:
+        alarm_pin = MIKROBUS_2_INT;
+        break;
+    default:
+        fprintf(stderr, "thermo3: Invalid mikrobus index.\n");
+        return -1;
+    }
+
+    if (!alarm_pin_acquired[mikrobus_index])
+        return 0;
+
+    alarm_pin_acquired[mikrobus_index] = false;
+
+    return gpio_relinquish(alarm_pin);
+}
@@ -1,9 +1,37 @@
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include "letmecreate/core/adc.h"
 #include "letmecreate/core/common.h"
+#include "letmecreate/core/event_loop.h"
 
 #define ADC_BASE_PATH       "/sys/bus/iio/devices/iio:device0/"
 
+/* File descriptors are opened on first reading and kept open until adc_release is called. */
+static int fds[2] = { -1, -1 };
+
+/* Timers of ADC sampled periodically, expiring in the event loop */
+static int timer_fds[2] = { -1, -1 };
+static void (*sampling_callbacks[2])(float) = { NULL, NULL };
+
+static void sample(uint32_t events, void *arg)
+{
+    uint8_t mikrobus_index = (uintptr_t)arg;
+    uint64_t expiration_cnt;
+    float value;
+
+    if (read(timer_fds[mikrobus_index], &expiration_cnt, sizeof(expiration_cnt)) < 0)
+        return;
+
+    if (adc_get_value(mikrobus_index, &value) < 0)
+        return;
+
+    sampling_callbacks[mikrobus_index](value);
+}
+
 /*
  * The Ci40 contains several 10-bit ADC which can be accessed by reading
  * /sys/bus/iio/devices/iio:device0/in_voltage0_raw (for mikrobus 1)
@@ -19,7 +47,6 @@
 int adc_get_value(uint8_t mikrobus_index, float *value)
 {
     uint32_t tmp = 0;
-    char path[MAX_STR_LENGTH];
 
     if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
         fprintf(stderr, "adc: Invalid index.\n");
@@ -31,12 +58,19 @@ int adc_get_value(uint8_t mikrobus_index, float *value)
         return -1;
     }
 
-    if (snprintf(path, MAX_STR_LENGTH, ADC_BASE_PATH"in_voltage%d_raw", mikrobus_index) < 0) {
-        fprintf(stderr, "adc: Failed to create path to access value of ADC %d.\n", mikrobus_index);
-        return -1;
+    if (fds[mikrobus_index] < 0) {
+        char path[MAX_STR_LENGTH];
+
+        if (create_device_path(path, ADC_BASE_PATH"in_voltage%d_raw", mikrobus_index) < 0) {
+            fprintf(stderr, "adc: Failed to create path to access value of ADC %d.\n", mikrobus_index);
+            return -1;
+        }
+
+        if ((fds[mikrobus_index] = open_device_file(path, O_RDONLY)) < 0)
+            return -1;
     }
 
-    if (read_int_file(path, &tmp) < 0) {
+    if (read_int_fd(fds[mikrobus_index], &tmp) < 0) {
         fprintf(stderr, "adc: Failed to read value from ADC %d.\n", mikrobus_index);
         return -1;
     }
@@ -45,3 +79,107 @@ int adc_get_value(uint8_t mikrobus_index, float *value)
 
     return 0;
 }
+
+int adc_start_sampling(uint8_t mikrobus_index, uint32_t period, void (*callback)(float value))
+{
+    struct itimerspec spec;
+
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "adc: Invalid index.\n");
+        return -1;
+    }
+
+    if (period == 0) {
+        fprintf(stderr, "adc: Invalid sampling period.\n");
+        return -1;
+    }
+
+    if (callback == NULL) {
+        fprintf(stderr, "adc: Cannot start sampling with null callback.\n");
+        return -1;
+    }
+
+    if (timer_fds[mikrobus_index] >= 0) {
+        fprintf(stderr, "adc: ADC %d is already sampled.\n", mikrobus_index);
+        return -1;
+    }
+
+    if ((timer_fds[mikrobus_index] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "adc: Failed to create timer.\n");
+        return -1;
+    }
+
+    spec.it_value.tv_sec = period / 1000;
+    spec.it_value.tv_nsec = (period % 1000) * 1000000;
+    spec.it_interval = spec.it_value;
+    if (timerfd_settime(timer_fds[mikrobus_index], 0, &spec, NULL) < 0) {
+        fprintf(stderr, "adc: Failed to start timer.\n");
+        close(timer_fds[mikrobus_index]);
+        timer_fds[mikrobus_index] = -1;
+        return -1;
+    }
+
+    if (event_loop_init() < 0) {
+        close(timer_fds[mikrobus_index]);
+        timer_fds[mikrobus_index] = -1;
+        return -1;
+    }
+
+    sampling_callbacks[mikrobus_index] = callback;
+    if (event_loop_add_fd(timer_fds[mikrobus_index], EPOLLIN, sample, (void *)(uintptr_t)mikrobus_index) < 0) {
+        event_loop_release();
+        close(timer_fds[mikrobus_index]);
+        timer_fds[mikrobus_index] = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+int adc_stop_sampling(uint8_t mikrobus_index)
+{
+    int ret = 0;
+
+    if (mikrobus_index != MIKROBUS_1 && mikrobus_index != MIKROBUS_2) {
+        fprintf(stderr, "adc: Invalid index.\n");
+        return -1;
+    }
+
+    if (timer_fds[mikrobus_index] < 0)
+        return 0;
+
+    if (event_loop_remove_fd(timer_fds[mikrobus_index]) < 0
+    ||  event_loop_release() < 0)
+        ret = -1;
+
+    if (close(timer_fds[mikrobus_index]) < 0) {
+        fprintf(stderr, "adc: Failed to close timer of ADC %d.\n", mikrobus_index);
+        ret = -1;
+    }
+    timer_fds[mikrobus_index] = -1;
+    sampling_callbacks[mikrobus_index] = NULL;
+
+    return ret;
+}
+
+int adc_release(void)
+{
+    int ret = 0;
+    unsigned int i;
+
+    for (i = 0; i < 2; ++i) {
+        if (adc_stop_sampling(i) < 0)
+            ret = -1;
+
+        if (fds[i] < 0)
+            continue;
+
+        if (close(fds[i]) < 0) {
+            fprintf(stderr, "adc: Failed to close file descriptor of ADC %d.\n", i);
+            ret = -1;
+        }
+        fds[i] = -1;
+    }
+
+    return ret;
+}
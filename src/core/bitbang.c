@@ -0,0 +1,739 @@
+/*
+ * Software SPI, I2C and 1-Wire buses built on top of gpio.c.
+ *
+ * GPIO's keep their value file (sysfs) or line request (character device)
+ * open once initialised, so toggling a pin costs a single syscall. Delays
+ * between edges are busy-waits on CLOCK_MONOTONIC: sleeping would give the
+ * CPU away for much longer than a clock period.
+ *
+ * I2C and 1-Wire lines are open-drain. A line is pulled low by configuring
+ * the GPIO as an output low, and released by configuring it as an input, the
+ * pull-up resistor bringing the line high. The direction file (sysfs) is kept
+ * open as well, so each edge also costs a single syscall.
+ *
+ * 1-Wire slots leave no room for the latency of sysfs, so the 1-Wire bus
+ * requires the character device backend. The time of GPIO accesses is
+ * measured when the bus is initialised, and each slot checks that its
+ * deadlines were met, since the thread can be preempted at any time.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "letmecreate/core/bitbang.h"
+#include "letmecreate/core/gpio.h"
+
+#define NS_PER_SEC                  (1000000000ULL)
+#define NS_PER_US                   (1000)
+
+#define SPI_PIN_CNT                 (4)
+
+/* Maximum time a slave can hold SCL low */
+#define I2C_CLOCK_STRETCH_TIMEOUT   (10000000ULL)
+
+/*
+ * 1-Wire standard speed timings in ns. Times within a slot are measured from
+ * the end of the access pulling the line low.
+ */
+#define ONEWIRE_RESET_LOW           (480 * NS_PER_US)
+#define ONEWIRE_PRESENCE_WAIT       (70 * NS_PER_US)
+#define ONEWIRE_RESET_RECOVERY      (410 * NS_PER_US)
+#define ONEWIRE_WRITE_1_LOW         (6 * NS_PER_US)
+#define ONEWIRE_WRITE_0_LOW         (60 * NS_PER_US)
+#define ONEWIRE_READ_LOW            (6 * NS_PER_US)
+#define ONEWIRE_READ_SAMPLE         (9 * NS_PER_US)
+#define ONEWIRE_SLOT                (70 * NS_PER_US)
+
+/*
+ * Devices sample the line, or stop pulling it low, 15us after the falling
+ * edge. The edge occurs up to one GPIO access before the start of the slot,
+ * and the line is released or sampled up to one access after its deadline:
+ * timings are only met if an access takes less than 3us.
+ */
+#define ONEWIRE_MAX_ACCESS_TIME     (3 * NS_PER_US)
+#define ONEWIRE_CALIBRATION_CNT     (16)
+
+struct spi_bus {
+    bool initialised;
+    uint8_t sck, mosi, miso, cs;
+    uint8_t cpol, cpha;
+    uint32_t half_period;           /* in ns */
+};
+
+struct i2c_bus {
+    bool initialised;
+    uint8_t sda, scl;
+    uint32_t half_period;           /* in ns */
+};
+
+struct onewire_bus {
+    bool initialised;
+    uint8_t pin;
+};
+
+static struct spi_bus spi = { false, 0, 0, 0, 0, 0, 0, 0 };
+static struct i2c_bus i2c = { false, 0, 0, 0 };
+static struct onewire_bus onewire = { false, 0 };
+
+static uint64_t get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+static void delay_ns(uint32_t duration)
+{
+    uint64_t end;
+
+    if (duration == 0)
+        return;
+
+    end = get_time_ns() + duration;
+    while (get_time_ns() < end)
+        ;
+}
+
+static void wait_until(uint64_t deadline)
+{
+    while (get_time_ns() < deadline)
+        ;
+}
+
+static uint32_t speed_to_half_period(uint32_t speed)
+{
+    return NS_PER_SEC / (2ULL * speed);
+}
+
+/*
+ * Pins are acquired rather than initialised, so that pins already used by
+ * another driver are not released when a bus fails to initialise or is
+ * released. A pin which cannot be configured is given up before returning.
+ */
+static int acquire_pin(uint8_t pin, uint8_t dir, uint8_t value)
+{
+    if (gpio_acquire(pin, dir) < 0)
+        return -1;
+
+    if (dir == GPIO_OUTPUT && gpio_set_value(pin, value) < 0) {
+        gpio_relinquish(pin);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Give up pins in reverse order of acquisition */
+static int relinquish_pins(const uint8_t *pins, unsigned int count)
+{
+    int ret = 0;
+
+    while (count > 0) {
+        if (gpio_relinquish(pins[--count]) < 0)
+            ret = -1;
+    }
+
+    return ret;
+}
+
+/* Release line, or pull it low */
+static int set_open_drain(uint8_t pin, uint8_t value)
+{
+    return gpio_set_direction(pin, value ? GPIO_INPUT : GPIO_OUTPUT);
+}
+
+static int acquire_open_drain_pin(uint8_t pin)
+{
+    /* Output level must be low whenever the pin is configured as an output */
+    if (acquire_pin(pin, GPIO_OUTPUT, 0) < 0)
+        return -1;
+
+    if (set_open_drain(pin, 1) < 0) {
+        gpio_relinquish(pin);
+        return -1;
+    }
+
+    return 0;
+}
+
+int bitbang_spi_init(uint8_t sck_pin, uint8_t mosi_pin, uint8_t miso_pin, uint8_t cs_pin,
+                     uint32_t mode, uint32_t speed)
+{
+    /* Chip select is deselected before the clock is configured */
+    const uint8_t pins[SPI_PIN_CNT] = { cs_pin, sck_pin, mosi_pin, miso_pin };
+    const uint8_t directions[SPI_PIN_CNT] = { GPIO_OUTPUT, GPIO_OUTPUT, GPIO_OUTPUT, GPIO_INPUT };
+    const uint8_t values[SPI_PIN_CNT] = { 1, (mode >> 1) & 1, 0, 0 };
+    unsigned int acquired;
+
+    if (spi.initialised) {
+        fprintf(stderr, "bitbang: SPI bus already initialised.\n");
+        return -1;
+    }
+
+    if (mode > 3) {
+        fprintf(stderr, "bitbang: Invalid SPI mode.\n");
+        return -1;
+    }
+
+    if (speed == 0) {
+        fprintf(stderr, "bitbang: Invalid SPI speed.\n");
+        return -1;
+    }
+
+    spi.sck = sck_pin;
+    spi.mosi = mosi_pin;
+    spi.miso = miso_pin;
+    spi.cs = cs_pin;
+    spi.cpol = (mode >> 1) & 1;
+    spi.cpha = mode & 1;
+    spi.half_period = speed_to_half_period(speed);
+
+    for (acquired = 0; acquired < SPI_PIN_CNT; ++acquired) {
+        if (acquire_pin(pins[acquired], directions[acquired], values[acquired]) < 0) {
+            fprintf(stderr, "bitbang: Failed to initialise SPI pins.\n");
+            relinquish_pins(pins, acquired);
+            return -1;
+        }
+    }
+
+    spi.initialised = true;
+
+    return 0;
+}
+
+static int spi_transfer_byte(uint8_t tx, uint8_t *rx)
+{
+    uint8_t active = !spi.cpol, idle = spi.cpol;
+    int bit;
+
+    *rx = 0;
+    for (bit = 7; bit >= 0; --bit) {
+        uint8_t value;
+
+        if (spi.cpha == 0) {
+            /* Data is sampled on leading edge */
+            if (gpio_set_value(spi.mosi, (tx >> bit) & 1) < 0)
+                return -1;
+            delay_ns(spi.half_period);
+            if (gpio_set_value(spi.sck, active) < 0
+            ||  gpio_get_value(spi.miso, &value) < 0)
+                return -1;
+            delay_ns(spi.half_period);
+            if (gpio_set_value(spi.sck, idle) < 0)
+                return -1;
+        } else {
+            /* Data is sampled on trailing edge */
+            if (gpio_set_value(spi.sck, active) < 0
+            ||  gpio_set_value(spi.mosi, (tx >> bit) & 1) < 0)
+                return -1;
+            delay_ns(spi.half_period);
+            if (gpio_set_value(spi.sck, idle) < 0
+            ||  gpio_get_value(spi.miso, &value) < 0)
+                return -1;
+            delay_ns(spi.half_period);
+        }
+
+        *rx |= value << bit;
+    }
+
+    return 0;
+}
+
+int bitbang_spi_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
+{
+    uint32_t i;
+    int ret = count;
+
+    if (!spi.initialised) {
+        fprintf(stderr, "bitbang: SPI bus not initialised.\n");
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    if (tx_buffer == NULL && rx_buffer == NULL) {
+        fprintf(stderr, "bitbang: Both buffers are null.\n");
+        return -1;
+    }
+
+    if (gpio_set_value(spi.cs, 0) < 0)
+        return -1;
+    delay_ns(spi.half_period);
+
+    for (i = 0; i < count; ++i) {
+        uint8_t rx;
+
+        if (spi_transfer_byte(tx_buffer != NULL ? tx_buffer[i] : 0, &rx) < 0) {
+            fprintf(stderr, "bitbang: Failed to transfer byte over SPI.\n");
+            ret = -1;
+            break;
+        }
+
+        if (rx_buffer != NULL)
+            rx_buffer[i] = rx;
+    }
+
+    delay_ns(spi.half_period);
+    if (gpio_set_value(spi.cs, 1) < 0)
+        return -1;
+
+    return ret;
+}
+
+int bitbang_spi_release(void)
+{
+    const uint8_t pins[SPI_PIN_CNT] = { spi.cs, spi.sck, spi.mosi, spi.miso };
+
+    if (!spi.initialised)
+        return 0;
+
+    spi.initialised = false;
+
+    return relinquish_pins(pins, SPI_PIN_CNT);
+}
+
+int bitbang_i2c_init(uint8_t sda_pin, uint8_t scl_pin, uint32_t speed)
+{
+    if (i2c.initialised) {
+        fprintf(stderr, "bitbang: I2C bus already initialised.\n");
+        return -1;
+    }
+
+    if (speed == 0) {
+        fprintf(stderr, "bitbang: Invalid I2C speed.\n");
+        return -1;
+    }
+
+    i2c.sda = sda_pin;
+    i2c.scl = scl_pin;
+    i2c.half_period = speed_to_half_period(speed);
+
+    if (acquire_open_drain_pin(sda_pin) < 0) {
+        fprintf(stderr, "bitbang: Failed to initialise I2C pins.\n");
+        return -1;
+    }
+
+    if (acquire_open_drain_pin(scl_pin) < 0) {
+        fprintf(stderr, "bitbang: Failed to initialise I2C pins.\n");
+        gpio_relinquish(sda_pin);
+        return -1;
+    }
+
+    i2c.initialised = true;
+
+    return 0;
+}
+
+/* Release SCL and wait for slaves to stop stretching the clock */
+static int i2c_release_scl(void)
+{
+    uint64_t timeout;
+    uint8_t value = 0;
+
+    if (set_open_drain(i2c.scl, 1) < 0)
+        return -1;
+
+    timeout = get_time_ns() + I2C_CLOCK_STRETCH_TIMEOUT;
+    do {
+        if (gpio_get_value(i2c.scl, &value) < 0)
+            return -1;
+    } while (value == 0 && get_time_ns() < timeout);
+
+    if (value == 0) {
+        fprintf(stderr, "bitbang: I2C clock held low by slave.\n");
+        return -1;
+    }
+
+    delay_ns(i2c.half_period);
+    return 0;
+}
+
+static int i2c_start(void)
+{
+    if (set_open_drain(i2c.sda, 1) < 0
+    ||  i2c_release_scl() < 0
+    ||  set_open_drain(i2c.sda, 0) < 0)
+        return -1;
+    delay_ns(i2c.half_period);
+
+    return set_open_drain(i2c.scl, 0);
+}
+
+static int i2c_stop(void)
+{
+    if (set_open_drain(i2c.sda, 0) < 0)
+        return -1;
+    delay_ns(i2c.half_period);
+
+    if (i2c_release_scl() < 0
+    ||  set_open_drain(i2c.sda, 1) < 0)
+        return -1;
+    delay_ns(i2c.half_period);
+
+    return 0;
+}
+
+static int i2c_write_bit(uint8_t bit)
+{
+    if (set_open_drain(i2c.sda, bit) < 0)
+        return -1;
+    delay_ns(i2c.half_period);
+
+    if (i2c_release_scl() < 0)
+        return -1;
+
+    return set_open_drain(i2c.scl, 0);
+}
+
+static int i2c_read_bit(uint8_t *bit)
+{
+    if (set_open_drain(i2c.sda, 1) < 0)
+        return -1;
+    delay_ns(i2c.half_period);
+
+    if (i2c_release_scl() < 0
+    ||  gpio_get_value(i2c.sda, bit) < 0)
+        return -1;
+
+    return set_open_drain(i2c.scl, 0);
+}
+
+/* Return 0 if slave acknowledged the byte */
+static int i2c_write_byte(uint8_t data)
+{
+    uint8_t nack;
+    int bit;
+
+    for (bit = 7; bit >= 0; --bit) {
+        if (i2c_write_bit((data >> bit) & 1) < 0)
+            return -1;
+    }
+
+    if (i2c_read_bit(&nack) < 0)
+        return -1;
+
+    if (nack) {
+        fprintf(stderr, "bitbang: I2C slave did not acknowledge byte.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int i2c_read_byte(uint8_t *data, bool ack)
+{
+    int bit;
+
+    *data = 0;
+    for (bit = 7; bit >= 0; --bit) {
+        uint8_t value;
+
+        if (i2c_read_bit(&value) < 0)
+            return -1;
+        *data |= value << bit;
+    }
+
+    return i2c_write_bit(ack ? 0 : 1);
+}
+
+int bitbang_i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count)
+{
+    uint32_t i;
+    int ret = count;
+
+    if (!i2c.initialised) {
+        fprintf(stderr, "bitbang: I2C bus not initialised.\n");
+        return -1;
+    }
+
+    if (buffer == NULL) {
+        fprintf(stderr, "bitbang: Cannot write to I2C slave using null buffer.\n");
+        return -1;
+    }
+
+    if (slave_address > 0x7F) {
+        fprintf(stderr, "bitbang: Only 7-bit I2C addresses are supported.\n");
+        return -1;
+    }
+
+    if (i2c_start() < 0)
+        return -1;
+
+    if (i2c_write_byte(slave_address << 1) < 0) {
+        ret = -1;
+    } else {
+        for (i = 0; i < count; ++i) {
+            if (i2c_write_byte(buffer[i]) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    if (i2c_stop() < 0)
+        return -1;
+
+    return ret;
+}
+
+int bitbang_i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count)
+{
+    uint32_t i;
+    int ret = count;
+
+    if (!i2c.initialised) {
+        fprintf(stderr, "bitbang: I2C bus not initialised.\n");
+        return -1;
+    }
+
+    if (buffer == NULL) {
+        fprintf(stderr, "bitbang: Cannot read from I2C slave using null buffer.\n");
+        return -1;
+    }
+
+    if (slave_address > 0x7F) {
+        fprintf(stderr, "bitbang: Only 7-bit I2C addresses are supported.\n");
+        return -1;
+    }
+
+    if (i2c_start() < 0)
+        return -1;
+
+    if (i2c_write_byte((slave_address << 1) | 1) < 0) {
+        ret = -1;
+    } else {
+        /* Last byte is not acknowledged to let slave release SDA */
+        for (i = 0; i < count; ++i) {
+            if (i2c_read_byte(&buffer[i], i + 1 < count) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    if (i2c_stop() < 0)
+        return -1;
+
+    return ret;
+}
+
+int bitbang_i2c_release(void)
+{
+    const uint8_t pins[] = { i2c.sda, i2c.scl };
+
+    if (!i2c.initialised)
+        return 0;
+
+    i2c.initialised = false;
+
+    return relinquish_pins(pins, 2);
+}
+
+/* Longest GPIO access, measured without changing the state of the line */
+static uint64_t measure_onewire_access_time(void)
+{
+    uint64_t start, duration, max_duration = 0;
+    unsigned int i;
+    uint8_t value;
+
+    for (i = 0; i < ONEWIRE_CALIBRATION_CNT; ++i) {
+        start = get_time_ns();
+        if (set_open_drain(onewire.pin, 1) < 0)
+            return UINT64_MAX;
+        duration = get_time_ns() - start;
+        if (duration > max_duration)
+            max_duration = duration;
+
+        start = get_time_ns();
+        if (gpio_get_value(onewire.pin, &value) < 0)
+            return UINT64_MAX;
+        duration = get_time_ns() - start;
+        if (duration > max_duration)
+            max_duration = duration;
+    }
+
+    return max_duration;
+}
+
+static int check_onewire_deadline(uint64_t deadline)
+{
+    if (get_time_ns() > deadline + ONEWIRE_MAX_ACCESS_TIME) {
+        fprintf(stderr, "bitbang: 1-Wire timing was not met.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int bitbang_onewire_init(uint8_t pin)
+{
+    uint64_t access_time;
+
+    if (onewire.initialised) {
+        fprintf(stderr, "bitbang: 1-Wire bus already initialised.\n");
+        return -1;
+    }
+
+    if (gpio_get_backend() != GPIO_BACKEND_CHARDEV) {
+        fprintf(stderr, "bitbang: 1-Wire bus requires the GPIO character device backend.\n");
+        return -1;
+    }
+
+    if (acquire_open_drain_pin(pin) < 0) {
+        fprintf(stderr, "bitbang: Failed to initialise 1-Wire pin.\n");
+        return -1;
+    }
+
+    onewire.pin = pin;
+    access_time = measure_onewire_access_time();
+    if (access_time > ONEWIRE_MAX_ACCESS_TIME) {
+        fprintf(stderr, "bitbang: GPIO accesses are too slow for 1-Wire bus (%llu ns).\n",
+                (unsigned long long)access_time);
+        gpio_relinquish(pin);
+        return -1;
+    }
+
+    onewire.initialised = true;
+
+    return 0;
+}
+
+int bitbang_onewire_reset(void)
+{
+    uint64_t start;
+    uint8_t value;
+
+    if (!onewire.initialised) {
+        fprintf(stderr, "bitbang: 1-Wire bus not initialised.\n");
+        return -1;
+    }
+
+    if (set_open_drain(onewire.pin, 0) < 0)
+        return -1;
+    wait_until(get_time_ns() + ONEWIRE_RESET_LOW);
+
+    if (set_open_drain(onewire.pin, 1) < 0)
+        return -1;
+    start = get_time_ns();
+    wait_until(start + ONEWIRE_PRESENCE_WAIT);
+
+    /* Devices pull the line low to signal their presence */
+    if (gpio_get_value(onewire.pin, &value) < 0
+    ||  check_onewire_deadline(start + ONEWIRE_PRESENCE_WAIT) < 0)
+        return -1;
+    wait_until(start + ONEWIRE_PRESENCE_WAIT + ONEWIRE_RESET_RECOVERY);
+
+    return value == 0;
+}
+
+static int onewire_write_bit(uint8_t bit)
+{
+    uint64_t start;
+
+    if (set_open_drain(onewire.pin, 0) < 0)
+        return -1;
+    start = get_time_ns();
+    wait_until(start + (bit ? ONEWIRE_WRITE_1_LOW : ONEWIRE_WRITE_0_LOW));
+
+    if (set_open_drain(onewire.pin, 1) < 0)
+        return -1;
+
+    /* Line must be high again before devices sample it */
+    if (bit && check_onewire_deadline(start + ONEWIRE_WRITE_1_LOW) < 0)
+        return -1;
+    wait_until(start + ONEWIRE_SLOT);
+
+    return 0;
+}
+
+static int onewire_read_bit(uint8_t *bit)
+{
+    uint64_t start;
+
+    if (set_open_drain(onewire.pin, 0) < 0)
+        return -1;
+    start = get_time_ns();
+    wait_until(start + ONEWIRE_READ_LOW);
+
+    if (set_open_drain(onewire.pin, 1) < 0)
+        return -1;
+    wait_until(start + ONEWIRE_READ_SAMPLE);
+
+    if (gpio_get_value(onewire.pin, bit) < 0
+    ||  check_onewire_deadline(start + ONEWIRE_READ_SAMPLE) < 0)
+        return -1;
+    wait_until(start + ONEWIRE_SLOT);
+
+    return 0;
+}
+
+int bitbang_onewire_write(const uint8_t *buffer, uint32_t count)
+{
+    uint32_t i;
+    int bit;
+
+    if (!onewire.initialised) {
+        fprintf(stderr, "bitbang: 1-Wire bus not initialised.\n");
+        return -1;
+    }
+
+    if (buffer == NULL) {
+        fprintf(stderr, "bitbang: Cannot write to 1-Wire bus using null buffer.\n");
+        return -1;
+    }
+
+    for (i = 0; i < count; ++i) {
+        for (bit = 0; bit < 8; ++bit) {
+            if (onewire_write_bit((buffer[i] >> bit) & 1) < 0) {
+                fprintf(stderr, "bitbang: Failed to write to 1-Wire bus.\n");
+                return -1;
+            }
+        }
+    }
+
+    return count;
+}
+
+int bitbang_onewire_read(uint8_t *buffer, uint32_t count)
+{
+    uint32_t i;
+    int bit;
+
+    if (!onewire.initialised) {
+        fprintf(stderr, "bitbang: 1-Wire bus not initialised.\n");
+        return -1;
+    }
+
+    if (buffer == NULL) {
+        fprintf(stderr, "bitbang: Cannot read from 1-Wire bus using null buffer.\n");
+        return -1;
+    }
+
+    for (i = 0; i < count; ++i) {
+        buffer[i] = 0;
+        for (bit = 0; bit < 8; ++bit) {
+            uint8_t value;
+
+            if (onewire_read_bit(&value) < 0) {
+                fprintf(stderr, "bitbang: Failed to read from 1-Wire bus.\n");
+                return -1;
+            }
+            buffer[i] |= value << bit;
+        }
+    }
+
+    return count;
+}
+
+int bitbang_onewire_release(void)
+{
+    if (!onewire.initialised)
+        return 0;
+
+    onewire.initialised = false;
+
+    return gpio_relinquish(onewire.pin);
+}
@@ -1,5 +1,8 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,8 +11,289 @@
 #include <unistd.h>
 #include "letmecreate/core/common.h"
 
+#ifdef LETMECREATE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*
+ * Minimal io_uring used by write_batch_submit. The ring is created the first
+ * time a batch is submitted and kept until the process exits. Liburing is not
+ * used to avoid an extra dependency, the ring is accessed through the raw
+ * syscalls and the mmap'ed queues.
+ */
+struct ring {
+    int fd;
+    uint32_t *sq_tail, *sq_mask, *sq_array;
+    uint32_t *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+};
+
+enum RING_STATE {
+    RING_UNINITIALISED,
+    RING_READY,
+    RING_UNAVAILABLE
+};
+
+static struct ring ring;
+static int ring_state = RING_UNINITIALISED;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool is_write_supported(int fd)
+{
+    size_t probe_size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    bool supported = false;
 
-int write_str_file(const char *path, const char *str)
+    if (probe == NULL)
+        return false;
+
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0
+    &&  probe->last_op >= IORING_OP_WRITE)
+        supported = probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED;
+
+    free(probe);
+
+    return supported;
+}
+
+static int ring_init(void)
+{
+    struct io_uring_params params;
+    size_t sq_size, cq_size;
+    uint8_t *sq_ptr, *cq_ptr;
+    void *sqes;
+    int fd;
+
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, MAX_BATCH_WRITE_CNT, &params);
+    if (fd < 0)
+        return -1;
+
+    if (!is_write_supported(fd)) {
+        close(fd);
+        return -1;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size)
+            sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    sq_ptr = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ptr = sq_ptr;
+    } else {
+        cq_ptr = mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED) {
+            munmap(sq_ptr, sq_size);
+            close(fd);
+            return -1;
+        }
+    }
+
+    sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ptr != sq_ptr)
+            munmap(cq_ptr, cq_size);
+        munmap(sq_ptr, sq_size);
+        close(fd);
+        return -1;
+    }
+
+    ring.fd = fd;
+    ring.sq_tail = (uint32_t *)(sq_ptr + params.sq_off.tail);
+    ring.sq_mask = (uint32_t *)(sq_ptr + params.sq_off.ring_mask);
+    ring.sq_array = (uint32_t *)(sq_ptr + params.sq_off.array);
+    ring.cq_head = (uint32_t *)(cq_ptr + params.cq_off.head);
+    ring.cq_tail = (uint32_t *)(cq_ptr + params.cq_off.tail);
+    ring.cq_mask = (uint32_t *)(cq_ptr + params.cq_off.ring_mask);
+    ring.sqes = sqes;
+    ring.cqes = (struct io_uring_cqe *)(cq_ptr + params.cq_off.cqes);
+
+    return 0;
+}
+
+/*
+ * Wait for the completion of the first cnt writes submitted. Return 0 if all
+ * of them succeeded, -1 if a write failed, -2 if waiting failed.
+ */
+static int ring_wait(const struct write_batch *batch, uint32_t cnt)
+{
+    uint32_t head, completed = 0;
+    int ret = 0;
+
+    while (completed < cnt) {
+        head = *ring.cq_head;
+        if (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+            if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+            &&  errno != EINTR) {
+                fprintf(stderr, "Failed to wait for completion of batch of writes.\n");
+                return -2;
+            }
+            continue;
+        }
+
+        if (ring.cqes[head & *ring.cq_mask].res < 0 && ret == 0) {
+            fprintf(stderr, "Failed to write to file descriptor %d\n",
+                    batch->fds[ring.cqes[head & *ring.cq_mask].user_data]);
+            ret = -1;
+        }
+
+        __atomic_store_n(ring.cq_head, head + 1, __ATOMIC_RELEASE);
+        ++completed;
+    }
+
+    return ret;
+}
+
+/*
+ * Writes are linked so that each one starts when the previous one completed,
+ * and the remaining ones are cancelled if one fails.
+ *
+ * Return 0 if all writes succeeded, -1 if a write failed, -2 if no write was
+ * submitted. The writes can only be performed again by the caller in the
+ * last case: once some of them reached the kernel, replaying the batch would
+ * perform them twice. If the ring is left in an unknown state, it is not used
+ * anymore.
+ */
+static int ring_submit(const struct write_batch *batch)
+{
+    uint32_t i, tail;
+    long submitted;
+    int ret;
+
+    tail = *ring.sq_tail;
+    for (i = 0; i < batch->cnt; ++i) {
+        uint32_t index = (tail + i) & *ring.sq_mask;
+        struct io_uring_sqe *sqe = &ring.sqes[index];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = batch->fds[i];
+        sqe->addr = (uintptr_t)batch->strs[i];
+        sqe->len = strlen(batch->strs[i]) + 1;
+        sqe->off = 0;
+        sqe->user_data = i;
+        if (i + 1 < batch->cnt)
+            sqe->flags = IOSQE_IO_LINK;
+        ring.sq_array[index] = index;
+    }
+    __atomic_store_n(ring.sq_tail, tail + batch->cnt, __ATOMIC_RELEASE);
+
+    submitted = syscall(__NR_io_uring_enter, ring.fd, batch->cnt, batch->cnt, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted <= 0) {
+        /* Entries left in the submission queue would be submitted with the next batch */
+        ring_state = RING_UNAVAILABLE;
+        return -2;
+    }
+
+    /*
+     * Completions of the writes submitted must be consumed even if the batch
+     * failed, otherwise they would be counted as part of the next batch.
+     */
+    ret = ring_wait(batch, submitted);
+    if (ret == -2 || submitted != (long)batch->cnt) {
+        if (submitted != (long)batch->cnt)
+            fprintf(stderr, "Only %ld writes out of %u were submitted.\n", submitted, batch->cnt);
+        ring_state = RING_UNAVAILABLE;
+        return -1;
+    }
+
+    return ret;
+}
+
+/* Return 0 if all writes succeeded, -1 if a write failed, -2 if io_uring is not available */
+static int write_batch_submit_ring(const struct write_batch *batch)
+{
+    int ret = -2;
+
+    pthread_mutex_lock(&ring_mutex);
+
+    if (ring_state == RING_UNINITIALISED)
+        ring_state = ring_init() == 0 ? RING_READY : RING_UNAVAILABLE;
+
+    if (ring_state == RING_READY)
+        ret = ring_submit(batch);
+
+    pthread_mutex_unlock(&ring_mutex);
+
+    return ret;
+}
+#else
+static int write_batch_submit_ring(const struct write_batch *batch)
+{
+    return -2;
+}
+#endif
+
+
+static char device_root[MAX_STR_LENGTH];
+static bool device_root_initialised = false;
+
+int set_device_root(const char *root)
+{
+    if (root == NULL)
+        root = "";
+
+    if (strlen(root) >= MAX_STR_LENGTH) {
+        fprintf(stderr, "Device root %s is too long.\n", root);
+        return -1;
+    }
+
+    strcpy(device_root, root);
+    device_root_initialised = true;
+
+    return 0;
+}
+
+const char *get_device_root(void)
+{
+    if (!device_root_initialised) {
+        if (set_device_root(getenv("LETMECREATE_DEVICE_ROOT")) < 0)
+            set_device_root(NULL);
+    }
+
+    return device_root;
+}
+
+int create_device_path(char *path, const char *format, ...)
+{
+    const char *root = get_device_root();
+    size_t root_length = strlen(root);
+    va_list args;
+    int ret;
+
+    if (path == NULL || format == NULL) {
+        fprintf(stderr, "Cannot create path to device file using null pointer.\n");
+        return -1;
+    }
+
+    strcpy(path, root);
+
+    va_start(args, format);
+    ret = vsnprintf(&path[root_length], MAX_STR_LENGTH - root_length, format, args);
+    va_end(args);
+
+    if (ret < 0 || (size_t)ret >= MAX_STR_LENGTH - root_length) {
+        fprintf(stderr, "Failed to create path to device file.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int open_device_file(const char *path, int flags)
 {
     int fd = -1;
 
@@ -18,28 +302,35 @@ int write_str_file(const char *path, const char *str)
         return -1;
     }
 
-    if (str == NULL) {
-        fprintf(stderr, "Cannot write null string to file %s.\n", path);
+    if ((fd = open(path, flags)) < 0) {
+        fprintf(stderr, "Failed to open file %s\n", path);
         return -1;
     }
 
-    if ((fd = open(path, O_WRONLY)) < 0) {
-        fprintf(stderr, "Failed to open file %s\n", path);
+    return fd;
+}
+
+int write_str_fd(int fd, const char *str)
+{
+    if (fd < 0) {
+        fprintf(stderr, "Cannot write to invalid file descriptor.\n");
         return -1;
     }
 
-    if (write(fd, str, strlen(str)+1) < 0) {
-        fprintf(stderr, "Failed to write to file %s\n", path);
-        close(fd);
+    if (str == NULL) {
+        fprintf(stderr, "Cannot write null string to file descriptor %d.\n", fd);
         return -1;
     }
 
-    close(fd);
+    if (pwrite(fd, str, strlen(str)+1, 0) < 0) {
+        fprintf(stderr, "Failed to write to file descriptor %d\n", fd);
+        return -1;
+    }
 
     return 0;
 }
 
-int write_int_file(const char *path, uint32_t value)
+int write_int_fd(int fd, uint32_t value)
 {
     char str[MAX_STR_LENGTH];
 
@@ -48,34 +339,117 @@ int write_int_file(const char *path, uint32_t value)
         return -1;
     }
 
-    return write_str_file(path, str);
+    return write_str_fd(fd, str);
 }
 
-int read_str_file(const char *path, char *str, uint32_t max_str_length)
+void write_batch_init(struct write_batch *batch)
 {
-    int fd = -1;
+    if (batch != NULL)
+        batch->cnt = 0;
+}
 
-    if ((fd = open(path, O_RDONLY)) < 0) {
-        fprintf(stderr, "Failed to open file %s\n", path);
+int write_batch_add_str(struct write_batch *batch, int fd, const char *str)
+{
+    if (batch == NULL || str == NULL) {
+        fprintf(stderr, "Cannot add write to batch using null pointer.\n");
         return -1;
     }
 
-    if (read(fd, str, max_str_length) < 0) {
-        fprintf(stderr, "Failed to read from file %s\n", path);
-        close(fd);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot add write to invalid file descriptor to batch.\n");
         return -1;
     }
 
-    close(fd);
+    if (batch->cnt >= MAX_BATCH_WRITE_CNT) {
+        fprintf(stderr, "Batch of writes is full.\n");
+        return -1;
+    }
+
+    if (strlen(str) >= MAX_BATCH_STR_LENGTH) {
+        fprintf(stderr, "String %s is too long to be added to a batch.\n", str);
+        return -1;
+    }
+
+    batch->fds[batch->cnt] = fd;
+    strcpy(batch->strs[batch->cnt], str);
+    ++batch->cnt;
 
     return 0;
 }
 
-int read_int_file(const char *path, uint32_t *value)
+int write_batch_add_int(struct write_batch *batch, int fd, uint32_t value)
+{
+    char str[MAX_BATCH_STR_LENGTH];
+
+    if (snprintf(str, MAX_BATCH_STR_LENGTH, "%d", value) < 0) {
+        fprintf(stderr, "Failed to convert integer %d to string.\n", value);
+        return -1;
+    }
+
+    return write_batch_add_str(batch, fd, str);
+}
+
+int write_batch_submit(struct write_batch *batch)
+{
+    uint32_t i;
+    int ret;
+
+    if (batch == NULL) {
+        fprintf(stderr, "Cannot submit null batch of writes.\n");
+        return -1;
+    }
+
+    if (batch->cnt == 0)
+        return 0;
+
+    /* A single write does not benefit from io_uring */
+    ret = -2;
+    if (batch->cnt > 1)
+        ret = write_batch_submit_ring(batch);
+
+    if (ret == -2) {
+        ret = 0;
+        for (i = 0; i < batch->cnt; ++i) {
+            if (write_str_fd(batch->fds[i], batch->strs[i]) < 0) {
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    batch->cnt = 0;
+
+    return ret;
+}
+
+int read_str_fd(int fd, char *str, uint32_t max_str_length)
+{
+    ssize_t ret;
+
+    if (fd < 0) {
+        fprintf(stderr, "Cannot read from invalid file descriptor.\n");
+        return -1;
+    }
+
+    if (str == NULL || max_str_length == 0) {
+        fprintf(stderr, "Cannot store string read from file descriptor %d.\n", fd);
+        return -1;
+    }
+
+    if ((ret = pread(fd, str, max_str_length - 1, 0)) < 0) {
+        fprintf(stderr, "Failed to read from file descriptor %d\n", fd);
+        return -1;
+    }
+    str[ret] = '\0';
+
+    return 0;
+}
+
+int read_int_fd(int fd, uint32_t *value)
 {
     char str[MAX_STR_LENGTH];
 
-    if (read_str_file(path, str, MAX_STR_LENGTH) < 0)
+    if (read_str_fd(fd, str, MAX_STR_LENGTH) < 0)
         return -1;
 
     errno = 0;
@@ -88,6 +462,62 @@ int read_int_file(const char *path, uint32_t *value)
     return 0;
 }
 
+int write_str_file(const char *path, const char *str)
+{
+    int fd = -1, ret;
+
+    if (str == NULL) {
+        fprintf(stderr, "Cannot write null string to file %s.\n", path);
+        return -1;
+    }
+
+    if ((fd = open_device_file(path, O_WRONLY)) < 0)
+        return -1;
+
+    ret = write_str_fd(fd, str);
+    close(fd);
+
+    return ret;
+}
+
+int write_int_file(const char *path, uint32_t value)
+{
+    char str[MAX_STR_LENGTH];
+
+    if (snprintf(str, MAX_STR_LENGTH, "%d", value) < 0) {
+        fprintf(stderr, "Failed to convert integer %d to string.\n", value);
+        return -1;
+    }
+
+    return write_str_file(path, str);
+}
+
+int read_str_file(const char *path, char *str, uint32_t max_str_length)
+{
+    int fd = -1, ret;
+
+    if ((fd = open_device_file(path, O_RDONLY)) < 0)
+        return -1;
+
+    ret = read_str_fd(fd, str, max_str_length);
+    close(fd);
+
+    return ret;
+}
+
+int read_int_file(const char *path, uint32_t *value)
+{
+    int fd = -1, ret;
+
+    if ((fd = open_device_file(path, O_RDONLY)) < 0)
+        return -1;
+
+    ret = read_int_fd(fd, value);
+    close(fd);
+
+    return ret;
+}
+
 int export_pin(const char *dir_path, uint32_t pin_no)
 {
     int fd = -1;
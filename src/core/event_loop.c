@@ -0,0 +1,543 @@
+/*
+ * Every source is stored in a fixed table. The epoll event of a source
+ * carries its index and a generation number, incremented when the source is
+ * removed, so that events already returned by epoll_wait for a removed source
+ * are ignored.
+ *
+ * The event loop reads the table without taking any lock: the generation of
+ * a source is checked before and after reading its handler, like a sequence
+ * lock. dispatch_seq is odd while the event loop handles a batch of events.
+ * Removing a source from another thread waits for it to change, so the
+ * handler cannot be running anymore once the source is removed.
+ *
+ * The clock is read as soon as epoll_wait returns, before any handler runs,
+ * so that sources without timestamps of their own get the closest time to
+ * the wake up of the event loop.
+ */
+
+#define _GNU_SOURCE             /* pthread_attr_setaffinity_np */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "letmecreate/core/event_loop.h"
+
+#define MAX_SOURCE_CNT      (32)
+#define MAX_EVENT_CNT       (16)
+#define STOP_SOURCE_INDEX   (0xFFFFFFFF)
+#define MAX_CPU_CNT         (32)
+
+struct source {
+    int fd;                 /* -1 if source is not used */
+    uint32_t generation;
+    void (*handler)(uint32_t, void *);
+    void *arg;
+};
+
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;      /* Serialises init and release */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;           /* Serialises writers of sources and reference count */
+static uint32_t dispatch_seq = 0;
+static __thread bool is_dispatching = false;
+static __thread uint64_t wakeup_time = 0;          /* Time at which epoll_wait returned */
+static bool polling = false;                        /* Set while a thread runs letmecreate_poll */
+
+static struct source sources[MAX_SOURCE_CNT];
+static uint32_t reference_cnt = 0;
+static uint8_t mode = EVENT_LOOP_THREAD;
+static int epoll_fd = -1;
+static int stop_fd = -1;    /* eventfd waking up the thread on release */
+static pthread_t thread;
+
+/* Attributes of threads started by the library, protected by mutex */
+static uint8_t thread_policy = THREAD_POLICY_DEFAULT;
+static uint8_t thread_priority = 0;
+static uint32_t thread_cpu_mask = 0;
+static uint32_t thread_stack_size = 0;
+
+
+static uint64_t get_timestamp(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* Return true if the stop event was received */
+static bool dispatch(const struct epoll_event *events, int event_cnt)
+{
+    bool stop = false;
+    int i;
+
+    wakeup_time = get_timestamp();
+    is_dispatching = true;
+    __atomic_add_fetch(&dispatch_seq, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < event_cnt; ++i) {
+        struct source *source = NULL;
+        uint32_t index = events[i].data.u64 & 0xFFFFFFFF;
+        uint32_t generation = events[i].data.u64 >> 32;
+        void (*handler)(uint32_t, void *) = NULL;
+        void *arg = NULL;
+
+        if (index == STOP_SOURCE_INDEX) {
+            stop = true;
+            continue;
+        }
+
+        /* Source may have been removed, and its slot reused, by a handler or another thread */
+        source = &sources[index];
+        if (__atomic_load_n(&source->generation, __ATOMIC_SEQ_CST) != generation
+        ||  __atomic_load_n(&source->fd, __ATOMIC_ACQUIRE) < 0)
+            continue;
+        handler = __atomic_load_n(&source->handler, __ATOMIC_RELAXED);
+        arg = __atomic_load_n(&source->arg, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&source->generation, __ATOMIC_RELAXED) != generation)
+            continue;
+
+        handler(events[i].events, arg);
+    }
+    __atomic_add_fetch(&dispatch_seq, 1, __ATOMIC_SEQ_CST);
+    is_dispatching = false;
+
+    return stop;
+}
+
+/* Wait until the event loop is done with the batch of events it handles, if any */
+static void wait_for_dispatch(void)
+{
+    uint32_t seq = __atomic_load_n(&dispatch_seq, __ATOMIC_SEQ_CST);
+
+    if ((seq & 1) == 0)
+        return;
+
+    while (__atomic_load_n(&dispatch_seq, __ATOMIC_ACQUIRE) == seq)
+        sched_yield();
+}
+
+static void* run_event_loop(void *arg)
+{
+    while (true) {
+        struct epoll_event events[MAX_EVENT_CNT];
+        int event_cnt;
+
+        event_cnt = epoll_wait(epoll_fd, events, MAX_EVENT_CNT, -1);
+        if (event_cnt < 0)
+            continue;
+
+        if (dispatch(events, event_cnt))
+            break;
+    }
+
+    return NULL;
+}
+
+static void close_fds(void)
+{
+    if (stop_fd >= 0)
+        close(stop_fd);
+    stop_fd = -1;
+
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    epoll_fd = -1;
+}
+
+int event_loop_select_mode(uint8_t new_mode)
+{
+    int ret = 0;
+
+    if (new_mode != EVENT_LOOP_THREAD && new_mode != EVENT_LOOP_POLL) {
+        fprintf(stderr, "event_loop: Invalid mode.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt > 0) {
+        fprintf(stderr, "event_loop: Cannot change mode while event loop is used.\n");
+        ret = -1;
+    } else {
+        mode = new_mode;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+uint8_t event_loop_get_mode(void)
+{
+    return mode;
+}
+
+int event_loop_set_thread_scheduling(uint8_t policy, uint8_t priority)
+{
+    int ret = 0;
+
+    switch (policy) {
+    case THREAD_POLICY_DEFAULT:
+        priority = 0;
+        break;
+    case THREAD_POLICY_FIFO:
+    case THREAD_POLICY_RR:
+        if (priority < sched_get_priority_min(SCHED_FIFO)
+        ||  priority > sched_get_priority_max(SCHED_FIFO)) {
+            fprintf(stderr, "event_loop: Invalid priority.\n");
+            return -1;
+        }
+        break;
+    default:
+        fprintf(stderr, "event_loop: Invalid scheduling policy.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt > 0) {
+        fprintf(stderr, "event_loop: Cannot change thread attributes while event loop is used.\n");
+        ret = -1;
+    } else {
+        thread_policy = policy;
+        thread_priority = priority;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+int event_loop_set_thread_affinity(uint32_t cpu_mask)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt > 0) {
+        fprintf(stderr, "event_loop: Cannot change thread attributes while event loop is used.\n");
+        ret = -1;
+    } else {
+        thread_cpu_mask = cpu_mask;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+int event_loop_set_thread_stack_size(uint32_t stack_size)
+{
+    int ret = 0;
+
+    if (stack_size != 0 && stack_size < PTHREAD_STACK_MIN) {
+        fprintf(stderr, "event_loop: Stack size must be at least %ld bytes.\n", (long)PTHREAD_STACK_MIN);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt > 0) {
+        fprintf(stderr, "event_loop: Cannot change thread attributes while event loop is used.\n");
+        ret = -1;
+    } else {
+        thread_stack_size = stack_size;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    return ret;
+}
+
+int event_loop_lock_memory(uint8_t enable)
+{
+    if (enable) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+            fprintf(stderr, "event_loop: Failed to lock memory.\n");
+            return -1;
+        }
+    } else if (munlockall() < 0) {
+        fprintf(stderr, "event_loop: Failed to unlock memory.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int event_loop_create_thread(pthread_t *new_thread, void *(*start_routine)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    int ret = 0;
+
+    if (new_thread == NULL || start_routine == NULL) {
+        fprintf(stderr, "event_loop: Cannot start thread with null pointer.\n");
+        return -1;
+    }
+
+    if (pthread_attr_init(&attr) != 0) {
+        fprintf(stderr, "event_loop: Failed to initialise thread attributes.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (thread_policy != THREAD_POLICY_DEFAULT) {
+        struct sched_param param = { .sched_priority = thread_priority };
+        int policy = thread_policy == THREAD_POLICY_FIFO ? SCHED_FIFO : SCHED_RR;
+
+        if (pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) != 0
+        ||  pthread_attr_setschedpolicy(&attr, policy) != 0
+        ||  pthread_attr_setschedparam(&attr, &param) != 0) {
+            fprintf(stderr, "event_loop: Failed to set scheduling policy.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && thread_cpu_mask != 0) {
+        cpu_set_t cpu_set;
+        uint32_t i;
+
+        CPU_ZERO(&cpu_set);
+        for (i = 0; i < MAX_CPU_CNT; ++i) {
+            if (thread_cpu_mask & (1U << i))
+                CPU_SET(i, &cpu_set);
+        }
+        if (pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set) != 0) {
+            fprintf(stderr, "event_loop: Failed to set CPU affinity.\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && thread_stack_size != 0
+    &&  pthread_attr_setstacksize(&attr, thread_stack_size) != 0) {
+        fprintf(stderr, "event_loop: Failed to set stack size.\n");
+        ret = -1;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if (ret == 0 && pthread_create(new_thread, &attr, start_routine, arg) != 0) {
+        fprintf(stderr, "event_loop: Failed to start thread.\n");
+        ret = -1;
+    }
+    pthread_attr_destroy(&attr);
+
+    return ret;
+}
+
+int event_loop_init(void)
+{
+    struct epoll_event event;
+    uint32_t i;
+    int ret = 0;
+
+    pthread_mutex_lock(&init_mutex);
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt > 0) {
+        ++reference_cnt;
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&init_mutex);
+        return 0;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        fprintf(stderr, "event_loop: Failed to create epoll file descriptor.\n");
+        pthread_mutex_unlock(&init_mutex);
+        return -1;
+    }
+
+    for (i = 0; i < MAX_SOURCE_CNT; ++i)
+        sources[i].fd = -1;
+
+    if (mode == EVENT_LOOP_THREAD) {
+        event.events = EPOLLIN;
+        event.data.u64 = STOP_SOURCE_INDEX;
+        if ((stop_fd = eventfd(0, EFD_CLOEXEC)) < 0) {
+            fprintf(stderr, "event_loop: Failed to create eventfd.\n");
+            ret = -1;
+        } else if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd, &event) < 0) {
+            fprintf(stderr, "event_loop: Failed to wait for stop event.\n");
+            ret = -1;
+        } else if (event_loop_create_thread(&thread, run_event_loop, NULL) < 0) {
+            ret = -1;
+        }
+    }
+
+    if (ret < 0) {
+        close_fds();
+    } else {
+        pthread_mutex_lock(&mutex);
+        reference_cnt = 1;
+        pthread_mutex_unlock(&mutex);
+    }
+    pthread_mutex_unlock(&init_mutex);
+
+    return ret;
+}
+
+int event_loop_add_fd(int fd, uint32_t events, void (*handler)(uint32_t events, void *arg), void *arg)
+{
+    struct epoll_event event;
+    uint32_t i;
+
+    if (fd < 0) {
+        fprintf(stderr, "event_loop: Invalid file descriptor.\n");
+        return -1;
+    }
+
+    if (handler == NULL) {
+        fprintf(stderr, "event_loop: handler must not be null.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt == 0) {
+        fprintf(stderr, "event_loop: Event loop must be initialised before adding file descriptors.\n");
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    for (i = 0; i < MAX_SOURCE_CNT; ++i) {
+        if (sources[i].fd < 0)
+            break;
+    }
+    if (i == MAX_SOURCE_CNT) {
+        fprintf(stderr, "event_loop: Cannot wait on more than %d file descriptors.\n", MAX_SOURCE_CNT);
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    event.events = events;
+    event.data.u64 = ((uint64_t)sources[i].generation << 32) | i;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        fprintf(stderr, "event_loop: Failed to wait on file descriptor %d.\n", fd);
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    __atomic_store_n(&sources[i].handler, handler, __ATOMIC_RELAXED);
+    __atomic_store_n(&sources[i].arg, arg, __ATOMIC_RELAXED);
+    __atomic_store_n(&sources[i].fd, fd, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+int event_loop_remove_fd(int fd)
+{
+    bool dispatching = is_dispatching;
+    int ret = -1;
+    uint32_t i;
+
+    if (fd < 0) {
+        fprintf(stderr, "event_loop: Invalid file descriptor.\n");
+        return -1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    for (i = 0; i < MAX_SOURCE_CNT && reference_cnt > 0; ++i) {
+        if (sources[i].fd != fd)
+            continue;
+
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0)
+            fprintf(stderr, "event_loop: Failed to stop waiting on file descriptor %d.\n", fd);
+
+        __atomic_store_n(&sources[i].fd, -1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&sources[i].generation, 1, __ATOMIC_SEQ_CST);
+        ret = 0;
+        break;
+    }
+    if (ret < 0)
+        fprintf(stderr, "event_loop: File descriptor %d is not in event loop.\n", fd);
+    pthread_mutex_unlock(&mutex);
+
+    /* Wait for handlers to return, unless called from a handler */
+    if (ret == 0 && !dispatching)
+        wait_for_dispatch();
+
+    return ret;
+}
+
+int event_loop_release(void)
+{
+    bool stop_thread = false;
+
+    pthread_mutex_lock(&init_mutex);
+    pthread_mutex_lock(&mutex);
+    if (reference_cnt == 0) {
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&init_mutex);
+        return 0;
+    }
+
+    if (reference_cnt == 1 && is_dispatching) {
+        fprintf(stderr, "event_loop: Cannot stop event loop from a handler.\n");
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&init_mutex);
+        return -1;
+    }
+
+    --reference_cnt;
+    if (reference_cnt > 0) {
+        pthread_mutex_unlock(&mutex);
+        pthread_mutex_unlock(&init_mutex);
+        return 0;
+    }
+    stop_thread = stop_fd >= 0;
+    pthread_mutex_unlock(&mutex);
+
+    /* Handlers may take mutex, it must not be held */
+    if (stop_thread) {
+        if (eventfd_write(stop_fd, 1) < 0
+        ||  pthread_join(thread, NULL) != 0)
+            fprintf(stderr, "event_loop: Failed to stop thread.\n");
+    }
+
+    close_fds();
+    pthread_mutex_unlock(&init_mutex);
+
+    return 0;
+}
+
+uint64_t event_loop_get_wakeup_time(void)
+{
+    return wakeup_time;
+}
+
+int letmecreate_poll(int timeout)
+{
+    struct epoll_event events[MAX_EVENT_CNT];
+    int event_cnt;
+
+    if (mode != EVENT_LOOP_POLL) {
+        fprintf(stderr, "event_loop: Event loop runs on its own thread.\n");
+        return -1;
+    }
+
+    if (epoll_fd < 0) {
+        fprintf(stderr, "event_loop: Event loop is not initialised.\n");
+        return -1;
+    }
+
+    if (is_dispatching) {
+        fprintf(stderr, "event_loop: Cannot poll from a handler.\n");
+        return -1;
+    }
+
+    /* Handlers are called one at a time, and dispatch_seq assumes a single dispatching thread */
+    if (__atomic_exchange_n(&polling, true, __ATOMIC_ACQUIRE)) {
+        fprintf(stderr, "event_loop: Another thread is already polling.\n");
+        return -1;
+    }
+
+    event_cnt = epoll_wait(epoll_fd, events, MAX_EVENT_CNT, timeout);
+    if (event_cnt < 0 && errno == EINTR) {
+        event_cnt = 0;
+    } else if (event_cnt < 0) {
+        fprintf(stderr, "event_loop: Failed to wait for events.\n");
+    } else {
+        dispatch(events, event_cnt);
+    }
+
+    __atomic_store_n(&polling, false, __ATOMIC_RELEASE);
+
+    return event_cnt < 0 ? -1 : event_cnt;
+}
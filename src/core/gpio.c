@@ -27,6 +27,9 @@
  * If a GPIO is configured as an output, writing to /sys/class/gpio/gpioN/value
  * changes the level of the output.
  *
+ * GPIO's can also be controlled through the GPIO character device, see
+ * gpio_chardev.c.
+ *
  */
 
 
@@ -39,47 +42,99 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/core/common.h"
+#include "gpio_chardev.h"
 
 #define GPIO_DIR_BASE_PATH      "/sys/class/gpio/"
 #define GPIO_PATH_FORMAT        "/sys/class/gpio/gpio%d/%s"
 
 
-static bool check_pin(uint8_t pin)
+/*
+ * Pins accessible from Mikrobus and Raspberry Pi interfaces. The position of
+ * a pin in this array is its bit in GPIO_MASK.
+ */
+static const uint8_t gpio_pins[] = {
+    GPIO_14, GPIO_21, GPIO_22, GPIO_23, GPIO_24, GPIO_25, GPIO_27, GPIO_31,
+    GPIO_72, GPIO_73, GPIO_74, GPIO_75, GPIO_80, GPIO_81, GPIO_82, GPIO_83,
+    GPIO_84, GPIO_85, GPIO_88, GPIO_89
+};
+#define GPIO_CNT    (sizeof(gpio_pins) / sizeof(gpio_pins[0]))
+
+/*
+ * State of gpio's exported through sysfs, indexed like gpio_pins. It is filled
+ * by gpio_init and gpio_set_direction, or the first time an exported gpio is
+ * accessed, and cleared by gpio_release. Hence, the library assumes that
+ * gpio's it uses are not unexported or reconfigured by another process.
+ */
+struct gpio_state {
+    bool exported;
+    uint8_t direction;
+    int value_fd;           /* -1 until value file is opened */
+    int direction_fd;       /* -1 until direction file is opened */
+};
+
+static struct gpio_state states[GPIO_CNT];
+static bool states_initialised = false;
+
+/* Number of owners and direction of acquired gpio's, indexed like gpio_pins */
+static unsigned int owner_cnts[GPIO_CNT];
+static uint8_t acquired_directions[GPIO_CNT];
+
+#ifdef LETMECREATE_GPIO_CHARDEV_DEFAULT
+#define DEFAULT_BACKEND         GPIO_BACKEND_CHARDEV
+#else
+#define DEFAULT_BACKEND         GPIO_BACKEND_SYSFS
+#endif
+
+static int current_backend = -1;
+
+static bool is_backend_supported(uint8_t backend)
 {
-    switch (pin) {
-    case GPIO_14:
-    case GPIO_21:
-    case GPIO_22:
-    case GPIO_23:
-    case GPIO_24:
-    case GPIO_25:
-    case GPIO_27:
-    case GPIO_31:
-    case GPIO_73:
-    case GPIO_74:
-    case GPIO_75:
-    case GPIO_88:
-    case GPIO_89:
-    case GPIO_72:
-    case GPIO_80:
-    case GPIO_81:
-    case GPIO_82:
-    case GPIO_83:
-    case GPIO_84:
-    case GPIO_85:
+    switch (backend) {
+    case GPIO_BACKEND_SYSFS:
+        return true;
+#ifdef LETMECREATE_GPIO_CHARDEV
+    case GPIO_BACKEND_CHARDEV:
         return true;
+#endif
     default:
+        return false;
+    }
+}
+
+static bool use_chardev(void)
+{
+    return gpio_get_backend() == GPIO_BACKEND_CHARDEV;
+}
+
+static int get_pin_index(uint8_t pin)
+{
+    unsigned int i;
+
+    for (i = 0; i < GPIO_CNT; ++i) {
+        if (gpio_pins[i] == pin)
+            return i;
+    }
+
+    return -1;
+}
+
+static bool check_pin(uint8_t pin)
+{
+    if (get_pin_index(pin) < 0) {
         fprintf(stderr, "Invalid gpio pin.\n");
         return false;
     }
+
+    return true;
 }
 
 static bool create_gpio_path(char *path, uint8_t gpio_pin, const char *file_name)
 {
-    if (snprintf(path, MAX_STR_LENGTH, GPIO_PATH_FORMAT, gpio_pin, file_name) < 0) {
+    if (create_device_path(path, GPIO_PATH_FORMAT, gpio_pin, file_name) < 0) {
         fprintf(stderr, "gpio: Could not create path for accessing %s of gpio %d.\n", file_name, gpio_pin);
         return false;
     }
@@ -104,67 +159,189 @@ static bool is_gpio_exported(uint8_t gpio_pin)
     return true;
 }
 
-static int write_str_gpio_file(uint8_t gpio_pin, const char *file_name, const char *value)
+static int read_str_gpio_file(uint8_t gpio_pin, const char *file_name, char *value, uint32_t max_str_length)
 {
     char path[MAX_STR_LENGTH];
 
-    if (!create_gpio_path(path, gpio_pin, file_name)) {
-        fprintf(stderr, "gpio: Cannot create path to file %s.\n", file_name);
+    if (!create_gpio_path(path, gpio_pin, file_name))
         return -1;
-    }
 
-    return write_str_file(path, value);
+    return read_str_file(path, value, max_str_length);
 }
 
-static int write_int_gpio_file(uint8_t gpio_pin, const char *file_name, uint32_t value)
+static int read_direction(uint8_t gpio_pin, uint8_t *dir)
 {
-    char str[MAX_STR_LENGTH];
+    char value[MAX_STR_LENGTH];
 
-    if (snprintf(str, MAX_STR_LENGTH, "%d", value) < 0) {
-        fprintf(stderr, "gpio: Failed to convert integer %d to string.\n", value);
+    if (read_str_gpio_file(gpio_pin, "direction", value, MAX_STR_LENGTH) < 0)
+        return -1;
+
+    if (strncmp(value, "out", 3) == 0) {
+        *dir = GPIO_OUTPUT;
+    } else if (strncmp(value, "in", 2) == 0) {
+        *dir = GPIO_INPUT;
+    } else {
+        fprintf(stderr, "gpio: Invalid direction read from gpio %d.\n", gpio_pin);
         return -1;
     }
 
-    return write_str_gpio_file(gpio_pin, file_name, str);
+    return 0;
 }
 
-static int read_str_gpio_file(uint8_t gpio_pin, const char *file_name, char *value, uint32_t max_str_length)
+static struct gpio_state *get_state(uint8_t gpio_pin)
+{
+    unsigned int i;
+
+    if (!states_initialised) {
+        for (i = 0; i < GPIO_CNT; ++i) {
+            states[i].exported = false;
+            states[i].direction = GPIO_INPUT;
+            states[i].value_fd = -1;
+            states[i].direction_fd = -1;
+        }
+        states_initialised = true;
+    }
+
+    return &states[get_pin_index(gpio_pin)];
+}
+
+/*
+ * Check the state table first. If the gpio is not in the table, check sysfs
+ * once, in case the gpio was exported before the program started.
+ */
+static bool is_gpio_initialised(uint8_t gpio_pin)
+{
+    struct gpio_state *state = get_state(gpio_pin);
+
+    if (state->exported)
+        return true;
+
+    if (!is_gpio_exported(gpio_pin))
+        return false;
+
+    if (read_direction(gpio_pin, &state->direction) < 0)
+        return false;
+
+    state->exported = true;
+    return true;
+}
+
+/*
+ * Value file of a gpio is opened once and kept open until the gpio is released,
+ * so that reading or writing the state of the gpio costs a single syscall.
+ */
+static int get_value_fd(uint8_t gpio_pin)
 {
+    struct gpio_state *state = get_state(gpio_pin);
     char path[MAX_STR_LENGTH];
 
-    if (!create_gpio_path(path, gpio_pin, file_name))
+    if (state->value_fd >= 0)
+        return state->value_fd;
+
+    if (!create_gpio_path(path, gpio_pin, "value"))
         return -1;
 
-    return read_str_file(path, value, max_str_length);
+    state->value_fd = open_device_file(path, O_RDWR);
+    return state->value_fd;
 }
 
-static int read_int_gpio_file(uint8_t gpio_pin, const char *file_name, uint8_t *value)
+/*
+ * Direction file is kept open as well, since open-drain lines of software
+ * buses change direction at every edge.
+ */
+static int get_direction_fd(uint8_t gpio_pin)
 {
+    struct gpio_state *state = get_state(gpio_pin);
     char path[MAX_STR_LENGTH];
-    uint32_t tmp;
 
-    if (!create_gpio_path(path, gpio_pin, file_name))
+    if (state->direction_fd >= 0)
+        return state->direction_fd;
+
+    if (!create_gpio_path(path, gpio_pin, "direction"))
         return -1;
 
-    if (read_int_file(path, &tmp) < 0)
+    state->direction_fd = open_device_file(path, O_WRONLY);
+    return state->direction_fd;
+}
+
+static void clear_state(uint8_t gpio_pin)
+{
+    struct gpio_state *state = get_state(gpio_pin);
+
+    if (state->value_fd >= 0)
+        close(state->value_fd);
+    if (state->direction_fd >= 0)
+        close(state->direction_fd);
+
+    state->exported = false;
+    state->direction = GPIO_INPUT;
+    state->value_fd = -1;
+    state->direction_fd = -1;
+}
+
+int gpio_select_backend(uint8_t backend)
+{
+    unsigned int i;
+
+    if (!is_backend_supported(backend)) {
+        fprintf(stderr, "gpio: Backend %d is not supported.\n", backend);
         return -1;
+    }
+
+    for (i = 0; i < GPIO_CNT; ++i) {
+        if (gpio_chardev_is_initialised(gpio_pins[i])) {
+            fprintf(stderr, "gpio: Cannot change backend while gpio %d is initialised.\n", gpio_pins[i]);
+            return -1;
+        }
+    }
+
+    current_backend = backend;
 
-    *value = tmp;
     return 0;
 }
 
+uint8_t gpio_get_backend(void)
+{
+    if (current_backend < 0) {
+        const char *str = getenv("LETMECREATE_GPIO_BACKEND");
+
+        current_backend = DEFAULT_BACKEND;
+        if (str != NULL && strcmp(str, "sysfs") == 0)
+            current_backend = GPIO_BACKEND_SYSFS;
+        else if (str != NULL && strcmp(str, "chardev") == 0 && is_backend_supported(GPIO_BACKEND_CHARDEV))
+            current_backend = GPIO_BACKEND_CHARDEV;
+        else if (str != NULL)
+            fprintf(stderr, "gpio: Ignoring unsupported backend %s.\n", str);
+    }
+
+    return current_backend;
+}
+
 int gpio_init(uint8_t gpio_pin)
 {
+    char path[MAX_STR_LENGTH];
+
     if (!check_pin(gpio_pin))
         return -1;
 
-    if (is_gpio_exported(gpio_pin))
+    if (use_chardev())
+        return gpio_chardev_init(gpio_pin);
+
+    if (is_gpio_initialised(gpio_pin))
         return 0;
 
-    if (export_pin(GPIO_DIR_BASE_PATH, gpio_pin) < 0)
+    if (create_device_path(path, GPIO_DIR_BASE_PATH) < 0
+    ||  export_pin(path, gpio_pin) < 0)
+        return -1;
+
+    get_state(gpio_pin)->exported = true;
+
+    if (gpio_set_direction(gpio_pin, GPIO_INPUT) < 0) {
+        clear_state(gpio_pin);
         return -1;
+    }
 
-    return gpio_set_direction(gpio_pin, GPIO_INPUT);
+    return 0;
 }
 
 int gpio_set_direction(uint8_t gpio_pin, uint8_t dir)
@@ -185,18 +362,24 @@ int gpio_set_direction(uint8_t gpio_pin, uint8_t dir)
         return -1;
     }
 
-    if (!is_gpio_exported(gpio_pin)) {
+    if (use_chardev())
+        return gpio_chardev_set_direction(gpio_pin, dir);
+
+    if (!is_gpio_initialised(gpio_pin)) {
         fprintf(stderr, "gpio: Cannot set direction of uninitialised gpio %d\n", gpio_pin);
         return -1;
     }
 
-    return write_str_gpio_file(gpio_pin, "direction", str);
+    if (write_str_fd(get_direction_fd(gpio_pin), str) < 0)
+        return -1;
+
+    get_state(gpio_pin)->direction = dir;
+
+    return 0;
 }
 
 int gpio_get_direction(uint8_t gpio_pin, uint8_t *dir)
 {
-    char value[MAX_STR_LENGTH];
-
     if (!check_pin(gpio_pin))
         return -1;
 
@@ -205,47 +388,44 @@ int gpio_get_direction(uint8_t gpio_pin, uint8_t *dir)
         return -1;
     }
 
-    if (!is_gpio_exported(gpio_pin))
-        return 0;
+    if (use_chardev())
+        return gpio_chardev_get_direction(gpio_pin, dir);
 
-    if (read_str_gpio_file(gpio_pin, "direction", value, MAX_STR_LENGTH) < 0)
-        return -1;
-
-    if (strncmp(value, "out", 3) == 0) {
-        *dir = GPIO_OUTPUT;
-    } else if (strncmp(value, "in", 2) == 0) {
-        *dir = GPIO_INPUT;
-    } else {
-        fprintf(stderr, "gpio: Invalid direction read from gpio %d.\n", gpio_pin);
+    if (!is_gpio_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot get direction of uninitialised gpio %d\n", gpio_pin);
         return -1;
     }
 
+    *dir = get_state(gpio_pin)->direction;
+
     return 0;
 }
 
 int gpio_set_value(uint8_t gpio_pin, uint8_t value)
 {
-    uint8_t dir;
-
     if (!check_pin(gpio_pin))
         return -1;
 
-    if (!is_gpio_exported(gpio_pin))
-        return 0;
+    if (use_chardev())
+        return gpio_chardev_set_value(gpio_pin, value);
 
-    if (gpio_get_direction(gpio_pin, &dir) < 0)
+    if (!is_gpio_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot set value of uninitialised gpio %d\n", gpio_pin);
         return -1;
+    }
 
-    if (dir == GPIO_INPUT) {
+    if (get_state(gpio_pin)->direction == GPIO_INPUT) {
         fprintf(stderr, "gpio: Cannot set value to an input.\n");
         return -1;
     }
 
-    return write_int_gpio_file(gpio_pin, "value", value == 0 ? 0 : 1);
+    return write_str_fd(get_value_fd(gpio_pin), value == 0 ? "0" : "1");
 }
 
 int gpio_get_value(uint8_t gpio_pin, uint8_t *value)
 {
+    uint32_t tmp;
+
     if (!check_pin(gpio_pin))
         return -1;
 
@@ -254,20 +434,222 @@ int gpio_get_value(uint8_t gpio_pin, uint8_t *value)
         return -1;
     }
 
-    if (!is_gpio_exported(gpio_pin))
-        return 0;
+    if (use_chardev())
+        return gpio_chardev_get_value(gpio_pin, value);
+
+    if (!is_gpio_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot get value of uninitialised gpio %d\n", gpio_pin);
+        return -1;
+    }
+
+    if (read_int_fd(get_value_fd(gpio_pin), &tmp) < 0)
+        return -1;
+
+    *value = tmp;
+    return 0;
+}
+
+int gpio_set_values(uint32_t mask, uint32_t values)
+{
+    unsigned int i;
 
-    return read_int_gpio_file(gpio_pin, "value", value);
+    if (mask & ~ALL_GPIO_MASK) {
+        fprintf(stderr, "gpio: Invalid gpio mask.\n");
+        return -1;
+    }
+
+    if (use_chardev())
+        return gpio_chardev_set_values(gpio_pins, GPIO_CNT, mask, values);
+
+    /* Check all gpio's before changing any output */
+    for (i = 0; i < GPIO_CNT; ++i) {
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (!is_gpio_initialised(gpio_pins[i])) {
+            fprintf(stderr, "gpio: Cannot set value of uninitialised gpio %d\n", gpio_pins[i]);
+            return -1;
+        }
+
+        if (states[i].direction == GPIO_INPUT) {
+            fprintf(stderr, "gpio: Cannot set value to an input.\n");
+            return -1;
+        }
+
+        if (get_value_fd(gpio_pins[i]) < 0)
+            return -1;
+    }
+
+    for (i = 0; i < GPIO_CNT; ++i) {
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (write_str_fd(states[i].value_fd, (values & (1 << i)) ? "1" : "0") < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+int gpio_get_values(uint32_t mask, uint32_t *values)
+{
+    unsigned int i;
+
+    if (mask & ~ALL_GPIO_MASK) {
+        fprintf(stderr, "gpio: Invalid gpio mask.\n");
+        return -1;
+    }
+
+    if (values == NULL) {
+        fprintf(stderr, "gpio: Cannot store values of gpio's to null variable.\n");
+        return -1;
+    }
+
+    if (use_chardev())
+        return gpio_chardev_get_values(gpio_pins, GPIO_CNT, mask, values);
+
+    *values = 0;
+    for (i = 0; i < GPIO_CNT; ++i) {
+        uint32_t tmp;
+
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (!is_gpio_initialised(gpio_pins[i])) {
+            fprintf(stderr, "gpio: Cannot get value of uninitialised gpio %d\n", gpio_pins[i]);
+            return -1;
+        }
+
+        if (read_int_fd(get_value_fd(gpio_pins[i]), &tmp) < 0)
+            return -1;
+
+        if (tmp)
+            *values |= 1 << i;
+    }
+
+    return 0;
+}
+
+int gpio_snapshot(struct gpio_snapshot *snapshot)
+{
+    struct timespec before, after;
+    unsigned int i;
+
+    if (snapshot == NULL) {
+        fprintf(stderr, "gpio: Cannot store snapshot to null variable.\n");
+        return -1;
+    }
+
+    snapshot->initialised = 0;
+    snapshot->outputs = 0;
+    for (i = 0; i < GPIO_CNT; ++i) {
+        uint8_t dir;
+
+        if (use_chardev()) {
+            if (!gpio_chardev_is_initialised(gpio_pins[i]))
+                continue;
+            if (gpio_chardev_get_direction(gpio_pins[i], &dir) < 0)
+                return -1;
+        } else {
+            /* Pins unknown to the library are not looked up in sysfs */
+            if (!get_state(gpio_pins[i])->exported)
+                continue;
+            dir = states[i].direction;
+        }
+
+        snapshot->initialised |= 1 << i;
+        if (dir == GPIO_OUTPUT)
+            snapshot->outputs |= 1 << i;
+    }
+
+    /* Timestamp is taken in the middle of the reads */
+    clock_gettime(CLOCK_MONOTONIC, &before);
+    if (gpio_get_values(snapshot->initialised, &snapshot->values) < 0)
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &after);
+
+    snapshot->timestamp = ((uint64_t)before.tv_sec * 1000000000ULL + before.tv_nsec
+                         + (uint64_t)after.tv_sec * 1000000000ULL + after.tv_nsec) / 2;
+
+    return 0;
 }
 
 int gpio_release(uint8_t gpio_pin)
 {
+    char path[MAX_STR_LENGTH];
+
     if (!check_pin(gpio_pin))
         return -1;
 
+    if (owner_cnts[get_pin_index(gpio_pin)] != 0) {
+        fprintf(stderr, "gpio: Cannot release gpio %d, it is still acquired.\n", gpio_pin);
+        return -1;
+    }
+
+    if (use_chardev())
+        return gpio_chardev_release(gpio_pin);
+
+    clear_state(gpio_pin);
+
     if (!is_gpio_exported(gpio_pin))
         return 0;
 
-    return unexport_pin(GPIO_DIR_BASE_PATH, gpio_pin);
+    if (create_device_path(path, GPIO_DIR_BASE_PATH) < 0)
+        return -1;
+
+    return unexport_pin(path, gpio_pin);
 }
 
+
+int gpio_acquire(uint8_t gpio_pin, uint8_t dir)
+{
+    int index;
+
+    if (!check_pin(gpio_pin))
+        return -1;
+
+    if (dir != GPIO_OUTPUT && dir != GPIO_INPUT) {
+        fprintf(stderr, "gpio: Cannot acquire gpio %d with invalid direction.\n", gpio_pin);
+        return -1;
+    }
+
+    index = get_pin_index(gpio_pin);
+    if (owner_cnts[index] != 0) {
+        if (acquired_directions[index] != dir) {
+            fprintf(stderr, "gpio: Cannot acquire gpio %d, it is already acquired as an %s.\n",
+                    gpio_pin, acquired_directions[index] == GPIO_OUTPUT ? "output" : "input");
+            return -1;
+        }
+
+        ++owner_cnts[index];
+        return 0;
+    }
+
+    if (gpio_init(gpio_pin) < 0
+    ||  gpio_set_direction(gpio_pin, dir) < 0)
+        return -1;
+
+    acquired_directions[index] = dir;
+    owner_cnts[index] = 1;
+
+    return 0;
+}
+
+int gpio_relinquish(uint8_t gpio_pin)
+{
+    int index;
+
+    if (!check_pin(gpio_pin))
+        return -1;
+
+    index = get_pin_index(gpio_pin);
+    if (owner_cnts[index] == 0) {
+        fprintf(stderr, "gpio: Cannot give up gpio %d, it is not acquired.\n", gpio_pin);
+        return -1;
+    }
+
+    if (--owner_cnts[index] != 0)
+        return 0;
+
+    return gpio_release(gpio_pin);
+}
@@ -0,0 +1,530 @@
+/*
+ * Since Linux 5.10, GPIO's can be requested through the version 2 of the
+ * character device interface. Each GPIO controller is exposed as
+ * /dev/gpiochipN and lines are requested by issuing ioctl's on this file.
+ * The kernel returns a new file descriptor, the line request, which is used
+ * to configure, read and write the requested lines.
+ *
+ * On the Ci40, GPIO's are grouped in banks of 16 lines and each bank is a
+ * separate gpiochip. Hence, GPIO N is line N%16 of /dev/gpiochip(N/16).
+ *
+ * Lines of a bank are held by as few line requests as possible, so that one
+ * ioctl is enough to read or write many of them. The set of lines of a
+ * request cannot change: lines are released when the request is closed, and
+ * the kernel may reset released outputs before they are requested again.
+ * Hence, a request holding outputs is never closed while they are used:
+ *  - a new line joins the lines of its bank in a single request only if none
+ *    of them is an output, otherwise it gets a request of its own,
+ *  - a released line is dropped from its request only if the request holds
+ *    no output, otherwise it is configured as an input and stays in the
+ *    request until its outputs are released.
+ */
+
+#ifdef LETMECREATE_GPIO_CHARDEV
+
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "letmecreate/core/common.h"
+#include "letmecreate/core/gpio.h"
+#include "gpio_chardev.h"
+
+#define GPIOCHIP_PATH_FORMAT    "/dev/gpiochip%d"
+#define GPIOCHIP_CNT            (6)
+#define LINES_PER_GPIOCHIP      (16)
+#define CONSUMER_NAME           "letmecreate"
+
+#define GET_GPIOCHIP(GPIO_PIN)  ((GPIO_PIN) / LINES_PER_GPIOCHIP)
+#define GET_OFFSET(GPIO_PIN)    ((GPIO_PIN) % LINES_PER_GPIOCHIP)
+
+struct line_request {
+    int fd;             /* File descriptor of the line request, only valid if lines is not 0 */
+    uint16_t lines;     /* Lines held by the request, bit N is line at offset N */
+};
+
+struct gpiochip {
+    struct line_request requests[LINES_PER_GPIOCHIP];   /* At most one request per line */
+    uint16_t lines;     /* Initialised lines, released lines may still be held by a request */
+    uint16_t outputs;   /* Initialised lines configured as outputs */
+    uint16_t values;    /* Last level written to outputs */
+};
+
+static struct gpiochip chips[GPIOCHIP_CNT];
+
+/*
+ * Values and configuration of a line request are indexed by the position of
+ * the line in the request, not by its offset. Lines are always requested in
+ * ascending order of offsets.
+ */
+static uint64_t offsets_to_request_mask(uint16_t lines, uint16_t offsets)
+{
+    uint64_t mask = 0;
+    unsigned int offset, index = 0;
+
+    for (offset = 0; offset < LINES_PER_GPIOCHIP; ++offset) {
+        if ((lines & (1 << offset)) == 0)
+            continue;
+
+        if (offsets & (1 << offset))
+            mask |= 1ULL << index;
+        ++index;
+    }
+
+    return mask;
+}
+
+static uint16_t request_mask_to_offsets(uint16_t lines, uint64_t mask)
+{
+    uint16_t offsets = 0;
+    unsigned int offset, index = 0;
+
+    for (offset = 0; offset < LINES_PER_GPIOCHIP; ++offset) {
+        if ((lines & (1 << offset)) == 0)
+            continue;
+
+        if (mask & (1ULL << index))
+            offsets |= 1 << offset;
+        ++index;
+    }
+
+    return offsets;
+}
+
+static void build_line_config(struct gpio_v2_line_config *config, uint16_t lines,
+                              uint16_t outputs, uint16_t values)
+{
+    memset(config, 0, sizeof(*config));
+    config->flags = GPIO_V2_LINE_FLAG_INPUT;
+
+    if ((outputs & lines) == 0)
+        return;
+
+    config->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+    config->attrs[0].attr.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    config->attrs[0].mask = offsets_to_request_mask(lines, outputs);
+
+    config->attrs[1].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    config->attrs[1].attr.values = offsets_to_request_mask(lines, outputs & values);
+    config->attrs[1].mask = config->attrs[0].mask;
+
+    config->num_attrs = 2;
+}
+
+/* Request lines as inputs, return file descriptor of the line request or -1 */
+static int request_lines(uint8_t chip_index, uint16_t lines)
+{
+    struct gpio_v2_line_request req;
+    char path[MAX_STR_LENGTH];
+    unsigned int offset;
+    int chip_fd, ret;
+
+    memset(&req, 0, sizeof(req));
+    for (offset = 0; offset < LINES_PER_GPIOCHIP; ++offset) {
+        if (lines & (1 << offset))
+            req.offsets[req.num_lines++] = offset;
+    }
+    strncpy(req.consumer, CONSUMER_NAME, sizeof(req.consumer) - 1);
+    build_line_config(&req.config, lines, 0, 0);
+
+    if (create_device_path(path, GPIOCHIP_PATH_FORMAT, chip_index) < 0) {
+        fprintf(stderr, "gpio: Could not create path to gpiochip %d.\n", chip_index);
+        return -1;
+    }
+
+    if ((chip_fd = open(path, O_RDWR)) < 0) {
+        fprintf(stderr, "gpio: Failed to open %s\n", path);
+        return -1;
+    }
+
+    ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(chip_fd);
+    if (ret < 0) {
+        fprintf(stderr, "gpio: Failed to request lines of gpiochip %d.\n", chip_index);
+        return -1;
+    }
+
+    return req.fd;
+}
+
+/* Return the request holding a line, or NULL */
+static struct line_request* find_request(struct gpiochip *chip, uint16_t line)
+{
+    unsigned int i;
+
+    for (i = 0; i < LINES_PER_GPIOCHIP; ++i) {
+        if (chip->requests[i].lines & line)
+            return &chip->requests[i];
+    }
+
+    return NULL;
+}
+
+static struct line_request* find_free_request(struct gpiochip *chip)
+{
+    unsigned int i;
+
+    for (i = 0; i < LINES_PER_GPIOCHIP; ++i) {
+        if (chip->requests[i].lines == 0)
+            return &chip->requests[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Replace all requests of a gpiochip by a single request holding lines. Must
+ * only be called if the gpiochip has no output.
+ */
+static int merge_requests(uint8_t chip_index, uint16_t lines)
+{
+    struct gpiochip *chip = &chips[chip_index];
+    unsigned int i;
+    int fd;
+
+    /* Lines must be released before they can be requested again */
+    for (i = 0; i < LINES_PER_GPIOCHIP; ++i) {
+        if (chip->requests[i].lines != 0)
+            close(chip->requests[i].fd);
+        chip->requests[i].lines = 0;
+    }
+
+    if ((fd = request_lines(chip_index, lines)) < 0) {
+        /* Attempt to get back the lines held before */
+        if (chip->lines != 0)
+            fd = request_lines(chip_index, chip->lines);
+        if (fd < 0) {
+            chip->lines = 0;
+        } else {
+            chip->requests[0].fd = fd;
+            chip->requests[0].lines = chip->lines;
+        }
+        return -1;
+    }
+
+    chip->requests[0].fd = fd;
+    chip->requests[0].lines = lines;
+    chip->lines = lines;
+
+    return 0;
+}
+
+bool gpio_chardev_is_initialised(uint8_t gpio_pin)
+{
+    if (GET_GPIOCHIP(gpio_pin) >= GPIOCHIP_CNT)
+        return false;
+
+    return chips[GET_GPIOCHIP(gpio_pin)].lines & (1 << GET_OFFSET(gpio_pin));
+}
+
+int gpio_chardev_init(uint8_t gpio_pin)
+{
+    uint8_t chip_index = GET_GPIOCHIP(gpio_pin);
+    struct gpiochip *chip = &chips[chip_index];
+    uint16_t line = 1 << GET_OFFSET(gpio_pin);
+    struct line_request *request;
+    int fd;
+
+    if (chip->lines & line)
+        return 0;
+
+    /* Line was released but is still held by a request with outputs */
+    if (find_request(chip, line) != NULL) {
+        chip->lines |= line;
+        return 0;
+    }
+
+    if (chip->outputs == 0)
+        return merge_requests(chip_index, chip->lines | line);
+
+    /* Requests holding outputs are left untouched */
+    request = find_free_request(chip);
+    if ((fd = request_lines(chip_index, line)) < 0)
+        return -1;
+
+    request->fd = fd;
+    request->lines = line;
+    chip->lines |= line;
+
+    return 0;
+}
+
+int gpio_chardev_set_direction(uint8_t gpio_pin, uint8_t dir)
+{
+    struct gpiochip *chip = &chips[GET_GPIOCHIP(gpio_pin)];
+    uint16_t line = 1 << GET_OFFSET(gpio_pin);
+    struct line_request *request;
+    struct gpio_v2_line_config config;
+    uint16_t outputs = chip->outputs;
+
+    if (!gpio_chardev_is_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot set direction of uninitialised gpio %d\n", gpio_pin);
+        return -1;
+    }
+
+    if (dir == GPIO_OUTPUT)
+        outputs |= line;
+    else
+        outputs &= ~line;
+
+    request = find_request(chip, line);
+    build_line_config(&config, request->lines, outputs, chip->values);
+    if (ioctl(request->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) < 0) {
+        fprintf(stderr, "gpio: Failed to set direction of gpio %d.\n", gpio_pin);
+        return -1;
+    }
+
+    chip->outputs = outputs;
+
+    return 0;
+}
+
+int gpio_chardev_get_direction(uint8_t gpio_pin, uint8_t *dir)
+{
+    struct gpiochip *chip = &chips[GET_GPIOCHIP(gpio_pin)];
+
+    if (!gpio_chardev_is_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot get direction of uninitialised gpio %d\n", gpio_pin);
+        return -1;
+    }
+
+    if (chip->outputs & (1 << GET_OFFSET(gpio_pin)))
+        *dir = GPIO_OUTPUT;
+    else
+        *dir = GPIO_INPUT;
+
+    return 0;
+}
+
+int gpio_chardev_set_value(uint8_t gpio_pin, uint8_t value)
+{
+    struct gpiochip *chip = &chips[GET_GPIOCHIP(gpio_pin)];
+    uint16_t line = 1 << GET_OFFSET(gpio_pin);
+    struct line_request *request;
+    struct gpio_v2_line_values values;
+
+    if (!gpio_chardev_is_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot set value of uninitialised gpio %d\n", gpio_pin);
+        return -1;
+    }
+
+    if ((chip->outputs & line) == 0) {
+        fprintf(stderr, "gpio: Cannot set value to an input.\n");
+        return -1;
+    }
+
+    request = find_request(chip, line);
+    memset(&values, 0, sizeof(values));
+    values.mask = offsets_to_request_mask(request->lines, line);
+    if (value)
+        values.bits = values.mask;
+
+    if (ioctl(request->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        fprintf(stderr, "gpio: Failed to set value of gpio %d.\n", gpio_pin);
+        return -1;
+    }
+
+    if (value)
+        chip->values |= line;
+    else
+        chip->values &= ~line;
+
+    return 0;
+}
+
+int gpio_chardev_get_value(uint8_t gpio_pin, uint8_t *value)
+{
+    struct gpiochip *chip = &chips[GET_GPIOCHIP(gpio_pin)];
+    uint16_t line = 1 << GET_OFFSET(gpio_pin);
+    struct line_request *request;
+    struct gpio_v2_line_values values;
+
+    if (!gpio_chardev_is_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio: Cannot get value of uninitialised gpio %d\n", gpio_pin);
+        return -1;
+    }
+
+    request = find_request(chip, line);
+    memset(&values, 0, sizeof(values));
+    values.mask = offsets_to_request_mask(request->lines, line);
+
+    if (ioctl(request->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        fprintf(stderr, "gpio: Failed to get value of gpio %d.\n", gpio_pin);
+        return -1;
+    }
+
+    *value = (values.bits & values.mask) ? 1 : 0;
+
+    return 0;
+}
+
+int gpio_chardev_set_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t values)
+{
+    uint16_t lines[GPIOCHIP_CNT] = { 0 };
+    uint16_t levels[GPIOCHIP_CNT] = { 0 };
+    unsigned int i, chip_index;
+
+    /* Check all lines before changing any output */
+    for (i = 0; i < pin_cnt; ++i) {
+        uint8_t gpio_pin = gpio_pins[i];
+
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (!gpio_chardev_is_initialised(gpio_pin)) {
+            fprintf(stderr, "gpio: Cannot set value of uninitialised gpio %d\n", gpio_pin);
+            return -1;
+        }
+
+        if ((chips[GET_GPIOCHIP(gpio_pin)].outputs & (1 << GET_OFFSET(gpio_pin))) == 0) {
+            fprintf(stderr, "gpio: Cannot set value to an input.\n");
+            return -1;
+        }
+
+        lines[GET_GPIOCHIP(gpio_pin)] |= 1 << GET_OFFSET(gpio_pin);
+        if (values & (1 << i))
+            levels[GET_GPIOCHIP(gpio_pin)] |= 1 << GET_OFFSET(gpio_pin);
+    }
+
+    /* One ioctl per line request */
+    for (chip_index = 0; chip_index < GPIOCHIP_CNT; ++chip_index) {
+        struct gpiochip *chip = &chips[chip_index];
+
+        for (i = 0; i < LINES_PER_GPIOCHIP && lines[chip_index] != 0; ++i) {
+            struct line_request *request = &chip->requests[i];
+            struct gpio_v2_line_values line_values;
+            uint16_t held_lines = lines[chip_index] & request->lines;
+
+            if (held_lines == 0)
+                continue;
+
+            memset(&line_values, 0, sizeof(line_values));
+            line_values.mask = offsets_to_request_mask(request->lines, held_lines);
+            line_values.bits = offsets_to_request_mask(request->lines, levels[chip_index]);
+
+            if (ioctl(request->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &line_values) < 0) {
+                fprintf(stderr, "gpio: Failed to set values of gpiochip %d.\n", chip_index);
+                return -1;
+            }
+
+            chip->values = (chip->values & ~held_lines) | (levels[chip_index] & held_lines);
+            lines[chip_index] &= ~held_lines;
+        }
+    }
+
+    return 0;
+}
+
+int gpio_chardev_get_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t *values)
+{
+    uint16_t lines[GPIOCHIP_CNT] = { 0 };
+    uint16_t levels[GPIOCHIP_CNT] = { 0 };
+    unsigned int i, chip_index;
+
+    for (i = 0; i < pin_cnt; ++i) {
+        uint8_t gpio_pin = gpio_pins[i];
+
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (!gpio_chardev_is_initialised(gpio_pin)) {
+            fprintf(stderr, "gpio: Cannot get value of uninitialised gpio %d\n", gpio_pin);
+            return -1;
+        }
+
+        lines[GET_GPIOCHIP(gpio_pin)] |= 1 << GET_OFFSET(gpio_pin);
+    }
+
+    /* One ioctl per line request */
+    for (chip_index = 0; chip_index < GPIOCHIP_CNT; ++chip_index) {
+        struct gpiochip *chip = &chips[chip_index];
+
+        for (i = 0; i < LINES_PER_GPIOCHIP && lines[chip_index] != 0; ++i) {
+            struct line_request *request = &chip->requests[i];
+            struct gpio_v2_line_values line_values;
+            uint16_t held_lines = lines[chip_index] & request->lines;
+
+            if (held_lines == 0)
+                continue;
+
+            memset(&line_values, 0, sizeof(line_values));
+            line_values.mask = offsets_to_request_mask(request->lines, held_lines);
+            if (ioctl(request->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &line_values) < 0) {
+                fprintf(stderr, "gpio: Failed to get values of gpiochip %d.\n", chip_index);
+                return -1;
+            }
+
+            levels[chip_index] |= request_mask_to_offsets(request->lines,
+                                                          line_values.bits & line_values.mask);
+            lines[chip_index] &= ~held_lines;
+        }
+    }
+
+    *values = 0;
+    for (i = 0; i < pin_cnt; ++i) {
+        uint8_t gpio_pin = gpio_pins[i];
+
+        if ((mask & (1 << i)) == 0)
+            continue;
+
+        if (levels[GET_GPIOCHIP(gpio_pin)] & (1 << GET_OFFSET(gpio_pin)))
+            *values |= 1 << i;
+    }
+
+    return 0;
+}
+
+int gpio_chardev_release(uint8_t gpio_pin)
+{
+    uint8_t chip_index = GET_GPIOCHIP(gpio_pin);
+    struct gpiochip *chip = &chips[chip_index];
+    uint16_t line = 1 << GET_OFFSET(gpio_pin);
+    struct line_request *request;
+    struct gpio_v2_line_config config;
+    uint16_t remaining_lines;
+    int fd;
+
+    if (!gpio_chardev_is_initialised(gpio_pin))
+        return 0;
+
+    request = find_request(chip, line);
+
+    /* Other outputs of the request must keep their level: line becomes an unused input */
+    if (request->lines & chip->outputs & ~line) {
+        build_line_config(&config, request->lines, chip->outputs & ~line, chip->values);
+        if (ioctl(request->fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) < 0) {
+            fprintf(stderr, "gpio: Failed to release gpio %d.\n", gpio_pin);
+            return -1;
+        }
+
+        chip->lines &= ~line;
+        chip->outputs &= ~line;
+        chip->values &= ~line;
+        return 0;
+    }
+
+    /* Lines released earlier are dropped as well */
+    remaining_lines = request->lines & chip->lines & ~line;
+    close(request->fd);
+    request->lines = 0;
+    chip->lines &= ~line;
+    chip->outputs &= ~line;
+    chip->values &= ~line;
+
+    if (remaining_lines == 0)
+        return 0;
+
+    if ((fd = request_lines(chip_index, remaining_lines)) < 0) {
+        chip->lines &= ~remaining_lines;
+        return -1;
+    }
+
+    request->fd = fd;
+    request->lines = remaining_lines;
+
+    return 0;
+}
+
+#endif
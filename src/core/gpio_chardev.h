@@ -0,0 +1,54 @@
+/*
+ * Private interface between gpio.c and the GPIO character device backend.
+ *
+ * All functions expect a valid gpio pin, checks are performed by gpio.c,
+ * except gpio_chardev_is_initialised which accepts any pin so that other
+ * modules can check whether a gpio is owned by this backend.
+ */
+
+#ifndef __LETMECREATE_CORE_GPIO_CHARDEV_H__
+#define __LETMECREATE_CORE_GPIO_CHARDEV_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef LETMECREATE_GPIO_CHARDEV
+
+bool gpio_chardev_is_initialised(uint8_t gpio_pin);
+
+int gpio_chardev_init(uint8_t gpio_pin);
+
+int gpio_chardev_set_direction(uint8_t gpio_pin, uint8_t dir);
+
+int gpio_chardev_get_direction(uint8_t gpio_pin, uint8_t *dir);
+
+int gpio_chardev_set_value(uint8_t gpio_pin, uint8_t value);
+
+int gpio_chardev_get_value(uint8_t gpio_pin, uint8_t *value);
+
+/*
+ * Bit N of mask and values refers to gpio_pins[N]. Lines are read or written
+ * with one ioctl per line request.
+ */
+int gpio_chardev_set_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t values);
+
+int gpio_chardev_get_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t *values);
+
+int gpio_chardev_release(uint8_t gpio_pin);
+
+#else
+
+/* Kernel headers do not provide the GPIO character device interface */
+static inline bool gpio_chardev_is_initialised(uint8_t gpio_pin) { return false; }
+static inline int gpio_chardev_init(uint8_t gpio_pin) { return -1; }
+static inline int gpio_chardev_set_direction(uint8_t gpio_pin, uint8_t dir) { return -1; }
+static inline int gpio_chardev_get_direction(uint8_t gpio_pin, uint8_t *dir) { return -1; }
+static inline int gpio_chardev_set_value(uint8_t gpio_pin, uint8_t value) { return -1; }
+static inline int gpio_chardev_get_value(uint8_t gpio_pin, uint8_t *value) { return -1; }
+static inline int gpio_chardev_set_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t values) { return -1; }
+static inline int gpio_chardev_get_values(const uint8_t *gpio_pins, uint8_t pin_cnt, uint32_t mask, uint32_t *values) { return -1; }
+static inline int gpio_chardev_release(uint8_t gpio_pin) { return -1; }
+
+#endif
+
+#endif
@@ -1,285 +1,930 @@
+/*
+ * Once the edge file of a GPIO is set to "both", the kernel raises POLLPRI
+ * and POLLERR on /sys/class/gpio/gpioN/value whenever the level of the GPIO
+ * changes. The notification is cleared by reading the value file from
+ * offset 0.
+ *
+ * The value file of each monitored GPIO is kept open and added to an epoll
+ * instance, itself waited on by the event loop of the library. The level read
+ * after a notification tells the edge. If the level did not change since the
+ * last read, the GPIO changed at least twice (a short pulse), so two edges are
+ * inferred and reported with a flag. Edges closer than the time needed to
+ * handle a notification are merged: sysfs cannot capture them without loss.
+ *
+ * Sysfs notifications carry no timestamp, so edges are timestamped with the
+ * time at which the event loop woke up, and only the dispatch latency of
+ * callbacks is measured from there. Every edge is recorded in a single-producer single-consumer ring
+ * before callbacks are called. The event loop is the only producer,
+ * gpio_monitor_read_events is the only consumer.
+ *
+ * Callbacks are stored in a table indexed by gpio pin. Each entry points to
+ * an immutable set of callbacks: adding or removing a callback publishes a
+ * new set, so the event loop never takes a lock. An old set is freed once the
+ * event loop is done with it: dispatch_seq is odd while it handles a batch of
+ * events, and writers wait for it to change. Writers running on the event
+ * loop itself (from a callback) cannot wait, so they hand old sets to the
+ * event loop, which frees them after the batch.
+ *
+ * Optionally, callbacks run on a pool of worker threads instead of the event
+ * loop. Each worker has a bounded single-producer single-consumer queue fed
+ * by the event loop and an eventfd to wake it up. Events of a gpio always go
+ * to the same worker, so they are handled in order. Workers are readers of
+ * the callback table as well and have their own dispatch_seq. Sets retired
+ * from a callback are then freed by the next writer which is not a callback,
+ * or on release. Value files unwatched from a worker are closed with them,
+ * since the event loop may still read them.
+ *
+ * Debounced watches are filtered by the event loop using timestamps of edges:
+ * an edge only reaches the callback once the level was stable long enough and
+ * the previous report is older than the window. A timerfd in the epoll
+ * instance expires at the next deadline, and is disarmed while no deadline is
+ * pending.
+ *
+ * A gpio can also have a counter, stored in its set of callbacks. The event
+ * loop counts edges without calling any callback and keeps the count at the
+ * time of the last batches of edges to measure the period. Readers use the
+ * sequence counter of the counter to get a consistent copy.
+ */
+
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/inotify.h>
-#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include "letmecreate/core/common.h"
+#include "letmecreate/core/event_loop.h"
 #include "letmecreate/core/gpio_monitor.h"
+#include "gpio_chardev.h"
 
 
 #define GPIO_PATH_FORMAT      "/sys/class/gpio/gpio%d/"
+#define GPIO_PIN_CNT          (256)
+#define MAX_EVENT_CNT         (16)
+#define EVENT_RING_SIZE       (256)       /* Must be a power of 2 */
+#define TIMER_EVENT_ID        (0x100)     /* Does not collide with gpio pins */
+#define MAX_WORKER_CNT        (8)
+#define WORKER_QUEUE_SIZE     (64)        /* Must be a power of 2 */
+#define ALL_PLAIN_WATCHES     (UINT32_MAX)  /* Dispatch to all watches without debounce */
+#define COUNTER_HISTORY_SIZE  (8)
+
+static volatile bool running = false;
+static pthread_mutex_t registry_mutex;      /* Serialises writers, never taken by event loop */
+
+static int fd = -1;         /* epoll file descriptor */
+static int timer_fd = -1;   /* Expires at the next debounce deadline */
+static uint64_t timer_deadline = 0;
+
+/* Debounce state of a watch, only modified by the event loop */
+struct debounce {
+    uint64_t window;                /* in ns */
+    uint64_t stable_time;           /* in ns */
+    uint64_t deadline;              /* Time when the level can be reported */
+    uint64_t last_report;
+    bool pending;
+    uint8_t level;                  /* Level after last edge */
+    uint8_t reported_level;
+};
 
-static volatile bool thread_running = false;
-static pthread_t thread;
-static pthread_mutex_t inotify_watch_mutex;
-static pthread_mutex_t gpio_watch_mutex;
-
-static int fd = -1;     /* inotify file descriptor */
-
-static uint32_t current_watch_ID = 0;
 struct gpio_watch {
     uint32_t ID;
-    uint8_t gpio_pin;
     uint8_t event_mask;
     void(*callback)(uint8_t);
-    struct gpio_watch *next;
+    struct debounce *debounce;      /* NULL if edges are not debounced */
+};
+
+/*
+ * Edge counter of a gpio, only modified by the event loop. seq is odd
+ * while the counter is updated. The history keeps the count at the time of
+ * the last batches of edges, to measure the period.
+ */
+struct counter {
+    uint8_t event_mask;
+    uint32_t seq;
+    uint64_t count;
+    uint32_t history_index;         /* Index of newest entry */
+    uint32_t history_cnt;
+    uint64_t timestamps[COUNTER_HISTORY_SIZE];
+    uint64_t counts[COUNTER_HISTORY_SIZE];
+};
+
+struct callback_set {
+    uint32_t cnt;
+    struct counter *counter;                /* NULL if edges are not counted */
+    struct callback_set *next;              /* Only used once the set is retired */
+    struct debounce *removed_debounce;      /* Freed with the set once retired */
+    struct counter *removed_counter;        /* Freed with the set once retired */
+    int removed_fd;                         /* Closed with the set once retired, or -1 */
+    struct gpio_watch watches[];
+};
+
+struct pin_slot {
+    int fd;                         /* Value file, -1 if gpio is not monitored */
+    uint8_t value;                  /* Last level read from value file */
+    struct callback_set *callbacks;
 };
-static struct gpio_watch *gpio_watch_list_head = NULL;
+static struct pin_slot slots[GPIO_PIN_CNT];
 
-/* Mapping wd <-> gpio_pin */
-struct inotify_watch {
-    int wd;
+static uint32_t current_watch_ID = 0;
+static uint32_t debounced_watch_cnt = 0;
+static uint32_t dispatch_seq = 0;
+static struct callback_set *retired_sets = NULL;
+static __thread bool is_callback_thread = false;
+static __thread bool is_worker_thread = false;
+
+struct dispatch_event {
     uint8_t gpio_pin;
-    struct inotify_watch *next;
+    uint8_t type;
+    uint32_t ID;                    /* Watch to call, or ALL_PLAIN_WATCHES */
+    uint64_t timestamp;             /* Time from which latency of callbacks is measured */
+};
+
+struct worker {
+    pthread_t thread;
+    bool started;
+    int event_fd;                   /* Wakes up the worker when events are queued */
+    uint32_t dispatch_seq;
+    uint32_t head;                  /* Only written by worker */
+    uint32_t tail;                  /* Only written by event loop */
+    struct dispatch_event queue[WORKER_QUEUE_SIZE];
 };
-static struct inotify_watch *inotify_watch_list_head = NULL;
+/*
+ * Dispatch latency from timestamps of edges to callbacks in nanoseconds. The histogram has one bucket
+ * per value below 16, then splits each power of two in 16 buckets, so
+ * percentiles are rounded up by less than 7%.
+ */
+#define LATENCY_SUB_BUCKET_BITS     (4)
+#define LATENCY_SUB_BUCKET_CNT      (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKET_CNT          ((64 - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+static struct {
+    uint64_t cnt;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[LATENCY_BUCKET_CNT];
+} latency;
+
+static uint8_t worker_cnt = 0;
+static struct worker *workers = NULL;
+static volatile bool workers_running = false;
+
+/*
+ * Ring of edge events. head is only written by the consumer, tail only by the
+ * event loop. Both indexes wrap at 2^32.
+ */
+static struct gpio_event event_ring[EVENT_RING_SIZE];
+static uint32_t event_ring_head = 0;
+static uint32_t event_ring_tail = 0;
+
+/* Only written by the event loop */
+static uint32_t inferred_cnt = 0;       /* Edges reported because level did not change */
+static uint32_t ring_drop_cnt = 0;      /* Edges not recorded because ring was full */
+static uint32_t queue_drop_cnt = 0;     /* Edges not queued because queue of a worker was full */
+
+
+static int read_value(int value_fd, uint8_t *value)
+{
+    uint32_t tmp;
+
+    if (read_int_fd(value_fd, &tmp) < 0)
+        return -1;
+
+    *value = tmp != 0;
+    return 0;
+}
+
+/*
+ * Read the new level of a gpio and append the edges that occurred to events.
+ * Return the number of edges (0, 1 or 2).
+ *
+ * Sysfs only tells that the level changed at least once since the last read.
+ * If the level is the same, an even number of edges occurred: two edges are
+ * inferred, flagged and counted, since they were not seen. More edges may have
+ * been merged. An odd number of edges cannot be told from one edge.
+ */
+static int find_events(uint8_t gpio_pin, uint64_t timestamp, struct gpio_event *events)
+{
+    struct pin_slot *slot = &slots[gpio_pin];
+    int value_fd = __atomic_load_n(&slot->fd, __ATOMIC_ACQUIRE);
+    int event_cnt = 0;
+    uint8_t value;
+    bool inferred;
+
+    if (value_fd < 0 || read_value(value_fd, &value) < 0)
+        return 0;
 
+    inferred = value == slot->value;
+    if (inferred) {
+        /* Missed at least two edges, infer both */
+        __atomic_store_n(&inferred_cnt, inferred_cnt + 2, __ATOMIC_RELAXED);
+        events[event_cnt].gpio_pin = gpio_pin;
+        events[event_cnt].type = value ? GPIO_FALLING : GPIO_RAISING;
+        events[event_cnt].inferred = 1;
+        events[event_cnt].timestamp = timestamp;
+        ++event_cnt;
+    }
+    events[event_cnt].gpio_pin = gpio_pin;
+    events[event_cnt].type = value ? GPIO_RAISING : GPIO_FALLING;
+    events[event_cnt].inferred = inferred;
+    events[event_cnt].timestamp = timestamp;
+    ++event_cnt;
+    slot->value = value;
+
+    return event_cnt;
+}
 
-static uint8_t wd_to_gpio_pin(int wd)
+static void record_events(const struct gpio_event *events, int event_cnt)
 {
-    uint8_t gpio_pin = 0;
-    struct inotify_watch *cur = NULL;
-    pthread_mutex_lock(&inotify_watch_mutex);
-    cur = inotify_watch_list_head;
-    while (cur) {
-        if (cur->wd == wd) {
-            gpio_pin = cur->gpio_pin;
+    uint32_t head = __atomic_load_n(&event_ring_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = event_ring_tail;
+    int i;
+
+    for (i = 0; i < event_cnt; ++i) {
+        if (tail - head == EVENT_RING_SIZE) {
+            /* Ring is full, drop newest events */
+            __atomic_store_n(&ring_drop_cnt, ring_drop_cnt + event_cnt - i, __ATOMIC_RELAXED);
             break;
         }
-        cur = cur->next;
+        event_ring[tail & (EVENT_RING_SIZE - 1)] = events[i];
+        ++tail;
     }
-    pthread_mutex_unlock(&inotify_watch_mutex);
 
-    return gpio_pin;
+    __atomic_store_n(&event_ring_tail, tail, __ATOMIC_RELEASE);
 }
 
-static int find_event_type(uint8_t gpio_pin, uint8_t *event_type)
+static uint64_t get_timestamp(void)
 {
-    uint8_t value;
+    struct timespec now;
 
-    if (gpio_get_value(gpio_pin, &value) < 0)
-        return -1;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
 
-    if (value == 0)
-        *event_type = GPIO_FALLING;
-    else
-        *event_type = GPIO_RAISING;
+/* Return index of the bucket of the latency histogram containing value */
+static uint32_t get_latency_bucket(uint64_t value)
+{
+    uint32_t exponent;
 
-    return 0;
+    if (value < LATENCY_SUB_BUCKET_CNT)
+        return value;
+
+    exponent = 63 - __builtin_clzll(value);
+    return ((exponent - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+         | ((value >> (exponent - LATENCY_SUB_BUCKET_BITS)) & (LATENCY_SUB_BUCKET_CNT - 1));
 }
 
-static void call_callbacks(uint8_t gpio_pin, uint8_t event_type)
+/* Return the largest value of a bucket of the latency histogram */
+static uint64_t get_latency_bucket_max(uint32_t bucket)
 {
-    struct gpio_watch *cur = NULL;
+    uint32_t shift;
 
-    /* Call callbacks */
-    pthread_mutex_lock(&gpio_watch_mutex);
-    cur = gpio_watch_list_head;
-    while (cur) {
-        if (cur->gpio_pin == gpio_pin && cur->event_mask & event_type)
-            cur->callback(event_type);
+    if (bucket < LATENCY_SUB_BUCKET_CNT)
+        return bucket;
 
-        cur = cur->next;
+    shift = (bucket >> LATENCY_SUB_BUCKET_BITS) - 1;
+    return ((uint64_t)(LATENCY_SUB_BUCKET_CNT | (bucket & (LATENCY_SUB_BUCKET_CNT - 1))) << shift)
+         + ((1ULL << shift) - 1);
+}
+
+/* Called by the event loop and by workers */
+static void record_latency(uint64_t value)
+{
+    uint64_t min = __atomic_load_n(&latency.min, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&latency.max, __ATOMIC_RELAXED);
+
+    while (value < min && !__atomic_compare_exchange_n(&latency.min, &min, value, true,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    while (value > max && !__atomic_compare_exchange_n(&latency.max, &max, value, true,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+    __atomic_add_fetch(&latency.sum, value, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&latency.buckets[get_latency_bucket(value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&latency.cnt, 1, __ATOMIC_RELAXED);
+}
+
+static void call_callbacks(const struct dispatch_event *event)
+{
+    struct callback_set *set = __atomic_load_n(&slots[event->gpio_pin].callbacks, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    if (set == NULL)
+        return;
+
+    for (i = 0; i < set->cnt; ++i) {
+        struct gpio_watch *watch = &set->watches[i];
+
+        if (event->ID == ALL_PLAIN_WATCHES) {
+            if (watch->debounce != NULL)
+                continue;
+        } else if (watch->ID != event->ID) {
+            continue;
+        }
+
+        if (watch->event_mask & event->type) {
+            record_latency(get_timestamp() - event->timestamp);
+            watch->callback(event->type);
+        }
     }
-    pthread_mutex_unlock(&gpio_watch_mutex);
 }
 
-static void* monitor_gpio(void *arg)
+static void free_sets(struct callback_set *set)
 {
-    thread_running = true;
-    while (thread_running) {
-        struct timeval timeout = {          /* 20ms timeout */
-            .tv_sec = 0,
-            .tv_usec = 20000
-        };
-        int ret;
-        uint8_t gpio_pin, event_type;
-        fd_set fds;
-        struct inotify_event event;
-        FD_ZERO(&fds);
-        FD_SET(fd, &fds);
-        ret = select(fd+1, &fds, NULL, NULL, &timeout);
-        if (ret <= 0)
+    while (set) {
+        struct callback_set *tmp = set;
+        set = set->next;
+        free(tmp->removed_debounce);
+        free(tmp->removed_counter);
+        if (tmp->removed_fd >= 0)
+            close(tmp->removed_fd);
+        free(tmp);
+    }
+}
+
+/*
+ * Call callbacks, or queue them to a worker. Queued events are dropped and
+ * counted if the queue of the worker is full.
+ */
+static void dispatch(const struct dispatch_event *event, bool *wake_up)
+{
+    struct worker *worker = NULL;
+    uint32_t head;
+
+    if (worker_cnt == 0) {
+        call_callbacks(event);
+        return;
+    }
+
+    worker = &workers[event->gpio_pin % worker_cnt];
+    head = __atomic_load_n(&worker->head, __ATOMIC_ACQUIRE);
+    if (worker->tail - head == WORKER_QUEUE_SIZE) {
+        __atomic_store_n(&queue_drop_cnt, queue_drop_cnt + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    worker->queue[worker->tail & (WORKER_QUEUE_SIZE - 1)] = *event;
+    __atomic_store_n(&worker->tail, worker->tail + 1, __ATOMIC_RELEASE);
+    wake_up[event->gpio_pin % worker_cnt] = true;
+}
+
+/* Feed an edge of the gpio to its debounced watches */
+static void debounce_event(const struct gpio_event *event)
+{
+    struct callback_set *set = __atomic_load_n(&slots[event->gpio_pin].callbacks, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    if (set == NULL)
+        return;
+
+    for (i = 0; i < set->cnt; ++i) {
+        struct debounce *debounce = set->watches[i].debounce;
+        uint64_t deadline;
+
+        if (debounce == NULL)
             continue;
 
-        ret = read(fd, &event, sizeof(event));
-        if (ret <= 0)
+        /* Level must be stable during stable_time, and edges are not reported during window */
+        debounce->level = event->type == GPIO_RAISING;
+        deadline = event->timestamp + debounce->stable_time;
+        if (deadline < debounce->last_report + debounce->window)
+            deadline = debounce->last_report + debounce->window;
+        debounce->deadline = deadline;
+        debounce->pending = true;
+    }
+}
+
+/*
+ * Report level changes of debounced watches whose deadline has passed.
+ * Return the next deadline, 0 if none is pending.
+ */
+static uint64_t expire_debounces(uint64_t timestamp, bool *wake_up)
+{
+    struct dispatch_event event;
+    uint64_t next_deadline = UINT64_MAX;
+    uint32_t gpio_pin, i;
+
+    if (__atomic_load_n(&debounced_watch_cnt, __ATOMIC_RELAXED) == 0)
+        return 0;
+
+    for (gpio_pin = 0; gpio_pin < GPIO_PIN_CNT; ++gpio_pin) {
+        struct callback_set *set = __atomic_load_n(&slots[gpio_pin].callbacks, __ATOMIC_ACQUIRE);
+        if (set == NULL)
             continue;
 
-        gpio_pin = wd_to_gpio_pin(event.wd);
-        if (find_event_type(gpio_pin, &event_type) < 0)
+        for (i = 0; i < set->cnt; ++i) {
+            struct debounce *debounce = set->watches[i].debounce;
+
+            if (debounce == NULL || debounce->pending == false)
+                continue;
+
+            if (debounce->deadline > timestamp) {
+                if (debounce->deadline < next_deadline)
+                    next_deadline = debounce->deadline;
+                continue;
+            }
+
+            debounce->pending = false;
+            if (debounce->level == debounce->reported_level)
+                continue;
+
+            debounce->reported_level = debounce->level;
+            debounce->last_report = timestamp;
+            event.gpio_pin = gpio_pin;
+            event.type = debounce->level ? GPIO_RAISING : GPIO_FALLING;
+            event.ID = set->watches[i].ID;
+            event.timestamp = debounce->deadline;
+            dispatch(&event, wake_up);
+        }
+    }
+
+    if (next_deadline == UINT64_MAX)
+        return 0;
+
+    return next_deadline;
+}
+
+/* Arm timer to expire at deadline, or disarm it if deadline is 0 */
+static void set_timer(uint64_t deadline)
+{
+    struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+
+    if (deadline == timer_deadline)
+        return;
+
+    spec.it_value.tv_sec = deadline / 1000000000ULL;
+    spec.it_value.tv_nsec = deadline % 1000000000ULL;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0)
+        timer_deadline = deadline;
+}
+
+/* Count an edge of the gpio if a counter is started */
+static void count_event(const struct gpio_event *event)
+{
+    struct callback_set *set = __atomic_load_n(&slots[event->gpio_pin].callbacks, __ATOMIC_ACQUIRE);
+    struct counter *counter = NULL;
+    uint32_t index;
+
+    if (set == NULL || set->counter == NULL)
+        return;
+
+    counter = set->counter;
+    if ((counter->event_mask & event->type) == 0)
+        return;
+
+    __atomic_add_fetch(&counter->seq, 1, __ATOMIC_ACQ_REL);
+    ++counter->count;
+    index = counter->history_index;
+    if (counter->history_cnt == 0 || counter->timestamps[index] != event->timestamp) {
+        if (counter->history_cnt != 0)
+            index = (index + 1) % COUNTER_HISTORY_SIZE;
+        if (counter->history_cnt < COUNTER_HISTORY_SIZE)
+            ++counter->history_cnt;
+        counter->history_index = index;
+        counter->timestamps[index] = event->timestamp;
+    }
+    counter->counts[index] = counter->count;
+    __atomic_add_fetch(&counter->seq, 1, __ATOMIC_RELEASE);
+}
+
+static void* run_worker(void *arg)
+{
+    struct worker *worker = arg;
+
+    is_callback_thread = true;
+    is_worker_thread = true;
+    while (true) {
+        eventfd_t cnt;
+        uint32_t head = worker->head;
+        uint32_t tail;
+
+        if (eventfd_read(worker->event_fd, &cnt) < 0)
             continue;
 
-        call_callbacks(gpio_pin, event_type);
+        tail = __atomic_load_n(&worker->tail, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&worker->dispatch_seq, 1, __ATOMIC_SEQ_CST);
+        for (; head != tail; ++head) {
+            struct dispatch_event *event = &worker->queue[head & (WORKER_QUEUE_SIZE - 1)];
+            call_callbacks(event);
+            __atomic_store_n(&worker->head, head + 1, __ATOMIC_RELEASE);
+        }
+        __atomic_add_fetch(&worker->dispatch_seq, 1, __ATOMIC_SEQ_CST);
+
+        /* Event loop is stopped before workers, queue is empty */
+        if (workers_running == false)
+            break;
     }
 
     return NULL;
 }
 
-static int enable_gpio_interrupt(uint8_t gpio_pin)
+/* Handle notifications of value files and of timer, called from event loop */
+static void handle_events(uint32_t events, void *arg)
 {
-    char path[MAX_STR_LENGTH];
+    struct epoll_event epoll_events[MAX_EVENT_CNT];
+    struct gpio_event gpio_events[2 * MAX_EVENT_CNT];
+    bool wake_up[MAX_WORKER_CNT] = { false };
+    uint64_t timestamp;
+    int i, epoll_event_cnt, event_cnt = 0;
+
+    epoll_event_cnt = epoll_wait(fd, epoll_events, MAX_EVENT_CNT, 0);
+    if (epoll_event_cnt < 0)
+        return;
+
+    timestamp = event_loop_get_wakeup_time();
+
+    is_callback_thread = true;
+    __atomic_add_fetch(&dispatch_seq, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < epoll_event_cnt; ++i) {
+        if (epoll_events[i].data.u32 == TIMER_EVENT_ID) {
+            uint64_t expiration_cnt;
+            if (read(timer_fd, &expiration_cnt, sizeof(expiration_cnt)) < 0)
+                fprintf(stderr, "gpio_monitor: Failed to read timer.\n");
+            timer_deadline = 0;
+            continue;
+        }
 
-    if (snprintf(path, MAX_STR_LENGTH, GPIO_PATH_FORMAT"edge", gpio_pin) < 0)
-        return -1;
+        event_cnt += find_events(epoll_events[i].data.u32, timestamp, &gpio_events[event_cnt]);
+    }
 
-    return write_str_file(path, "both");
+    record_events(gpio_events, event_cnt);
+    for (i = 0; i < event_cnt; ++i) {
+        struct dispatch_event event = {
+            .gpio_pin = gpio_events[i].gpio_pin,
+            .type = gpio_events[i].type,
+            .ID = ALL_PLAIN_WATCHES,
+            .timestamp = gpio_events[i].timestamp
+        };
+
+        count_event(&gpio_events[i]);
+        dispatch(&event, wake_up);
+        debounce_event(&gpio_events[i]);
+    }
+    set_timer(expire_debounces(timestamp, wake_up));
+
+    for (i = 0; i < worker_cnt; ++i) {
+        if (wake_up[i])
+            eventfd_write(workers[i].event_fd, 1);
+    }
+    __atomic_add_fetch(&dispatch_seq, 1, __ATOMIC_SEQ_CST);
+    is_callback_thread = false;
+
+    /* Only reader of the table without workers, so sets retired by callbacks can be freed */
+    if (worker_cnt == 0)
+        free_sets(__atomic_exchange_n(&retired_sets, NULL, __ATOMIC_ACQ_REL));
 }
 
-static bool is_gpio_monitored(uint8_t gpio_pin)
+static void wait_for_seq(uint32_t *seq_ptr)
 {
-    struct gpio_watch *cur = gpio_watch_list_head;
-    while (cur) {
-        if (cur->gpio_pin == gpio_pin)
-            return true;
-        cur = cur->next;
-    }
+    uint32_t seq = __atomic_load_n(seq_ptr, __ATOMIC_SEQ_CST);
+
+    if ((seq & 1) == 0)
+        return;
 
-    return false;
+    while (__atomic_load_n(seq_ptr, __ATOMIC_ACQUIRE) == seq)
+        sched_yield();
 }
 
-static bool has_inotify_watch(uint8_t gpio_pin)
+/*
+ * Wait until the event loop and workers do not use anything
+ * unpublished before the call. Must not be called from a callback.
+ */
+static void wait_for_dispatch(void)
 {
-    struct inotify_watch *cur = inotify_watch_list_head;
-    while (cur) {
-        if (cur->gpio_pin == gpio_pin)
-            return true;
+    uint8_t i;
 
-        cur = cur->next;
+    wait_for_seq(&dispatch_seq);
+    for (i = 0; i < worker_cnt; ++i)
+        wait_for_seq(&workers[i].dispatch_seq);
+}
+
+/*
+ * Free a set of callbacks and close a value file which are no longer
+ * published. Must be called without holding registry_mutex, since callbacks
+ * running on the event loop may need it.
+ */
+static void retire(struct callback_set *set, int value_fd)
+{
+    struct callback_set *old_sets = NULL;
+
+    if (is_callback_thread) {
+        /*
+         * Value files are not read while the event loop calls callbacks,
+         * but they can be while a worker does: the file is then closed
+         * with the set. A set always exists when a value file is unwatched.
+         */
+        if (value_fd >= 0 && is_worker_thread == false)
+            close(value_fd);
+        else if (value_fd >= 0)
+            set->removed_fd = value_fd;
+        if (set != NULL) {
+            set->next = __atomic_load_n(&retired_sets, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&retired_sets, &set->next, set, true,
+                                                __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+                ;
+        }
+        return;
     }
 
-    return false;
+    /* Sets retired from callbacks were unpublished before the wait as well */
+    old_sets = __atomic_exchange_n(&retired_sets, NULL, __ATOMIC_ACQ_REL);
+    if (running)
+        wait_for_dispatch();
+    if (value_fd >= 0)
+        close(value_fd);
+    free_sets(set);
+    free_sets(old_sets);
 }
 
-static int add_inotify_watch(uint8_t gpio_pin)
+static int enable_gpio_interrupt(uint8_t gpio_pin)
 {
-    struct inotify_watch *watch = NULL;
     char path[MAX_STR_LENGTH];
-    int wd = -1;
 
-    if (snprintf(path, MAX_STR_LENGTH, GPIO_PATH_FORMAT"value", gpio_pin) < 0)
+    /* Lines requested through the character device are not exported in sysfs */
+    if (gpio_chardev_is_initialised(gpio_pin)) {
+        fprintf(stderr, "gpio_monitor: gpio %d is requested through the character device, which the monitor does not support.\n", gpio_pin);
         return -1;
+    }
 
-    watch = malloc(sizeof(struct inotify_watch));
-    if (watch == NULL) {
-        fprintf(stderr, "gpio_monitor: Failed to allocate memory for a inotify watch.\n");
+    if (create_device_path(path, GPIO_PATH_FORMAT"edge", gpio_pin) < 0)
         return -1;
-    }
 
-    if ((wd = inotify_add_watch(fd, path, IN_MODIFY)) < 0) {
-        free(watch);
+    return write_str_file(path, "both");
+}
+
+/* Must be called with registry_mutex locked */
+static int open_value_file(uint8_t gpio_pin)
+{
+    struct pin_slot *slot = &slots[gpio_pin];
+    struct epoll_event event;
+    char path[MAX_STR_LENGTH];
+    int value_fd;
+
+    if (create_device_path(path, GPIO_PATH_FORMAT"value", gpio_pin) < 0)
         return -1;
-    }
 
-    watch->wd = wd;
-    watch->gpio_pin = gpio_pin;
-    watch->next = NULL;
+    if ((value_fd = open_device_file(path, O_RDONLY)) < 0)
+        return -1;
 
-    if (inotify_watch_list_head == NULL) {
-        pthread_mutex_lock(&inotify_watch_mutex);
-        inotify_watch_list_head = watch;
-        pthread_mutex_unlock(&inotify_watch_mutex);
-    } else {
-        struct inotify_watch *last = inotify_watch_list_head;
-        while (last->next)
-            last = last->next;
-        pthread_mutex_lock(&inotify_watch_mutex);
-        last->next = watch;
-        pthread_mutex_unlock(&inotify_watch_mutex);
+    /* Reading the value clears any pending notification */
+    if (read_value(value_fd, &slot->value) < 0) {
+        close(value_fd);
+        return -1;
+    }
+    __atomic_store_n(&slot->fd, value_fd, __ATOMIC_RELEASE);
+
+    event.events = EPOLLPRI | EPOLLERR;
+    event.data.u64 = 0;
+    event.data.u32 = gpio_pin;
+    if (epoll_ctl(fd, EPOLL_CTL_ADD, value_fd, &event) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to wait for events of gpio %d.\n", gpio_pin);
+        __atomic_store_n(&slot->fd, -1, __ATOMIC_RELEASE);
+        close(value_fd);
+        return -1;
     }
 
     return 0;
 }
 
-static int remove_inotify_watch(uint8_t gpio_pin)
+/*
+ * Allocate a copy of the set of callbacks of a gpio with room for extra
+ * watches. Must be called with registry_mutex locked.
+ */
+static struct callback_set* copy_set(uint8_t gpio_pin, uint32_t extra_cnt)
 {
-    struct inotify_watch *prev = NULL;
-    struct inotify_watch *cur = inotify_watch_list_head;
-    while (cur) {
-        if (cur->gpio_pin == gpio_pin)
-            break;
-        prev = cur;
-        cur = cur->next;
+    struct callback_set *old_set = slots[gpio_pin].callbacks;
+    struct callback_set *new_set = NULL;
+    uint32_t i, cnt = 0;
+
+    if (old_set != NULL)
+        cnt = old_set->cnt;
+
+    new_set = malloc(sizeof(struct callback_set) + (cnt + extra_cnt) * sizeof(struct gpio_watch));
+    if (new_set == NULL) {
+        fprintf(stderr, "gpio_monitor: Failed to allocate memory for watch.\n");
+        return NULL;
     }
-    if (cur == NULL)
-        return -1;
 
-    if (inotify_rm_watch(fd, cur->wd) < 0) {
-        fprintf(stderr, "gpio_monitor: Failed to remove inotify watch.\n");
-        return -1;
+    new_set->cnt = cnt;
+    new_set->counter = NULL;
+    new_set->next = NULL;
+    new_set->removed_debounce = NULL;
+    new_set->removed_counter = NULL;
+    new_set->removed_fd = -1;
+    if (old_set != NULL) {
+        new_set->counter = old_set->counter;
+        for (i = 0; i < cnt; ++i)
+            new_set->watches[i] = old_set->watches[i];
     }
 
-    pthread_mutex_lock(&inotify_watch_mutex);
-    if (prev)
-        prev->next = cur->next;
-    else
-        inotify_watch_list_head = cur->next;
-    pthread_mutex_unlock(&inotify_watch_mutex);
+    return new_set;
+}
+
+/*
+ * Publish the new set of callbacks of a gpio. If the set is empty, the value
+ * file is not monitored anymore and its file descriptor is stored in value_fd
+ * to be closed once retired. Must be called with registry_mutex locked.
+ */
+static int publish_set(uint8_t gpio_pin, struct callback_set *new_set, int *value_fd)
+{
+    struct pin_slot *slot = &slots[gpio_pin];
+
+    *value_fd = -1;
+    if (new_set->cnt == 0 && new_set->counter == NULL) {
+        if (epoll_ctl(fd, EPOLL_CTL_DEL, slot->fd, NULL) < 0) {
+            fprintf(stderr, "gpio_monitor: Failed to stop waiting for events of gpio %d.\n", gpio_pin);
+            return -1;
+        }
+        *value_fd = slot->fd;
+        __atomic_store_n(&slot->fd, -1, __ATOMIC_RELEASE);
+        free(new_set);
+        new_set = NULL;
+    }
 
-    free(cur);
+    __atomic_store_n(&slot->callbacks, new_set, __ATOMIC_SEQ_CST);
 
     return 0;
 }
 
-static void remove_gpio_watch(int callbackID)
+static int stop_workers(void)
 {
-    struct gpio_watch *cur = gpio_watch_list_head;
-    struct gpio_watch *prev = NULL;
+    int ret = 0;
+    uint8_t i;
 
-    while (cur) {
-        if (cur->ID == callbackID)
-            break;
-        prev = cur;
-        cur = cur->next;
+    if (workers == NULL)
+        return 0;
+
+    workers_running = false;
+    for (i = 0; i < worker_cnt; ++i) {
+        if (workers[i].event_fd < 0)
+            continue;
+
+        if (workers[i].started) {
+            if (eventfd_write(workers[i].event_fd, 1) < 0
+            ||  pthread_join(workers[i].thread, NULL) != 0)
+                ret = -1;
+        }
+        close(workers[i].event_fd);
     }
-    if (cur != NULL) {
-        pthread_mutex_lock(&gpio_watch_mutex);
-        if (prev)
-            prev->next = cur->next;
-        else
-            gpio_watch_list_head = cur->next;
-        pthread_mutex_unlock(&gpio_watch_mutex);
 
-        free(cur);
+    free(workers);
+    workers = NULL;
+
+    return ret;
+}
+
+static int start_workers(void)
+{
+    uint8_t i;
+
+    if (worker_cnt == 0)
+        return 0;
+
+    workers = calloc(worker_cnt, sizeof(struct worker));
+    if (workers == NULL) {
+        fprintf(stderr, "gpio_monitor: Failed to allocate memory for workers.\n");
+        return -1;
     }
+    for (i = 0; i < worker_cnt; ++i)
+        workers[i].event_fd = -1;
+
+    workers_running = true;
+    for (i = 0; i < worker_cnt; ++i) {
+        if ((workers[i].event_fd = eventfd(0, EFD_CLOEXEC)) < 0) {
+            fprintf(stderr, "gpio_monitor: Failed to create eventfd.\n");
+            stop_workers();
+            return -1;
+        }
+
+        if (event_loop_create_thread(&workers[i].thread, run_worker, &workers[i]) < 0) {
+            fprintf(stderr, "gpio_monitor: Failed to start worker.\n");
+            stop_workers();
+            return -1;
+        }
+        workers[i].started = true;
+    }
+
+    return 0;
 }
 
 int gpio_monitor_init(void)
 {
+    struct epoll_event event;
+
     if (fd == -1) {
-        if ((fd = inotify_init()) < 0)
+        uint32_t i;
+
+        if ((fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
             return -1;
+
+        for (i = 0; i < GPIO_PIN_CNT; ++i) {
+            slots[i].fd = -1;
+            slots[i].callbacks = NULL;
+        }
     }
 
-    if (thread_running == true)
+    if (running == true)
         return 0;
 
-    if (pthread_mutex_init(&inotify_watch_mutex, NULL) != 0) {
-        fprintf(stderr, "switch: Error while initialising inotify_watch_mutex\n");
+    if (pthread_mutex_init(&registry_mutex, NULL) != 0) {
+        fprintf(stderr, "gpio_monitor: Error while initialising registry_mutex\n");
+        return -1;
+    }
+
+    if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to create timer.\n");
+        pthread_mutex_destroy(&registry_mutex);
+        return -1;
+    }
+    timer_deadline = 0;
+
+    event.events = EPOLLIN;
+    event.data.u64 = 0;
+    event.data.u32 = TIMER_EVENT_ID;
+    if (epoll_ctl(fd, EPOLL_CTL_ADD, timer_fd, &event) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to wait for timer.\n");
+        close(timer_fd);
+        timer_fd = -1;
+        pthread_mutex_destroy(&registry_mutex);
         return -1;
     }
 
-    if (pthread_mutex_init(&gpio_watch_mutex, NULL) != 0) {
-        fprintf(stderr, "switch: Error while initialising gpio_watch_mutex\n");
-        pthread_mutex_destroy(&inotify_watch_mutex);
+    __atomic_store_n(&inferred_cnt, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring_drop_cnt, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&queue_drop_cnt, 0, __ATOMIC_RELAXED);
+    gpio_monitor_reset_dispatch_latency();
+    __atomic_store_n(&event_ring_head, event_ring_tail, __ATOMIC_RELEASE);
+
+    /* Thread attributes cannot change while the event loop is used, workers get them as well */
+    if (event_loop_init() < 0) {
+        close(timer_fd);
+        timer_fd = -1;
+        pthread_mutex_destroy(&registry_mutex);
         return -1;
     }
 
-    if (pthread_create(&thread, NULL, monitor_gpio, NULL) < 0) {
-        pthread_mutex_destroy(&gpio_watch_mutex);
-        pthread_mutex_destroy(&inotify_watch_mutex);
+    if (start_workers() < 0) {
+        event_loop_release();
+        close(timer_fd);
+        timer_fd = -1;
+        pthread_mutex_destroy(&registry_mutex);
         return -1;
     }
 
+    /* epoll file descriptor becomes readable when a value file or the timer is ready */
+
+    if (event_loop_add_fd(fd, EPOLLIN, handle_events, NULL) < 0) {
+        stop_workers();
+        event_loop_release();
+        close(timer_fd);
+        timer_fd = -1;
+        pthread_mutex_destroy(&registry_mutex);
+        return -1;
+    }
+    running = true;
+
+    return 0;
+}
+
+int gpio_monitor_set_worker_count(uint8_t count)
+{
+    if (running) {
+        fprintf(stderr, "gpio_monitor: Cannot change number of workers while monitor is running.\n");
+        return -1;
+    }
+
+    if (count > MAX_WORKER_CNT) {
+        fprintf(stderr, "gpio_monitor: Number of workers must not exceed %d.\n", MAX_WORKER_CNT);
+        return -1;
+    }
+
+    worker_cnt = count;
+
     return 0;
 }
 
 int gpio_monitor_add_callback(uint8_t gpio_pin, uint8_t event_mask, void(*callback)(uint8_t))
 {
-    struct gpio_watch *watch = NULL;
+    return gpio_monitor_add_debounced_callback(gpio_pin, event_mask, 0, 0, callback);
+}
+
+int gpio_monitor_add_debounced_callback(uint8_t gpio_pin, uint8_t event_mask,
+                                        uint32_t window, uint32_t stable_time,
+                                        void(*callback)(uint8_t))
+{
+    struct callback_set *old_set = NULL, *new_set = NULL;
+    struct debounce *debounce = NULL;
+    int ID, value_fd;
+
+    if (fd < 0) {
+        fprintf(stderr, "gpio_monitor: Monitor must be initialised before adding callbacks.\n");
+        return -1;
+    }
 
     if (event_mask == 0) {
         fprintf(stderr, "gpio_monitor: event_mask is invalid (must not be zero).\n");
@@ -297,78 +942,398 @@ int gpio_monitor_add_callback(uint8_t gpio_pin, uint8_t event_mask, void(*callba
         return -1;
     }
 
-    watch = malloc(sizeof(struct gpio_watch));
-    if (watch == NULL) {
-        fprintf(stderr, "gpio_monitor: Failed to allocate memory for watch.\n");
+    if (window != 0 || stable_time != 0) {
+        debounce = malloc(sizeof(struct debounce));
+        if (debounce == NULL) {
+            fprintf(stderr, "gpio_monitor: Failed to allocate memory for debounce.\n");
+            return -1;
+        }
+
+        debounce->window = window * 1000000ULL;
+        debounce->stable_time = stable_time * 1000000ULL;
+        debounce->last_report = 0;
+        debounce->pending = false;
+    }
+
+    pthread_mutex_lock(&registry_mutex);
+
+    old_set = slots[gpio_pin].callbacks;
+    if ((new_set = copy_set(gpio_pin, 1)) == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        free(debounce);
         return -1;
     }
 
-    /* Start monitoring file */
-    if (has_inotify_watch(gpio_pin) == false) {
-        if (add_inotify_watch(gpio_pin) < 0) {
-            fprintf(stderr, "gpio_monitor: Failed to add inotify watch.\n");
-            free(watch);
-            return -1;
-        }
+    /* Start monitoring value file */
+    if (slots[gpio_pin].fd < 0 && open_value_file(gpio_pin) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to add pin watch.\n");
+        pthread_mutex_unlock(&registry_mutex);
+        free(new_set);
+        free(debounce);
+        return -1;
+    }
+
+    if (debounce != NULL) {
+        debounce->level = __atomic_load_n(&slots[gpio_pin].value, __ATOMIC_RELAXED);
+        debounce->reported_level = debounce->level;
+        __atomic_add_fetch(&debounced_watch_cnt, 1, __ATOMIC_RELAXED);
     }
 
-    /* Create new watch */
-    watch->ID = current_watch_ID;
+    /* Append new callback */
+    new_set->watches[new_set->cnt].ID = current_watch_ID;
+    new_set->watches[new_set->cnt].event_mask = event_mask;
+    new_set->watches[new_set->cnt].callback = callback;
+    new_set->watches[new_set->cnt].debounce = debounce;
+    ++new_set->cnt;
+    ID = current_watch_ID;
     ++current_watch_ID;
-    watch->gpio_pin = gpio_pin;
-    watch->event_mask = event_mask;
-    watch->callback = callback;
-    watch->next = NULL;
 
-    /* Add to end of gpio watch list */
-    if (gpio_watch_list_head == NULL) {
-        pthread_mutex_lock(&gpio_watch_mutex);
-        gpio_watch_list_head = watch;
-        pthread_mutex_unlock(&gpio_watch_mutex);
-    } else {
-        struct gpio_watch *last = gpio_watch_list_head;
-        while (last->next)
-            last = last->next;
-        pthread_mutex_lock(&gpio_watch_mutex);
-        last->next = watch;
-        pthread_mutex_unlock(&gpio_watch_mutex);
-    }
+    publish_set(gpio_pin, new_set, &value_fd);
+    pthread_mutex_unlock(&registry_mutex);
+
+    retire(old_set, -1);
 
-    return watch->ID;
+    return ID;
 }
 
 int gpio_monitor_remove_callback(int callbackID)
 {
-    struct gpio_watch *cur = gpio_watch_list_head;
-    uint8_t gpio_pin = 0;
+    struct callback_set *old_set = NULL, *new_set = NULL;
+    int value_fd = -1;
+    uint32_t gpio_pin, i, j;
 
     if (callbackID < 0 || callbackID >= current_watch_ID) {
         fprintf(stderr, "gpio_monitor: Invalid callback ID.\n");
         return -1;
     }
 
+    if (fd < 0)
+        return -1;
+
+    pthread_mutex_lock(&registry_mutex);
+
     /* Find gpio from callback ID */
-    while (cur) {
-        if (cur->ID == callbackID) {
-            gpio_pin = cur->gpio_pin;
-            break;
+    for (gpio_pin = 0; gpio_pin < GPIO_PIN_CNT; ++gpio_pin) {
+        old_set = slots[gpio_pin].callbacks;
+        if (old_set == NULL)
+            continue;
+
+        for (i = 0; i < old_set->cnt; ++i) {
+            if (old_set->watches[i].ID == callbackID)
+                break;
         }
-        cur = cur->next;
+        if (i < old_set->cnt)
+            break;
     }
-    if (cur == NULL) {
+    if (gpio_pin == GPIO_PIN_CNT) {
         fprintf(stderr, "gpio_monitor: Failed to convert callback ID to gpio pin.\n");
+        pthread_mutex_unlock(&registry_mutex);
         return -1;
     }
 
-    remove_gpio_watch(callbackID);
+    if ((new_set = copy_set(gpio_pin, 0)) == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
 
-    /* No more callback associated with gpio, remove inotify watch */
-    if (is_gpio_monitored(gpio_pin) == false) {
-        if (remove_inotify_watch(gpio_pin) < 0) {
-        fprintf(stderr, "gpio_monitor: Failed to remove inotify watch.\n");
-            return -1;
-        }
+    /* Remove callback, its debounce state is freed with old set */
+    for (i = 0, j = 0; i < old_set->cnt; ++i) {
+        if (old_set->watches[i].ID != callbackID)
+            new_set->watches[j++] = old_set->watches[i];
+        else
+            old_set->removed_debounce = old_set->watches[i].debounce;
+    }
+    new_set->cnt = j;
+
+    /* No more callback or counter associated with gpio, stop monitoring value file */
+    if (publish_set(gpio_pin, new_set, &value_fd) < 0) {
+        pthread_mutex_unlock(&registry_mutex);
+        old_set->removed_debounce = NULL;
+        free(new_set);
+        return -1;
+    }
+    if (old_set->removed_debounce != NULL)
+        __atomic_sub_fetch(&debounced_watch_cnt, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&registry_mutex);
+
+    retire(old_set, value_fd);
+
+    return 0;
+}
+
+int gpio_counter_start(uint8_t gpio_pin, uint8_t event_mask)
+{
+    struct callback_set *old_set = NULL, *new_set = NULL;
+    struct counter *counter = NULL;
+    int value_fd;
+
+    if (fd < 0) {
+        fprintf(stderr, "gpio_monitor: Monitor must be initialised before starting a counter.\n");
+        return -1;
+    }
+
+    if (event_mask == 0) {
+        fprintf(stderr, "gpio_monitor: event_mask is invalid (must not be zero).\n");
+        return -1;
+    }
+
+    if (enable_gpio_interrupt(gpio_pin) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to enable gpio interrupt.\n");
+        return -1;
+    }
+
+    counter = calloc(1, sizeof(struct counter));
+    if (counter == NULL) {
+        fprintf(stderr, "gpio_monitor: Failed to allocate memory for counter.\n");
+        return -1;
+    }
+    counter->event_mask = event_mask;
+
+    pthread_mutex_lock(&registry_mutex);
+
+    old_set = slots[gpio_pin].callbacks;
+    if (old_set != NULL && old_set->counter != NULL) {
+        fprintf(stderr, "gpio_monitor: Counter of gpio %d is already started.\n", gpio_pin);
+        pthread_mutex_unlock(&registry_mutex);
+        free(counter);
+        return -1;
+    }
+
+    if ((new_set = copy_set(gpio_pin, 0)) == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        free(counter);
+        return -1;
+    }
+
+    if (slots[gpio_pin].fd < 0 && open_value_file(gpio_pin) < 0) {
+        fprintf(stderr, "gpio_monitor: Failed to add pin watch.\n");
+        pthread_mutex_unlock(&registry_mutex);
+        free(new_set);
+        free(counter);
+        return -1;
+    }
+
+    new_set->counter = counter;
+    publish_set(gpio_pin, new_set, &value_fd);
+    pthread_mutex_unlock(&registry_mutex);
+
+    retire(old_set, -1);
+
+    return 0;
+}
+
+int gpio_counter_read(uint8_t gpio_pin, uint64_t *count, uint64_t *period)
+{
+    struct callback_set *set = NULL;
+    struct counter *counter = NULL;
+    uint64_t newest_timestamp, oldest_timestamp;
+    uint64_t newest_count, oldest_count;
+    uint64_t now;
+    uint32_t seq, history_cnt;
+
+    if (count == NULL || period == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store counter using null pointer.\n");
+        return -1;
+    }
+
+    if (fd < 0) {
+        fprintf(stderr, "gpio_monitor: Monitor is not initialised.\n");
+        return -1;
+    }
+
+    /* Counter cannot be freed while registry_mutex is locked */
+    pthread_mutex_lock(&registry_mutex);
+    set = slots[gpio_pin].callbacks;
+    if (set == NULL || set->counter == NULL) {
+        fprintf(stderr, "gpio_monitor: Counter of gpio %d is not started.\n", gpio_pin);
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
     }
+    counter = set->counter;
+
+    do {
+        uint32_t index, oldest_index;
+
+        while ((seq = __atomic_load_n(&counter->seq, __ATOMIC_ACQUIRE)) & 1)
+            sched_yield();
+
+        index = counter->history_index;
+        history_cnt = counter->history_cnt;
+        oldest_index = (index + COUNTER_HISTORY_SIZE + 1 - history_cnt) % COUNTER_HISTORY_SIZE;
+        *count = counter->count;
+        newest_timestamp = counter->timestamps[index];
+        newest_count = counter->counts[index];
+        oldest_timestamp = counter->timestamps[oldest_index];
+        oldest_count = counter->counts[oldest_index];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&counter->seq, __ATOMIC_RELAXED) != seq);
+
+    pthread_mutex_unlock(&registry_mutex);
+
+    /* At least two batches of edges are needed to measure the period */
+    *period = 0;
+    if (history_cnt >= 2 && newest_count > oldest_count)
+        *period = (newest_timestamp - oldest_timestamp) / (newest_count - oldest_count);
+
+    /* If no edge occurred for longer than the period, signal slowed down */
+    now = get_timestamp();
+    if (*period != 0 && now - newest_timestamp > *period)
+        *period = now - newest_timestamp;
+
+    return 0;
+}
+
+int gpio_counter_get_frequency(uint8_t gpio_pin, float *frequency)
+{
+    uint64_t count, period;
+
+    if (frequency == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store frequency using null pointer.\n");
+        return -1;
+    }
+
+    if (gpio_counter_read(gpio_pin, &count, &period) < 0)
+        return -1;
+
+    *frequency = 0.f;
+    if (period != 0)
+        *frequency = 1000000000.f / period;
+
+    return 0;
+}
+
+int gpio_counter_stop(uint8_t gpio_pin)
+{
+    struct callback_set *old_set = NULL, *new_set = NULL;
+    int value_fd = -1;
+
+    if (fd < 0)
+        return -1;
+
+    pthread_mutex_lock(&registry_mutex);
+
+    old_set = slots[gpio_pin].callbacks;
+    if (old_set == NULL || old_set->counter == NULL) {
+        fprintf(stderr, "gpio_monitor: Counter of gpio %d is not started.\n", gpio_pin);
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+
+    if ((new_set = copy_set(gpio_pin, 0)) == NULL) {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    new_set->counter = NULL;
+
+    if (publish_set(gpio_pin, new_set, &value_fd) < 0) {
+        pthread_mutex_unlock(&registry_mutex);
+        free(new_set);
+        return -1;
+    }
+    old_set->removed_counter = old_set->counter;
+    pthread_mutex_unlock(&registry_mutex);
+
+    retire(old_set, value_fd);
+
+    return 0;
+}
+
+int gpio_monitor_read_events(struct gpio_event *events, uint32_t count)
+{
+    uint32_t head = event_ring_head;
+    uint32_t tail = __atomic_load_n(&event_ring_tail, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    if (events == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store events using null pointer.\n");
+        return -1;
+    }
+
+    if (count > tail - head)
+        count = tail - head;
+
+    for (i = 0; i < count; ++i)
+        events[i] = event_ring[(head + i) & (EVENT_RING_SIZE - 1)];
+
+    __atomic_store_n(&event_ring_head, head + count, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+int gpio_monitor_get_overflow_count(uint32_t *count)
+{
+    if (count == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store overflow count using null pointer.\n");
+        return -1;
+    }
+
+    *count = __atomic_load_n(&ring_drop_cnt, __ATOMIC_RELAXED)
+           + __atomic_load_n(&queue_drop_cnt, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+int gpio_monitor_get_stats(struct gpio_monitor_stats *stats)
+{
+    if (stats == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store statistics using null pointer.\n");
+        return -1;
+    }
+
+    stats->inferred_cnt = __atomic_load_n(&inferred_cnt, __ATOMIC_RELAXED);
+    stats->ring_drop_cnt = __atomic_load_n(&ring_drop_cnt, __ATOMIC_RELAXED);
+    stats->queue_drop_cnt = __atomic_load_n(&queue_drop_cnt, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+int gpio_monitor_get_dispatch_latency(struct gpio_monitor_latency *report)
+{
+    uint64_t threshold, cnt = 0;
+    uint32_t i;
+
+    if (report == NULL) {
+        fprintf(stderr, "gpio_monitor: Cannot store latency report to null variable.\n");
+        return -1;
+    }
+
+    report->count = __atomic_load_n(&latency.cnt, __ATOMIC_RELAXED);
+    if (report->count == 0) {
+        report->min = 0;
+        report->avg = 0;
+        report->p99 = 0;
+        report->max = 0;
+        return 0;
+    }
+
+    report->min = __atomic_load_n(&latency.min, __ATOMIC_RELAXED);
+    report->max = __atomic_load_n(&latency.max, __ATOMIC_RELAXED);
+    report->avg = __atomic_load_n(&latency.sum, __ATOMIC_RELAXED) / report->count;
+
+    /* Smallest bucket below which at least 99% of callbacks are */
+    threshold = (report->count * 99 + 99) / 100;
+    for (i = 0; i < LATENCY_BUCKET_CNT; ++i) {
+        cnt += __atomic_load_n(&latency.buckets[i], __ATOMIC_RELAXED);
+        if (cnt >= threshold)
+            break;
+    }
+    report->p99 = i < LATENCY_BUCKET_CNT ? get_latency_bucket_max(i) : report->max;
+    if (report->p99 > report->max)
+        report->p99 = report->max;
+
+    return 0;
+}
+
+int gpio_monitor_reset_dispatch_latency(void)
+{
+    uint32_t i;
+
+    __atomic_store_n(&latency.cnt, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&latency.sum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&latency.min, UINT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(&latency.max, 0, __ATOMIC_RELAXED);
+    for (i = 0; i < LATENCY_BUCKET_CNT; ++i)
+        __atomic_store_n(&latency.buckets[i], 0, __ATOMIC_RELAXED);
 
     return 0;
 }
@@ -376,34 +1341,43 @@ int gpio_monitor_remove_callback(int callbackID)
 int gpio_monitor_release(void)
 {
     int ret = 0;
+    uint32_t i;
 
-    if (thread_running == false)
+    if (running == false)
         return 0;
 
-    /* Stop monitoring thread */
-    thread_running = false;
-    if (pthread_join(thread, NULL))
+    /* Stop handling events */
+    if (event_loop_remove_fd(fd) < 0)
         ret = -1;
-    if (pthread_mutex_destroy(&inotify_watch_mutex) < 0)
+    if (stop_workers() < 0)
         ret = -1;
-    if (pthread_mutex_destroy(&gpio_watch_mutex) < 0)
+    if (event_loop_release() < 0)
+        ret = -1;
+    running = false;
+    free_sets(retired_sets);
+    retired_sets = NULL;
+    if (close(timer_fd) < 0)
+        ret = -1;
+    timer_fd = -1;
+    if (pthread_mutex_destroy(&registry_mutex) != 0)
         ret = -1;
 
-    /* Delete all inotify watches */
-    while (inotify_watch_list_head) {
-        struct inotify_watch *tmp = inotify_watch_list_head;
-        inotify_watch_list_head = inotify_watch_list_head->next;
-
-        inotify_rm_watch(fd, tmp->wd);
-        free(tmp);
-    }
-
-    /* Delete all gpio watches */
-    while (gpio_watch_list_head) {
-        struct gpio_watch *tmp = gpio_watch_list_head;
-        gpio_watch_list_head = gpio_watch_list_head->next;
-        free(tmp);
+    /* Close value files and delete callbacks of all monitored gpio's */
+    for (i = 0; i < GPIO_PIN_CNT; ++i) {
+        if (slots[i].fd >= 0)
+            close(slots[i].fd);
+        slots[i].fd = -1;
+
+        if (slots[i].callbacks != NULL) {
+            uint32_t j;
+            for (j = 0; j < slots[i].callbacks->cnt; ++j)
+                free(slots[i].callbacks->watches[j].debounce);
+            free(slots[i].callbacks->counter);
+            free_sets(slots[i].callbacks);
+        }
+        slots[i].callbacks = NULL;
     }
+    debounced_watch_cnt = 0;
 
     /* Release file descriptor */
     if (close(fd) < 0)
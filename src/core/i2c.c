@@ -1,31 +1,66 @@
 #include <stdio.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
+#include <linux/i2c.h>
 #include <linux/i2c-dev.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include "letmecreate/core/i2c.h"
 #include "letmecreate/core/common.h"
 
 #define MIKROBUS_I2C_PATH_1 "/dev/i2c-0"
 #define MIKROBUS_I2C_PATH_2 "/dev/i2c-1"
+#define MAX_MESSAGE_CNT     (I2C_RDWR_IOCTL_MAX_MSGS)
 
 
 static int fds[] = { -1, -1 };
 static uint8_t current_mikrobus_index = MIKROBUS_1;
 
-static int i2c_select_slave(int fd, uint16_t address)
+/*
+ * Held while a bus is used, so that several threads can share a bus, and
+ * both buses can be used at the same time from different threads.
+ */
+static pthread_mutex_t bus_mutexes[] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+
+/*
+ * Slave address last selected with I2C_SLAVE on each bus, -1 if none. The
+ * kernel keeps it per file descriptor, so it is reset whenever a bus is
+ * opened or closed. I2C_RDWR does not change it.
+ */
+static int slave_addresses[] = { -1, -1 };
+
+static int i2c_select_slave(uint8_t mikrobus_index, uint16_t address)
 {
-    if (ioctl(fd, I2C_SLAVE, address) < 0) {
+    if (slave_addresses[mikrobus_index] == address)
+        return 0;
+
+    if (ioctl(fds[mikrobus_index], I2C_SLAVE, address) < 0) {
         fprintf(stderr, "i2c: Failed to select slave address.\n");
+        slave_addresses[mikrobus_index] = -1;
         return -1;
     }
+    slave_addresses[mikrobus_index] = address;
 
     return 0;
 }
 
+static bool check_mikrobus_index(uint8_t mikrobus_index)
+{
+    if (mikrobus_index == MIKROBUS_1)
+        return true;
+    if (mikrobus_index == MIKROBUS_2)
+        return true;
+
+    fprintf(stderr, "i2c: Invalid mikrobus index.\n");
+    return false;
+}
+
 static int i2c_init_bus(uint8_t mikrobus_index)
 {
     const char *i2c_path = NULL;
+    char path[MAX_STR_LENGTH];
+    int ret = 0;
 
     switch (mikrobus_index) {
     case MIKROBUS_1:
@@ -36,15 +71,20 @@ static int i2c_init_bus(uint8_t mikrobus_index)
         break;
     }
 
-    if (fds[mikrobus_index] >= 0)
-        return 0;
-
-    if ((fds[mikrobus_index] = open(i2c_path, O_RDWR)) < 0) {
-        fprintf(stderr, "i2c: Cannot open device for bus %d.\n", mikrobus_index);
+    if (create_device_path(path, "%s", i2c_path) < 0)
         return -1;
+
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    if (fds[mikrobus_index] < 0) {
+        if ((fds[mikrobus_index] = open(path, O_RDWR)) < 0) {
+            fprintf(stderr, "i2c: Cannot open device for bus %d.\n", mikrobus_index);
+            ret = -1;
+        }
+        slave_addresses[mikrobus_index] = -1;
     }
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
 
-    return 0;
+    return ret;
 }
 
 static int i2c_release_bus(uint8_t mikrobus_index)
@@ -53,10 +93,13 @@ static int i2c_release_bus(uint8_t mikrobus_index)
     switch (mikrobus_index) {
     case MIKROBUS_1:
     case MIKROBUS_2:
+        pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
         if (fds[mikrobus_index] >= 0) {
             ret = close(fds[mikrobus_index]);
             fds[mikrobus_index] = -1;
+            slave_addresses[mikrobus_index] = -1;
         }
+        pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
         break;
     }
 
@@ -76,21 +119,23 @@ void i2c_select_bus(uint8_t mikrobus_index)
     switch (mikrobus_index) {
     case MIKROBUS_1:
     case MIKROBUS_2:
-        current_mikrobus_index = mikrobus_index;
+        __atomic_store_n(&current_mikrobus_index, mikrobus_index, __ATOMIC_RELAXED);
     }
 }
 
 uint8_t i2c_get_current_bus(void)
 {
-    return current_mikrobus_index;
+    return __atomic_load_n(&current_mikrobus_index, __ATOMIC_RELAXED);
 }
 
-int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count)
+/* Must be called with mutex of the bus held */
+static int i2c_write_bus(uint8_t mikrobus_index, uint16_t slave_address,
+                         const uint8_t *buffer, uint32_t count)
 {
     int ret, fd;
     uint32_t nbBytesSent;
 
-    fd = fds[current_mikrobus_index];
+    fd = fds[mikrobus_index];
     if (fd < 0) {
         fprintf(stderr, "i2c: Cannot write to unitialized bus.\n");
         return -1;
@@ -104,7 +149,7 @@ int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count)
     if (count == 0)
         return 0;
 
-    if ((ret = i2c_select_slave(fd, slave_address)) < 0)
+    if ((ret = i2c_select_slave(mikrobus_index, slave_address)) < 0)
         return ret;
 
     nbBytesSent = 0;
@@ -121,12 +166,14 @@ int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count)
     return nbBytesSent;
 }
 
-int i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count)
+/* Must be called with mutex of the bus held */
+static int i2c_read_bus(uint8_t mikrobus_index, uint16_t slave_address,
+                        uint8_t *buffer, uint32_t count)
 {
     int ret, fd;
     uint32_t nbBytesReceived;
 
-    fd = fds[current_mikrobus_index];
+    fd = fds[mikrobus_index];
     if (fd < 0) {
         fprintf(stderr, "i2c: Cannot read using unitialized bus.\n");
         return -1;
@@ -140,7 +187,7 @@ int i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count)
     if (count == 0)
         return 0;
 
-    if ((ret = i2c_select_slave(fd, slave_address)) < 0)
+    if ((ret = i2c_select_slave(mikrobus_index, slave_address)) < 0)
         return ret;
 
     nbBytesReceived = 0;
@@ -157,6 +204,123 @@ int i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count)
     return nbBytesReceived;
 }
 
+int i2c_device_write(const struct i2c_device *device, const uint8_t *buffer, uint32_t count)
+{
+    int ret;
+
+    if (device == NULL) {
+        fprintf(stderr, "i2c: Cannot write using null device.\n");
+        return -1;
+    }
+
+    if (!check_mikrobus_index(device->mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&bus_mutexes[device->mikrobus_index]);
+    ret = i2c_write_bus(device->mikrobus_index, device->slave_address, buffer, count);
+    pthread_mutex_unlock(&bus_mutexes[device->mikrobus_index]);
+
+    return ret;
+}
+
+int i2c_device_read(const struct i2c_device *device, uint8_t *buffer, uint32_t count)
+{
+    int ret;
+
+    if (device == NULL) {
+        fprintf(stderr, "i2c: Cannot read using null device.\n");
+        return -1;
+    }
+
+    if (!check_mikrobus_index(device->mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&bus_mutexes[device->mikrobus_index]);
+    ret = i2c_read_bus(device->mikrobus_index, device->slave_address, buffer, count);
+    pthread_mutex_unlock(&bus_mutexes[device->mikrobus_index]);
+
+    return ret;
+}
+
+int i2c_write(uint16_t slave_address, const uint8_t *buffer, uint32_t count)
+{
+    struct i2c_device device = { i2c_get_current_bus(), slave_address };
+
+    return i2c_device_write(&device, buffer, count);
+}
+
+int i2c_read(uint16_t slave_address, uint8_t *buffer, uint32_t count)
+{
+    struct i2c_device device = { i2c_get_current_bus(), slave_address };
+
+    return i2c_device_read(&device, buffer, count);
+}
+
+int i2c_transfer(uint8_t mikrobus_index, const struct i2c_message *messages, uint32_t count)
+{
+    struct i2c_msg msgs[MAX_MESSAGE_CNT];
+    struct i2c_rdwr_ioctl_data data;
+    uint32_t i;
+    int ret = 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    if (messages == NULL) {
+        fprintf(stderr, "i2c: Cannot transfer using invalid messages.\n");
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    if (count > MAX_MESSAGE_CNT) {
+        fprintf(stderr, "i2c: Cannot transfer more than %d messages at once.\n", MAX_MESSAGE_CNT);
+        return -1;
+    }
+
+    for (i = 0; i < count; ++i) {
+        if (messages[i].buffer == NULL && messages[i].count > 0) {
+            fprintf(stderr, "i2c: Cannot transfer using invalid buffer.\n");
+            return -1;
+        }
+
+        if (messages[i].count > UINT16_MAX) {
+            fprintf(stderr, "i2c: Cannot transfer more than %d bytes in a message.\n", UINT16_MAX);
+            return -1;
+        }
+
+        if (messages[i].slave_address > (messages[i].ten_bit_address ? 0x3FF : 0x7F)) {
+            fprintf(stderr, "i2c: Invalid slave address 0x%x.\n", messages[i].slave_address);
+            return -1;
+        }
+
+        msgs[i].addr = messages[i].slave_address;
+        msgs[i].flags = 0;
+        if (messages[i].read)
+            msgs[i].flags |= I2C_M_RD;
+        if (messages[i].ten_bit_address)
+            msgs[i].flags |= I2C_M_TEN;
+        msgs[i].len = messages[i].count;
+        msgs[i].buf = messages[i].buffer;
+    }
+
+    data.msgs = msgs;
+    data.nmsgs = count;
+
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "i2c: Cannot transfer using unitialized bus.\n");
+        ret = -1;
+    } else if (ioctl(fds[mikrobus_index], I2C_RDWR, &data) < 0) {
+        fprintf(stderr, "i2c: Failed to transfer messages.\n");
+        ret = -1;
+    }
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
 int i2c_write_byte(uint16_t slave_address, uint8_t data)
 {
     return i2c_write(slave_address, &data, 1);
@@ -13,6 +13,15 @@
 
 
 int fds[LED_CNT] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+static int trigger_fds[LED_CNT] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+
+/*
+ * Files delay_on and delay_off only exist while the led is in timer mode. They
+ * are opened the first time delays are set and closed whenever the trigger
+ * changes, since the kernel creates new files each time the trigger is set.
+ */
+static int delay_on_fds[LED_CNT] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+static int delay_off_fds[LED_CNT] = { -1, -1, -1, -1, -1, -1, -1, -1 };
 
 static int build_file_path(char *path, uint8_t led_index, const char *filename)
 {
@@ -32,12 +41,12 @@ static int build_file_path(char *path, uint8_t led_index, const char *filename)
     }
 
     if(led_index == 7) {
-        if (sprintf(path, LED_HEARTBEAT_DEVICE_FILE_PATH, filename) < 0) {
+        if (create_device_path(path, LED_HEARTBEAT_DEVICE_FILE_PATH, filename) < 0) {
             fprintf(stderr, "led: Failed to build %s device file path for led heartbeat\n", filename);
             return -1;
         }
     } else {
-        if (sprintf(path, LED_DEVICE_FILE_PATH, led_index+1, filename) < 0) {
+        if (create_device_path(path, LED_DEVICE_FILE_PATH, led_index+1, filename) < 0) {
             fprintf(stderr, "led: Failed to build %s device file path for led %d\n", filename, led_index);
             return -1;
         }
@@ -48,37 +57,78 @@ static int build_file_path(char *path, uint8_t led_index, const char *filename)
 
 static int set_value(uint8_t led_index, uint8_t value)
 {
-    char *str = NULL;
-
-    if (led_index > LED_CNT)
+    if (led_index >= LED_CNT)
         return -1;
 
-    if (value == 0)
-        str = "0";
-    else
-        str = "1";
+    return write_str_fd(fds[led_index], value == 0 ? "0" : "1");
+}
+
+static void close_delay_files(uint8_t led_index)
+{
+    if (delay_on_fds[led_index] >= 0) {
+        close(delay_on_fds[led_index]);
+        delay_on_fds[led_index] = -1;
+    }
 
-    return write(fds[led_index], str, 2);
+    if (delay_off_fds[led_index] >= 0) {
+        close(delay_off_fds[led_index]);
+        delay_off_fds[led_index] = -1;
+    }
+}
+
+static int open_delay_files(uint8_t led_index)
+{
+    char path[MAX_STR_LENGTH];
+
+    if (delay_on_fds[led_index] < 0) {
+        if (build_file_path(path, led_index, "delay_on") < 0)
+            return -1;
+
+        if ((delay_on_fds[led_index] = open_device_file(path, O_WRONLY)) < 0)
+            return -1;
+    }
+
+    if (delay_off_fds[led_index] < 0) {
+        if (build_file_path(path, led_index, "delay_off") < 0)
+            return -1;
+
+        if ((delay_off_fds[led_index] = open_device_file(path, O_WRONLY)) < 0)
+            return -1;
+    }
+
+    return 0;
 }
 
 static int set_mode(uint8_t led_index, char *mode)
 {
     char path[MAX_STR_LENGTH];
 
+    if (led_index >= LED_CNT)
+        return -1;
+
+    close_delay_files(led_index);
+
+    /* Trigger files are kept open between led_init and led_release */
+    if (trigger_fds[led_index] >= 0)
+        return write_str_fd(trigger_fds[led_index], mode);
+
     if (build_file_path(path, led_index, "trigger") < 0)
         return -1;
 
     return write_str_file(path, mode);
 }
 
-static int set_delay(uint8_t led_index, const char *filename, uint32_t value)
+static int get_mode(uint8_t led_index, char *str)
 {
     char path[MAX_STR_LENGTH];
 
-    if (build_file_path(path, led_index, filename) < 0)
+    if (trigger_fds[led_index] >= 0)
+        return read_str_fd(trigger_fds[led_index], str, MAX_STR_LENGTH);
+
+    if (build_file_path(path, led_index, "trigger") < 0)
         return -1;
 
-    return write_int_file(path, value);
+    return read_str_file(path, str, MAX_STR_LENGTH);
 }
 
 int led_init(void)
@@ -88,6 +138,14 @@ int led_init(void)
     for (; i < LED_CNT; ++i) {
         char path[MAX_STR_LENGTH];
 
+        if (trigger_fds[i] < 0) {
+            if (build_file_path(path, i, "trigger") < 0)
+                return -1;
+
+            if ((trigger_fds[i] = open_device_file(path, O_RDWR)) < 0)
+                return -1;
+        }
+
         if (set_mode(i, "none") < 0)
             return -1;
 
@@ -174,12 +232,11 @@ int led_configure_timer_mode(uint8_t mask)
         }
     }
 
-    return led_set_delay(ALL_LEDS, 0, 500);
+    return led_set_delay(mask, 0, 500);
 }
 
 int led_get_mode(uint8_t led_index, uint8_t *led_mode)
 {
-    char path[MAX_STR_LENGTH];
     char str[MAX_STR_LENGTH];
     uint8_t index;
 
@@ -218,10 +275,7 @@ int led_get_mode(uint8_t led_index, uint8_t *led_mode)
         return -1;
     }
 
-    if (build_file_path(path, index, "trigger") < 0)
-        return -1;
-
-    if (read_str_file(path, str, MAX_STR_LENGTH) < 0)
+    if (get_mode(index, str) < 0)
         return -1;
 
     if (strstr(str, "[none]") != NULL)
@@ -238,18 +292,23 @@ int led_get_mode(uint8_t led_index, uint8_t *led_mode)
 
 int led_set_delay(uint8_t mask, uint32_t delay_on, uint32_t delay_off)
 {
+    struct write_batch batch;
     int i = 0, tmp = 1;
 
+    write_batch_init(&batch);
     for (; i < LED_CNT; ++i, tmp <<= 1) {
         if ((mask & tmp) == 0)
             continue;
 
-        if (set_delay(i, "delay_on", delay_on) < 0
-        ||  set_delay(i, "delay_off", delay_off) < 0)
+        if (open_delay_files(i) < 0
+        ||  write_batch_add_int(&batch, delay_on_fds[i], delay_on) < 0
+        ||  write_batch_add_int(&batch, delay_off_fds[i], delay_off) < 0) {
+            fprintf(stderr, "led: Failed to set delays of led %d\n", i);
             return -1;
+        }
     }
 
-    return 0;
+    return write_batch_submit(&batch);
 }
 
 int led_release(void)
@@ -257,17 +316,23 @@ int led_release(void)
     int i = 0;
 
     for (; i < LED_CNT; ++i) {
-        if (fds[i] < 0)
-            continue;
-
-        if (led_switch_off(1 << i) < 0)
-            return -1;
+        if (fds[i] >= 0) {
+            if (led_switch_off(1 << i) < 0)
+                return -1;
+
+            if (close(fds[i]) < 0) {
+                fprintf(stderr, "led: Failed to close file descriptor for led %d\n", i);
+                return -1;
+            }
+            fds[i] = -1;
+        }
 
-        if (close(fds[i]) < 0) {
-            fprintf(stderr, "led: Failed to close file descriptor for led %d\n", i);
-            return -1;
+        if (trigger_fds[i] >= 0) {
+            close(trigger_fds[i]);
+            trigger_fds[i] = -1;
         }
-        fds[i] = -1;
+
+        close_delay_files(i);
     }
 
     return 0;
@@ -13,7 +13,21 @@
 #define DEVICE_FILE_BASE_PATH           "/sys/class/pwm/pwmchip0/"
 #define PWM_DEVICE_FILE_BASE_PATH       "/sys/class/pwm/pwmchip0/pwm"
 
+/* Attribute files of a PWM pin */
+enum PWM_FILE {
+    PWM_ENABLE,
+    PWM_PERIOD,
+    PWM_DUTY_CYCLE,
+    PWM_FILE_CNT
+};
+
+static const char *file_names[PWM_FILE_CNT] = { "enable", "period", "duty_cycle" };
+
 static bool pin_initialised[2] = { false, false };
+static int fds[2][PWM_FILE_CNT] = {
+    { -1, -1, -1 },
+    { -1, -1, -1 }
+};
 
 static bool check_mikrobus_index(uint8_t mikrobus_index)
 {
@@ -31,7 +45,7 @@ static bool is_pwm_pin_exported(uint8_t mikrobus_index)
     DIR *dir = NULL;
     char path[MAX_STR_LENGTH];
 
-    if (snprintf(path, MAX_STR_LENGTH, PWM_DEVICE_FILE_BASE_PATH"%d", mikrobus_index) < 0)
+    if (create_device_path(path, PWM_DEVICE_FILE_BASE_PATH"%d", mikrobus_index) < 0)
         return false;
 
     dir = opendir(path);
@@ -43,44 +57,61 @@ static bool is_pwm_pin_exported(uint8_t mikrobus_index)
     return true;
 }
 
-static int write_str_pwm_file(uint8_t mikrobus_index, const char *file_name, const char *str)
+/*
+ * Attribute files of a PWM pin are opened in pwm_init and kept open until the pin is released,
+ * so that each access costs a single syscall.
+ */
+static int open_pwm_files(uint8_t mikrobus_index)
 {
-    char path[MAX_STR_LENGTH];
+    unsigned int i;
 
-    if (snprintf(path, MAX_STR_LENGTH, PWM_DEVICE_FILE_BASE_PATH"%d/%s", mikrobus_index, file_name) < 0) {
-        fprintf(stderr, "pwm: Could not write to file %s of pwm pin %d.\n", file_name, mikrobus_index);
-        return -1;
+    for (i = 0; i < PWM_FILE_CNT; ++i) {
+        char path[MAX_STR_LENGTH];
+
+        if (create_device_path(path, PWM_DEVICE_FILE_BASE_PATH"%d/%s", mikrobus_index, file_names[i]) < 0) {
+            fprintf(stderr, "pwm: Could not open file %s of pwm pin %d.\n", file_names[i], mikrobus_index);
+            return -1;
+        }
+
+        if ((fds[mikrobus_index][i] = open_device_file(path, O_RDWR)) < 0)
+            return -1;
     }
 
-    return write_str_file(path, str);
+    return 0;
 }
 
-static int write_int_pwm_file(uint8_t mikrobus_index, const char *file_name, uint32_t value)
+static void close_pwm_files(uint8_t mikrobus_index)
 {
-    char str[MAX_STR_LENGTH];
+    unsigned int i;
 
-    if (snprintf(str, MAX_STR_LENGTH, "%d", value) < 0) {
-        fprintf(stderr, "pwm: Failed to convert %d to string.\n", value);
-        return -1;
+    for (i = 0; i < PWM_FILE_CNT; ++i) {
+        if (fds[mikrobus_index][i] >= 0) {
+            close(fds[mikrobus_index][i]);
+            fds[mikrobus_index][i] = -1;
+        }
     }
-
-    return write_str_pwm_file(mikrobus_index, file_name, str);
 }
 
-static int read_int_pwm_file(uint8_t mikrobus_index, const char *file_name, uint32_t *value)
+static int write_str_pwm_file(uint8_t mikrobus_index, uint8_t file, const char *str)
 {
-    char path[MAX_STR_LENGTH];
+    return write_str_fd(fds[mikrobus_index][file], str);
+}
 
-    if (snprintf(path, MAX_STR_LENGTH, PWM_DEVICE_FILE_BASE_PATH"%d/%s", mikrobus_index, file_name) < 0) {
-        fprintf(stderr, "pwm: Could not read from file %s of pwm pin %d.\n", file_name, mikrobus_index);
-        return -1;
-    }
+static int write_int_pwm_file(uint8_t mikrobus_index, uint8_t file, uint32_t value)
+{
+    return write_int_fd(fds[mikrobus_index][file], value);
+}
 
-    return read_int_file(path, value);
+static int read_int_pwm_file(uint8_t mikrobus_index, uint8_t file, uint32_t *value)
+{
+    return read_int_fd(fds[mikrobus_index][file], value);
 }
 
 int pwm_init(uint8_t mikrobus_index)
 {
+    char path[MAX_STR_LENGTH];
+    struct write_batch batch;
+
     if (!check_mikrobus_index(mikrobus_index))
         return -1;
 
@@ -88,15 +119,20 @@ int pwm_init(uint8_t mikrobus_index)
         return 0;
 
     if (!is_pwm_pin_exported(mikrobus_index)) {
-        if (export_pin(DEVICE_FILE_BASE_PATH, mikrobus_index) < 0)
+        if (create_device_path(path, DEVICE_FILE_BASE_PATH) < 0
+        ||  export_pin(path, mikrobus_index) < 0)
             return -1;
     }
 
     pin_initialised[mikrobus_index] = true;
 
-    if (pwm_disable(mikrobus_index) < 0
-    ||  write_int_pwm_file(mikrobus_index, "period", 333333) < 0
-    ||  write_int_pwm_file(mikrobus_index, "duty_cycle", 166666) < 0) {
+    /* Disable the output before changing period and duty cycle */
+    write_batch_init(&batch);
+    if (open_pwm_files(mikrobus_index) < 0
+    ||  write_batch_add_str(&batch, fds[mikrobus_index][PWM_ENABLE], "0") < 0
+    ||  write_batch_add_int(&batch, fds[mikrobus_index][PWM_PERIOD], 333333) < 0
+    ||  write_batch_add_int(&batch, fds[mikrobus_index][PWM_DUTY_CYCLE], 166666) < 0
+    ||  write_batch_submit(&batch) < 0) {
         pwm_release(mikrobus_index);
         return -1;
     }
@@ -114,7 +150,7 @@ int pwm_enable(uint8_t mikrobus_index)
         return -1;
     }
 
-    return write_str_pwm_file(mikrobus_index, "enable", "1");
+    return write_str_pwm_file(mikrobus_index, PWM_ENABLE, "1");
 }
 
 int pwm_set_duty_cycle(uint8_t mikrobus_index, float percentage)
@@ -142,7 +178,7 @@ int pwm_set_duty_cycle(uint8_t mikrobus_index, float percentage)
     duty_cycle = period * (percentage / 100.f);
     if (duty_cycle < 45)
         duty_cycle = 45;
-    return write_int_pwm_file(mikrobus_index, "duty_cycle", duty_cycle);
+    return write_int_pwm_file(mikrobus_index, PWM_DUTY_CYCLE, duty_cycle);
 }
 
 int pwm_get_duty_cycle(uint8_t mikrobus_index, float *percentage)
@@ -163,10 +199,10 @@ int pwm_get_duty_cycle(uint8_t mikrobus_index, float *percentage)
         return -1;
     }
 
-    if (read_int_pwm_file(mikrobus_index, "period", &period) < 0)
+    if (read_int_pwm_file(mikrobus_index, PWM_PERIOD, &period) < 0)
         return -1;
 
-    if (read_int_pwm_file(mikrobus_index, "duty_cycle", &duty_cycle) < 0)
+    if (read_int_pwm_file(mikrobus_index, PWM_DUTY_CYCLE, &duty_cycle) < 0)
         return -1;
 
     if (period == 0)
@@ -186,6 +222,7 @@ int pwm_set_period(uint8_t mikrobus_index, uint32_t period)
 {
     float percentage = 0.f;
     uint32_t old_period = 0, old_duty_cycle = 0, duty_cycle = 0;
+    struct write_batch batch;
 
     if (!check_mikrobus_index(mikrobus_index))
         return -1;
@@ -215,17 +252,19 @@ int pwm_set_period(uint8_t mikrobus_index, uint32_t period)
     if (duty_cycle < 45)
         duty_cycle = 45;
 
+    /* Duty cycle must never be greater than period */
+    write_batch_init(&batch);
     if (old_duty_cycle > period) {
-        if (write_int_pwm_file(mikrobus_index, "duty_cycle", duty_cycle) < 0)
+        if (write_batch_add_int(&batch, fds[mikrobus_index][PWM_DUTY_CYCLE], duty_cycle) < 0
+        ||  write_batch_add_int(&batch, fds[mikrobus_index][PWM_PERIOD], period) < 0)
             return -1;
-
-        return write_int_pwm_file(mikrobus_index, "period", period);
     } else {
-        if (write_int_pwm_file(mikrobus_index, "period", period) < 0)
+        if (write_batch_add_int(&batch, fds[mikrobus_index][PWM_PERIOD], period) < 0
+        ||  write_batch_add_int(&batch, fds[mikrobus_index][PWM_DUTY_CYCLE], duty_cycle) < 0)
             return -1;
-
-        return write_int_pwm_file(mikrobus_index, "duty_cycle", duty_cycle);
     }
+
+    return write_batch_submit(&batch);
 }
 
 int pwm_get_period(uint8_t mikrobus_index, uint32_t *period)
@@ -243,7 +282,7 @@ int pwm_get_period(uint8_t mikrobus_index, uint32_t *period)
         return -1;
     }
 
-    return read_int_pwm_file(mikrobus_index, "period", period);
+    return read_int_pwm_file(mikrobus_index, PWM_PERIOD, period);
 }
 
 int pwm_get_frequency(uint8_t mikrobus_index, uint32_t *frequency)
@@ -273,19 +312,24 @@ int pwm_disable(uint8_t mikrobus_index)
         return -1;
     }
 
-    return write_str_pwm_file(mikrobus_index, "enable", "0");
+    return write_str_pwm_file(mikrobus_index, PWM_ENABLE, "0");
 }
 
 int pwm_release(uint8_t mikrobus_index)
 {
+    char path[MAX_STR_LENGTH];
+
     if (!check_mikrobus_index(mikrobus_index))
         return -1;
 
     if (!pin_initialised[mikrobus_index])
         return 0;
 
+    close_pwm_files(mikrobus_index);
+
     if (is_pwm_pin_exported(mikrobus_index)) {
-        if (unexport_pin(DEVICE_FILE_BASE_PATH, mikrobus_index) < 0)
+        if (create_device_path(path, DEVICE_FILE_BASE_PATH) < 0
+        ||  unexport_pin(path, mikrobus_index) < 0)
             return -1;
     }
 
@@ -2,6 +2,8 @@
 #include <linux/spi/spidev.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
@@ -16,13 +18,32 @@
 static int fds[] = { -1, -1 };
 static uint8_t current_mikrobus_index = MIKROBUS_1;
 
-static int spi_init_bus(uint8_t mikrobus_index)
+/*
+ * Held while a bus is used, so that several threads can share a bus, and
+ * both buses can be used at the same time from different threads.
+ */
+static pthread_mutex_t bus_mutexes[] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+
+static bool check_mikrobus_index(uint8_t mikrobus_index)
+{
+    if (mikrobus_index == MIKROBUS_1)
+        return true;
+    if (mikrobus_index == MIKROBUS_2)
+        return true;
+
+    fprintf(stderr, "spi: Invalid mikrobus index.\n");
+    return false;
+}
+
+/* Must be called with mutex of the bus held */
+static int spi_open_bus(uint8_t mikrobus_index)
 {
     int fd = -1;
     uint8_t bits_per_word = BITS_PER_WORD;
     uint32_t speed = SPI_2M73;
     uint32_t mode = SPI_MODE_3;
     const char *spi_path = NULL;
+    char path[MAX_STR_LENGTH];
 
     switch (mikrobus_index) {
     case MIKROBUS_1:
@@ -31,15 +52,15 @@ static int spi_init_bus(uint8_t mikrobus_index)
     case MIKROBUS_2:
         spi_path = MIKROBUS_SPI_PATH_2;
         break;
-    default:
-        fprintf(stderr, "spi: Invalid mikrobus index.\n");
-        return -1;
     }
 
     if (fds[mikrobus_index] >= 0)
         return 0;
 
-    if ((fd = open(spi_path, O_RDWR)) == -1) {
+    if (create_device_path(path, "%s", spi_path) < 0)
+        return -1;
+
+    if ((fd = open(path, O_RDWR)) == -1) {
         fprintf(stderr, "spi: Failed to open device.\n");
         return -1;
     }
@@ -64,15 +85,31 @@ static int spi_init_bus(uint8_t mikrobus_index)
     return fd;
 }
 
+static int spi_init_bus(uint8_t mikrobus_index)
+{
+    int ret;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    ret = spi_open_bus(mikrobus_index);
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
 static int spi_release_bus(uint8_t mikrobus_index)
 {
     switch (mikrobus_index) {
     case MIKROBUS_1:
     case MIKROBUS_2:
+        pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
         if (fds[mikrobus_index] >= 0) {
             close(fds[mikrobus_index]);
             fds[mikrobus_index] = -1;
         }
+        pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
         break;
     default:
         fprintf(stderr, "spi: Invalid mikrobus index.\n");
@@ -101,32 +138,42 @@ int spi_init(void)
 
 int spi_set_mode(uint8_t mikrobus_index, uint32_t mode)
 {
-    if (fds[mikrobus_index] < 0) {
-        fprintf(stderr, "spi: Cannot set mode of uninitialised bus.\n");
+    int ret = 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
-    }
 
-    if (ioctl(fds[mikrobus_index], SPI_IOC_WR_MODE, &mode) < 0) {
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "spi: Cannot set mode of uninitialised bus.\n");
+        ret = -1;
+    } else if (ioctl(fds[mikrobus_index], SPI_IOC_WR_MODE, &mode) < 0) {
         fprintf(stderr, "spi: Failed to set mode.\n");
-        return -1;
+        ret = -1;
     }
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
 
-    return 0;
+    return ret;
 }
 
 int spi_set_speed(uint8_t mikrobus_index, uint32_t speed)
 {
-    if (fds[mikrobus_index] < 0) {
-        fprintf(stderr, "spi: Cannot set mode of uninitialised bus.\n");
+    int ret = 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
-    }
 
-    if (ioctl(fds[mikrobus_index], SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "spi: Cannot set mode of uninitialised bus.\n");
+        ret = -1;
+    } else if (ioctl(fds[mikrobus_index], SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
         fprintf(stderr, "spi: Failed to set speed.\n");
-        return -1;
+        ret = -1;
     }
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
 
-    return 0;
+    return ret;
 }
 
 void spi_select_bus(uint8_t mikrobus_index)
@@ -134,21 +181,22 @@ void spi_select_bus(uint8_t mikrobus_index)
     switch (mikrobus_index) {
     case MIKROBUS_1:
     case MIKROBUS_2:
-        current_mikrobus_index = mikrobus_index;
+        __atomic_store_n(&current_mikrobus_index, mikrobus_index, __ATOMIC_RELAXED);
     }
 }
 
 uint8_t spi_get_current_bus(void)
 {
-    return current_mikrobus_index;
+    return __atomic_load_n(&current_mikrobus_index, __ATOMIC_RELAXED);
 }
 
-int spi_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
+/* Must be called with mutex of the bus held */
+static int spi_transfer_bus(uint8_t mikrobus_index, const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
 {
     int fd;
     struct spi_ioc_transfer tr;
 
-    fd = fds[current_mikrobus_index];
+    fd = fds[mikrobus_index];
     if (fd < 0)  {
         fprintf(stderr, "spi: Cannot make transfer with invalid file descriptor.\n");
         return -1;
@@ -175,6 +223,25 @@ int spi_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
     return 0;
 }
 
+int spi_bus_transfer(uint8_t mikrobus_index, const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
+{
+    int ret;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&bus_mutexes[mikrobus_index]);
+    ret = spi_transfer_bus(mikrobus_index, tx_buffer, rx_buffer, count);
+    pthread_mutex_unlock(&bus_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
+int spi_transfer(const uint8_t *tx_buffer, uint8_t *rx_buffer, uint32_t count)
+{
+    return spi_bus_transfer(spi_get_current_bus(), tx_buffer, rx_buffer, count);
+}
+
 int spi_release(void)
 {
     if (spi_release_bus(MIKROBUS_1) < 0) {
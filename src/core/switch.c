@@ -1,24 +1,59 @@
 #include <fcntl.h>
 #include <linux/input.h>
-#include <poll.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
+#include "letmecreate/core/common.h"
+#include "letmecreate/core/event_loop.h"
 #include "letmecreate/core/switch.h"
 
 #define DEVICE_FILE         "/dev/input/event1"
-#define TIMEOUT             (20)        /* 20 ms timeout while polling */
 #define SWITCH_1_CODE       (257)
 #define SWITCH_2_CODE       (258)
+#define MAX_EVENT_CNT       (64)        /* Maximum number of events read at once */
+#define SWITCH_CNT          (2)
+#define MAX_REPORT_CNT      (3 * SWITCH_CNT)    /* End of clicks, long press and repeat of each switch */
+
+#define DEFAULT_MULTI_CLICK_TIME    (300)   /* ms */
+#define DEFAULT_LONG_PRESS_TIME     (800)
+#define DEFAULT_REPEAT_DELAY        (500)
+#define DEFAULT_REPEAT_PERIOD       (100)
+
+/*
+ * The input device reports changes of keys as packets of EV_KEY events
+ * terminated by a SYN_REPORT event, all stamped with the time of the
+ * interrupt (CLOCK_MONOTONIC once selected with EVIOCSCLOCKID). Packets may
+ * span several reads, so changes are kept until their SYN_REPORT arrives. If
+ * the buffer of the kernel overflows, it sends SYN_DROPPED: events are then
+ * ignored up to the next SYN_REPORT, and the state of keys is read with
+ * EVIOCGKEY to report changes which were lost.
+ *
+ * Gestures are recognised from the same changes. Each switch has at most
+ * three deadlines (end of a series of clicks, long press and next repeat), so
+ * the event loop scans them and arms a single timerfd at the earliest one.
+ *
+ * Callbacks are never called with the mutex held, so that they can add or
+ * remove callbacks: matching callbacks are copied while the mutex is held,
+ * then called once it is released. Gestures are recognised with the mutex
+ * held and reported after it is released.
+ */
+struct switch_change {
+    uint8_t event;
+    uint64_t timestamp;
+};
 
 static int fd = -1;
-static pthread_t thread;
+static int state_fd = -1;   /* Opened by switch_get_state if switch_init was not called */
 static pthread_mutex_t mutex;
-static bool running = false;
 static int switch_callback_ID = 0;
 
 struct switch_callback
@@ -26,88 +61,457 @@ struct switch_callback
     int ID;
     uint8_t event_mask;
     void (*f)(void);
+    void (*timestamped_f)(uint8_t, uint64_t);
+    uint8_t switch_index;
+    uint8_t gesture_mask;
+    void (*gesture_f)(uint8_t, uint8_t, uint32_t);
     struct switch_callback *next;
 };
+
+/* Deadlines are 0 if not pending */
+struct gesture_state {
+    bool pressed;
+    bool held;                      /* Long press or repeat reported since last press */
+    uint32_t click_cnt;
+    uint32_t repeat_cnt;
+    uint64_t click_deadline;
+    uint64_t long_press_deadline;
+    uint64_t repeat_deadline;
+};
+
+struct gesture_report {
+    uint8_t switch_index;
+    uint8_t gesture;
+    uint32_t count;
+};
+
 static struct switch_callback *callback_list_head = NULL;
+static uint32_t callback_cnt = 0;
+
+/* Only accessed from event loop */
+static struct switch_change pending_changes[MAX_EVENT_CNT];
+static uint32_t pending_change_cnt = 0;
+static bool dropping = false;
+static uint8_t pressed_mask = 0;    /* Mask of SWITCH_x_PRESSED events of switches currently held */
+static bool monotonic_timestamps = false;
+static struct gesture_state gesture_states[SWITCH_CNT];
+static int timer_fd = -1;
+static uint64_t timer_deadline = 0;
+static struct switch_callback *called_callbacks = NULL;    /* Copies of callbacks being called */
+static uint32_t called_callback_capacity = 0;
+
+/* Protected by mutex, in nanoseconds */
+static uint64_t multi_click_time = DEFAULT_MULTI_CLICK_TIME * 1000000ULL;
+static uint64_t long_press_time = DEFAULT_LONG_PRESS_TIME * 1000000ULL;
+static uint64_t repeat_delay = DEFAULT_REPEAT_DELAY * 1000000ULL;
+static uint64_t repeat_period = DEFAULT_REPEAT_PERIOD * 1000000ULL;
+
+/* Make room to copy all callbacks, mutex must be held */
+static int reserve_called_callbacks(void)
+{
+    struct switch_callback *callbacks = NULL;
+
+    if (callback_cnt <= called_callback_capacity)
+        return 0;
+
+    callbacks = realloc(called_callbacks, callback_cnt * sizeof(struct switch_callback));
+    if (callbacks == NULL) {
+        fprintf(stderr, "switch: Failed to allocate memory for callbacks\n");
+        return -1;
+    }
+    called_callbacks = callbacks;
+    called_callback_capacity = callback_cnt;
+
+    return 0;
+}
 
-static void process_event(uint8_t switch_event)
+static void process_event(uint8_t switch_event, uint64_t timestamp)
 {
     struct switch_callback *cur = NULL;
+    uint32_t i, cnt = 0;
 
     pthread_mutex_lock(&mutex);
-    cur = callback_list_head;
-    while (cur) {
-        if (cur->event_mask & switch_event)
-            cur->f();
+    if (reserve_called_callbacks() == 0) {
+        for (cur = callback_list_head; cur; cur = cur->next) {
+            if (cur->event_mask & switch_event)
+                called_callbacks[cnt++] = *cur;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+
+    for (i = 0; i < cnt; ++i) {
+        if (called_callbacks[i].timestamped_f)
+            called_callbacks[i].timestamped_f(switch_event, timestamp);
+        else
+            called_callbacks[i].f();
+    }
+}
 
+static uint64_t get_timestamp(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/* Return mask of gestures with a callback on a switch, mutex must be held */
+static uint8_t get_gesture_mask(uint8_t switch_index)
+{
+    struct switch_callback *cur = callback_list_head;
+    uint8_t mask = 0;
+
+    while (cur) {
+        if (cur->gesture_f && cur->switch_index == switch_index)
+            mask |= cur->gesture_mask;
         cur = cur->next;
     }
+
+    return mask;
+}
+
+/* Mutex must not be held */
+static void process_gesture(const struct gesture_report *report)
+{
+    struct switch_callback *cur = NULL;
+    uint32_t i, cnt = 0;
+
+    pthread_mutex_lock(&mutex);
+    if (reserve_called_callbacks() == 0) {
+        for (cur = callback_list_head; cur; cur = cur->next) {
+            if (cur->gesture_f && cur->switch_index == report->switch_index
+            &&  (cur->gesture_mask & report->gesture))
+                called_callbacks[cnt++] = *cur;
+        }
+    }
     pthread_mutex_unlock(&mutex);
+
+    for (i = 0; i < cnt; ++i)
+        called_callbacks[i].gesture_f(report->switch_index, report->gesture, report->count);
 }
 
-static void* switch_update(void *arg)
+static void add_report(struct gesture_report *reports, uint32_t *report_cnt,
+                       uint8_t switch_index, uint8_t gesture, uint32_t count)
 {
-    int ret;
-    struct input_event event[2];
-    struct pollfd pfd;
-    pfd.fd = fd;
-    pfd.events = POLLIN;
+    reports[*report_cnt].switch_index = switch_index;
+    reports[*report_cnt].gesture = gesture;
+    reports[*report_cnt].count = count;
+    ++*report_cnt;
+}
 
-    running = true;
-    while (running) {
-        ret = poll(&pfd, 1, TIMEOUT);
+static void report_clicks(struct gesture_report *reports, uint32_t *report_cnt,
+                          uint8_t switch_index, uint32_t click_cnt)
+{
+    if (click_cnt == 1)
+        add_report(reports, report_cnt, switch_index, SWITCH_CLICK, 1);
+    else if (click_cnt == 2)
+        add_report(reports, report_cnt, switch_index, SWITCH_DOUBLE_CLICK, 2);
+    else if (click_cnt > 2)
+        add_report(reports, report_cnt, switch_index, SWITCH_MULTI_CLICK, click_cnt);
+}
 
-        if (ret < 0) {
-            fprintf(stderr, "switch: Error while polling file descriptor\n");
-            continue;
-        } else if (ret == 0) {
-            continue;
+/* Arm timer to expire at the earliest deadline of gestures, or disarm it */
+static void update_timer(void)
+{
+    struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+    uint64_t deadline = UINT64_MAX;
+    uint32_t i;
+
+    for (i = 0; i < SWITCH_CNT; ++i) {
+        struct gesture_state *state = &gesture_states[i];
+
+        if (state->click_deadline && state->click_deadline < deadline)
+            deadline = state->click_deadline;
+        if (state->long_press_deadline && state->long_press_deadline < deadline)
+            deadline = state->long_press_deadline;
+        if (state->repeat_deadline && state->repeat_deadline < deadline)
+            deadline = state->repeat_deadline;
+    }
+    if (deadline == UINT64_MAX)
+        deadline = 0;
+
+    if (deadline == timer_deadline)
+        return;
+
+    spec.it_value.tv_sec = deadline / 1000000000ULL;
+    spec.it_value.tv_nsec = deadline % 1000000000ULL;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == 0)
+        timer_deadline = deadline;
+}
+
+/* Update gestures of a switch after it was pressed or released */
+static void update_gestures(uint8_t switch_event, uint64_t timestamp)
+{
+    uint8_t switch_index = (switch_event & (SWITCH_1_PRESSED | SWITCH_1_RELEASED)) ? 0 : 1;
+    bool pressed = switch_event & (SWITCH_1_PRESSED | SWITCH_2_PRESSED);
+    struct gesture_state *state = &gesture_states[switch_index];
+    struct gesture_report report;
+    uint32_t report_cnt = 0;
+    uint8_t gesture_mask;
+
+    pthread_mutex_lock(&mutex);
+    gesture_mask = get_gesture_mask(switch_index);
+    state->pressed = pressed;
+    if (pressed) {
+        /* A new click of a series cancels its end */
+        state->click_deadline = 0;
+        state->held = false;
+        state->repeat_cnt = 0;
+        state->long_press_deadline = (gesture_mask & SWITCH_LONG_PRESS) ? timestamp + long_press_time : 0;
+        state->repeat_deadline = (gesture_mask & SWITCH_HOLD_REPEAT) ? timestamp + repeat_delay : 0;
+    } else {
+        state->long_press_deadline = 0;
+        state->repeat_deadline = 0;
+        if (state->held) {
+            state->click_cnt = 0;
+        } else if ((gesture_mask & (SWITCH_DOUBLE_CLICK | SWITCH_MULTI_CLICK)) == 0) {
+            /* No need to wait for other clicks */
+            state->click_cnt = 0;
+            add_report(&report, &report_cnt, switch_index, SWITCH_CLICK, 1);
         } else {
-            if (read(fd, &event, sizeof(event)) != sizeof(event)) {
-                fprintf(stderr, "switch: Error while reading event from file descriptor\n");
-                continue;
-            }
-
-            switch (event[0].code) {
-            case SWITCH_1_CODE:
-                if (event[0].value == 0)
-                    process_event(SWITCH_1_RELEASED);
-                else if (event[0].value == 1)
-                    process_event(SWITCH_1_PRESSED);
-                break;
-            case SWITCH_2_CODE:
-                if (event[0].value == 0)
-                    process_event(SWITCH_2_RELEASED);
-                else if (event[0].value == 1)
-                    process_event(SWITCH_2_PRESSED);
-                break;
-            default:
-                fprintf(stderr, "switch: Unrecognized event code\n");
-                break;
-            }
+            ++state->click_cnt;
+            state->click_deadline = timestamp + multi_click_time;
+        }
+    }
+    update_timer();
+    pthread_mutex_unlock(&mutex);
+
+    if (report_cnt != 0)
+        process_gesture(&report);
+}
+
+/* Called from event loop when the earliest deadline of gestures has passed */
+static void expire_gestures(uint32_t events, void *arg)
+{
+    struct gesture_report reports[MAX_REPORT_CNT];
+    uint32_t report_cnt = 0;
+    uint64_t expiration_cnt, now;
+    uint32_t j;
+    uint8_t i;
+
+    if (read(timer_fd, &expiration_cnt, sizeof(expiration_cnt)) < 0)
+        return;
+    timer_deadline = 0;
+
+    now = get_timestamp();
+    pthread_mutex_lock(&mutex);
+    for (i = 0; i < SWITCH_CNT; ++i) {
+        struct gesture_state *state = &gesture_states[i];
+
+        if (state->click_deadline && state->click_deadline <= now) {
+            state->click_deadline = 0;
+            report_clicks(reports, &report_cnt, i, state->click_cnt);
+            state->click_cnt = 0;
+        }
+
+        if (state->long_press_deadline && state->long_press_deadline <= now) {
+            /* Clicks before a long press are not reported */
+            state->long_press_deadline = 0;
+            state->held = true;
+            state->click_cnt = 0;
+            add_report(reports, &report_cnt, i, SWITCH_LONG_PRESS, 1);
+        }
+
+        if (state->repeat_deadline && state->repeat_deadline <= now) {
+            /* Repetitions missed while the event loop was busy are skipped */
+            while (state->repeat_deadline <= now)
+                state->repeat_deadline += repeat_period;
+            state->held = true;
+            state->click_cnt = 0;
+            ++state->repeat_cnt;
+            add_report(reports, &report_cnt, i, SWITCH_HOLD_REPEAT, state->repeat_cnt);
+        }
+    }
+    update_timer();
+    pthread_mutex_unlock(&mutex);
+
+    for (j = 0; j < report_cnt; ++j)
+        process_gesture(&reports[j]);
+}
+
+static uint64_t get_event_timestamp(const struct input_event *event)
+{
+    return (uint64_t)event->time.tv_sec * 1000000000ULL + (uint64_t)event->time.tv_usec * 1000ULL;
+}
+
+static void report_change(uint8_t switch_event, uint64_t timestamp)
+{
+    if (switch_event & (SWITCH_1_PRESSED | SWITCH_2_PRESSED))
+        pressed_mask |= switch_event;
+    else
+        pressed_mask &= ~(switch_event >> 1);
+
+    process_event(switch_event, timestamp);
+    update_gestures(switch_event, monotonic_timestamps ? timestamp : get_timestamp());
+}
+
+/* Read mask of SWITCH_x_PRESSED events of switches currently held */
+static int read_pressed_mask(int device_fd, uint8_t *mask)
+{
+    uint8_t keys[KEY_MAX / 8 + 1] = { 0 };
+
+    if (ioctl(device_fd, EVIOCGKEY(sizeof(keys)), keys) < 0) {
+        fprintf(stderr, "switch: Failed to read state of switches\n");
+        return -1;
+    }
+
+    *mask = 0;
+    if (keys[SWITCH_1_CODE / 8] & (1 << (SWITCH_1_CODE % 8)))
+        *mask |= SWITCH_1_PRESSED;
+    if (keys[SWITCH_2_CODE / 8] & (1 << (SWITCH_2_CODE % 8)))
+        *mask |= SWITCH_2_PRESSED;
+
+    return 0;
+}
+
+/* Report changes of switches lost by the kernel */
+static void resynchronise(uint64_t timestamp)
+{
+    uint8_t mask, changed;
+
+    if (read_pressed_mask(fd, &mask) < 0)
+        return;
+
+    changed = mask ^ pressed_mask;
+    if (changed & SWITCH_1_PRESSED)
+        report_change(mask & SWITCH_1_PRESSED ? SWITCH_1_PRESSED : SWITCH_1_RELEASED, timestamp);
+    if (changed & SWITCH_2_PRESSED)
+        report_change(mask & SWITCH_2_PRESSED ? SWITCH_2_PRESSED : SWITCH_2_RELEASED, timestamp);
+}
+
+static void handle_key(const struct input_event *event)
+{
+    struct switch_change *change = NULL;
+
+    /* Autorepeat (value 2) does not change the state of a switch */
+    if (event->value != 0 && event->value != 1)
+        return;
+
+    if (pending_change_cnt == MAX_EVENT_CNT) {
+        fprintf(stderr, "switch: Too many events without SYN_REPORT\n");
+        return;
+    }
+
+    change = &pending_changes[pending_change_cnt];
+    switch (event->code) {
+    case SWITCH_1_CODE:
+        change->event = event->value ? SWITCH_1_PRESSED : SWITCH_1_RELEASED;
+        break;
+    case SWITCH_2_CODE:
+        change->event = event->value ? SWITCH_2_PRESSED : SWITCH_2_RELEASED;
+        break;
+    default:
+        fprintf(stderr, "switch: Unrecognized event code\n");
+        return;
+    }
+    change->timestamp = get_event_timestamp(event);
+    ++pending_change_cnt;
+}
+
+static void handle_syn(const struct input_event *event)
+{
+    uint32_t i;
+
+    switch (event->code) {
+    case SYN_REPORT:
+        if (dropping) {
+            dropping = false;
+            resynchronise(get_event_timestamp(event));
+            break;
         }
+
+        for (i = 0; i < pending_change_cnt; ++i)
+            report_change(pending_changes[i].event, pending_changes[i].timestamp);
+        pending_change_cnt = 0;
+        break;
+    case SYN_DROPPED:
+        dropping = true;
+        pending_change_cnt = 0;
+        break;
+    }
+}
+
+/* Called from event loop when device file is readable */
+static void switch_update(uint32_t events, void *arg)
+{
+    struct input_event event[MAX_EVENT_CNT];
+    int i, event_cnt;
+    ssize_t ret;
+
+    if ((ret = read(fd, event, sizeof(event))) < 0) {
+        fprintf(stderr, "switch: Error while reading event from file descriptor\n");
+        return;
     }
+    event_cnt = ret / sizeof(struct input_event);
 
-    return NULL;
+    for (i = 0; i < event_cnt; ++i) {
+        if (event[i].type == EV_SYN)
+            handle_syn(&event[i]);
+        else if (event[i].type == EV_KEY && !dropping)
+            handle_key(&event[i]);
+    }
 }
 
 int switch_init(void)
 {
+    char path[MAX_STR_LENGTH];
+    int clock_id;
+
     if (fd >= 0)
         return 0;
 
-    if ((fd = open(DEVICE_FILE, O_RDONLY)) < 0) {
+    if (create_device_path(path, DEVICE_FILE) < 0)
+        return -1;
+
+    if ((fd = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
         fprintf(stderr, "switch: Error while opening device file\n");
         return -1;
     }
 
+    /* Timestamp events with CLOCK_MONOTONIC, not supported before Linux 3.4 */
+    clock_id = CLOCK_MONOTONIC;
+    monotonic_timestamps = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
+    pending_change_cnt = 0;
+    dropping = false;
+    if (read_pressed_mask(fd, &pressed_mask) < 0)
+        pressed_mask = 0;
+    memset(gesture_states, 0, sizeof(gesture_states));
+    gesture_states[0].pressed = pressed_mask & SWITCH_1_PRESSED;
+    gesture_states[1].pressed = pressed_mask & SWITCH_2_PRESSED;
+
+    if ((timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "switch: Error while creating timer\n");
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+    timer_deadline = 0;
+
     if (pthread_mutex_init(&mutex, NULL) != 0) {
         fprintf(stderr, "switch: Error while initialising mutex\n");
+        close(timer_fd);
+        timer_fd = -1;
+        close(fd);
+        fd = -1;
         return -1;
     }
 
-    if (pthread_create(&thread, NULL, switch_update, NULL) != 0) {
+    if (event_loop_init() < 0) {
         pthread_mutex_destroy(&mutex);
+        close(timer_fd);
+        timer_fd = -1;
+        close(fd);
+        fd = -1;
+        return -1;
+    }
+
+    if (event_loop_add_fd(fd, EPOLLIN, switch_update, NULL) < 0
+    ||  event_loop_add_fd(timer_fd, EPOLLIN, expire_gestures, NULL) < 0) {
+        event_loop_remove_fd(fd);
+        event_loop_release();
+        pthread_mutex_destroy(&mutex);
+        close(timer_fd);
+        timer_fd = -1;
         close(fd);
         fd = -1;
         return -1;
@@ -116,9 +520,47 @@ int switch_init(void)
     return 0;
 }
 
-int switch_add_callback(uint8_t event_mask, void (*callback)(void))
+static int add_callback(const struct switch_callback *callback)
 {
     struct switch_callback *entry = NULL;
+    int ID;
+
+    entry = malloc(sizeof(struct switch_callback));
+    if (entry == NULL) {
+        fprintf(stderr, "switch: Failed to allocate memory for switch_callback entry\n");
+        return -1;
+    }
+    *entry = *callback;
+    entry->next = NULL;
+
+    pthread_mutex_lock(&mutex);
+    ID = entry->ID = switch_callback_ID;
+    ++switch_callback_ID;
+
+    if (callback_list_head == NULL) {
+        callback_list_head = entry;
+    }
+    else {
+        struct switch_callback *last = callback_list_head;
+        while (last->next)
+            last = last->next;
+
+        last->next = entry;
+    }
+    ++callback_cnt;
+    pthread_mutex_unlock(&mutex);
+
+    return ID;
+}
+
+static int add_event_callback(uint8_t event_mask, void (*callback)(void), void (*timestamped_callback)(uint8_t, uint64_t))
+{
+    struct switch_callback entry = {
+        .event_mask = event_mask,
+        .f = callback,
+        .timestamped_f = timestamped_callback
+    };
+
     if (fd < 0) {
         fprintf(stderr, "switch: Failed to add callback, switch_init must be called before\n");
         return -1;
@@ -129,39 +571,78 @@ int switch_add_callback(uint8_t event_mask, void (*callback)(void))
         return -1;
     }
 
-    if (callback == NULL) {
+    if (callback == NULL && timestamped_callback == NULL) {
         fprintf(stderr, "switch: Cannot add a null callback\n");
         return -1;
     }
 
-    entry = malloc(sizeof(struct switch_callback));
-    if (entry == NULL) {
-        fprintf(stderr, "switch: Failed to allocate memory for switch_callback entry\n");
+    return add_callback(&entry);
+}
+
+int switch_add_callback(uint8_t event_mask, void (*callback)(void))
+{
+    return add_event_callback(event_mask, callback, NULL);
+}
+
+int switch_add_timestamped_callback(uint8_t event_mask, void (*callback)(uint8_t event, uint64_t timestamp))
+{
+    return add_event_callback(event_mask, NULL, callback);
+}
+
+int switch_set_gesture_timing(uint32_t new_multi_click_time, uint32_t new_long_press_time,
+                              uint32_t new_repeat_delay, uint32_t new_repeat_period)
+{
+    if (fd < 0) {
+        fprintf(stderr, "switch: switch_init must be called before setting timing of gestures\n");
         return -1;
     }
-    entry->ID = switch_callback_ID;
-    ++switch_callback_ID;
-    entry->event_mask = event_mask;
-    entry->f = callback;
-    entry->next = NULL;
 
+    if (new_multi_click_time == 0 || new_long_press_time == 0
+    ||  new_repeat_delay == 0 || new_repeat_period == 0) {
+        fprintf(stderr, "switch: Timing of gestures must not be zero.\n");
+        return -1;
+    }
 
-    if (callback_list_head == NULL) {
-        pthread_mutex_lock(&mutex);
-        callback_list_head = entry;
-        pthread_mutex_unlock(&mutex);
+    pthread_mutex_lock(&mutex);
+    multi_click_time = new_multi_click_time * 1000000ULL;
+    long_press_time = new_long_press_time * 1000000ULL;
+    repeat_delay = new_repeat_delay * 1000000ULL;
+    repeat_period = new_repeat_period * 1000000ULL;
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+int switch_add_gesture_callback(uint8_t switch_index, uint8_t gesture_mask,
+                                void (*callback)(uint8_t switch_index, uint8_t gesture, uint32_t count))
+{
+    struct switch_callback entry = {
+        .switch_index = switch_index,
+        .gesture_mask = gesture_mask,
+        .gesture_f = callback
+    };
+
+    if (fd < 0) {
+        fprintf(stderr, "switch: Failed to add callback, switch_init must be called before\n");
+        return -1;
     }
-    else {
-        struct switch_callback *last = callback_list_head;
-        while (last->next)
-            last = last->next;
 
-        pthread_mutex_lock(&mutex);
-        last->next = entry;
-        pthread_mutex_unlock(&mutex);
+    if (switch_index >= SWITCH_CNT) {
+        fprintf(stderr, "switch: Invalid switch index.\n");
+        return -1;
+    }
+
+    if ((gesture_mask & SWITCH_ALL_GESTURES) == 0) {
+        fprintf(stderr, "switch: Invalid gesture mask.\n");
+        return -1;
     }
 
-    return entry->ID;
+    if (callback == NULL) {
+        fprintf(stderr, "switch: Cannot add a null callback\n");
+        return -1;
+    }
+
+    return add_callback(&entry);
 }
 
 int switch_remove_callback(int callback_ID)
@@ -178,9 +659,7 @@ int switch_remove_callback(int callback_ID)
         return -1;
     }
 
-    if (callback_list_head == NULL)
-        return -1;
-
+    pthread_mutex_lock(&mutex);
     entry = callback_list_head;
     while (entry) {
         if (entry->ID == callback_ID)
@@ -189,14 +668,16 @@ int switch_remove_callback(int callback_ID)
         prev = entry;
         entry = entry->next;
     }
-    if (entry == NULL)
+    if (entry == NULL) {
+        pthread_mutex_unlock(&mutex);
         return -1;
+    }
 
-    pthread_mutex_lock(&mutex);
     if (prev)
         prev->next = entry->next;
     else
         callback_list_head = entry->next;
+    --callback_cnt;
     pthread_mutex_unlock(&mutex);
 
     free(entry);
@@ -204,15 +685,49 @@ int switch_remove_callback(int callback_ID)
     return 0;
 }
 
+int switch_get_state(uint8_t *mask)
+{
+    if (mask == NULL) {
+        fprintf(stderr, "switch: Cannot store state of switches to null variable.\n");
+        return -1;
+    }
+
+    if (fd >= 0)
+        return read_pressed_mask(fd, mask);
+
+    if (state_fd < 0) {
+        char path[MAX_STR_LENGTH];
+
+        if (create_device_path(path, DEVICE_FILE) < 0)
+            return -1;
+
+        if ((state_fd = open(path, O_RDONLY | O_NONBLOCK)) < 0) {
+            fprintf(stderr, "switch: Error while opening device file\n");
+            return -1;
+        }
+    }
+
+    return read_pressed_mask(state_fd, mask);
+}
+
 int switch_release(void)
 {
+    if (state_fd >= 0) {
+        close(state_fd);
+        state_fd = -1;
+    }
+
     if (fd >= 0) {
-        running = false;
-        if (pthread_join(thread, NULL) < 0) {
-            fprintf(stderr, "switch: Failed to terminate monitoring thread.\n");
+        if (event_loop_remove_fd(fd) < 0
+        ||  event_loop_remove_fd(timer_fd) < 0
+        ||  event_loop_release() < 0) {
+            fprintf(stderr, "switch: Failed to stop monitoring switch events.\n");
             return -1;
         }
 
+        close(timer_fd);
+        timer_fd = -1;
+
         if (pthread_mutex_destroy(&mutex) < 0) {
             fprintf(stderr, "switch: Failed to destroy mutex.\n");
             return -1;
@@ -231,6 +746,11 @@ int switch_release(void)
             callback_list_head = callback_list_head->next;
             free(tmp);
         }
+        callback_cnt = 0;
+
+        free(called_callbacks);
+        called_callbacks = NULL;
+        called_callback_capacity = 0;
     }
 
     return 0;
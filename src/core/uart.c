@@ -1,20 +1,39 @@
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <termios.h>
 #include <unistd.h>
 #include "letmecreate/core/common.h"
+#include "letmecreate/core/event_loop.h"
 #include "letmecreate/core/uart.h"
 
 #define UART_1_DEVICE_FILE      "/dev/ttySC0"
 #define UART_2_DEVICE_FILE      "/dev/ttySC1"
+#define RECEIVE_BUFFER_SIZE     (64)
 
 static int fds[2] = { -1, -1 };
 static struct termios old_pts[2];
 static uint8_t current_mikrobus_index = MIKROBUS_1;
+static void (*receive_callbacks[2])(const uint8_t *, uint32_t) = { NULL, NULL };
+
+/*
+ * A reference on the event loop is taken by the first callback of a device and kept until the
+ * device is released: removing a callback from inside this callback must not stop the event loop.
+ */
+static bool event_loop_references[2] = { false, false };
+
+/*
+ * Sending and receiving use separate locks, so that a thread waiting for
+ * data does not prevent other threads from sending data on the same device.
+ */
+static pthread_mutex_t send_mutexes[] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+static pthread_mutex_t receive_mutexes[] = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+static pthread_mutex_t callback_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static bool check_mikrobus_index(uint8_t mikrobus_index)
 {
@@ -30,6 +49,7 @@ static bool check_mikrobus_index(uint8_t mikrobus_index)
 static int uart_init_bus(uint8_t mikrobus_index)
 {
     char *device_file = NULL;
+    char path[MAX_STR_LENGTH];
     struct termios pts;
 
     if (!check_mikrobus_index(mikrobus_index))
@@ -43,7 +63,10 @@ static int uart_init_bus(uint8_t mikrobus_index)
     else
         device_file = UART_2_DEVICE_FILE;
 
-    if ((fds[mikrobus_index] = open(device_file, O_RDWR)) < 0) {
+    if (create_device_path(path, "%s", device_file) < 0)
+        return -1;
+
+    if ((fds[mikrobus_index] = open(path, O_RDWR)) < 0) {
         fprintf(stderr, "uart: Failed to open file descriptor.\n");
         return -1;
     }
@@ -85,11 +108,25 @@ static int uart_init_bus(uint8_t mikrobus_index)
     return 0;
 }
 
-static int uart_release_bus(uint8_t mikrobus_index)
+/* Called from event loop when a device has received some data */
+static void receive_data(uint32_t events, void *arg)
 {
-    if (!check_mikrobus_index(mikrobus_index))
-        return -1;
+    uint8_t mikrobus_index = (uintptr_t)arg;
+    uint8_t buffer[RECEIVE_BUFFER_SIZE];
+    int ret;
 
+    if ((ret = read(fds[mikrobus_index], buffer, sizeof(buffer))) < 0) {
+        fprintf(stderr, "uart: Failed to read\n");
+        return;
+    }
+
+    if (ret > 0)
+        receive_callbacks[mikrobus_index](buffer, ret);
+}
+
+/* Must be called with send and receive mutexes of the device held */
+static int close_device(uint8_t mikrobus_index)
+{
     if (fds[mikrobus_index] < 0)
         return 0;
 
@@ -110,18 +147,47 @@ static int uart_release_bus(uint8_t mikrobus_index)
     return 0;
 }
 
+static int uart_release_bus(uint8_t mikrobus_index)
+{
+    int ret = 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    if (uart_bus_set_receive_callback(mikrobus_index, NULL) < 0)
+        return -1;
+
+    pthread_mutex_lock(&callback_mutex);
+    if (event_loop_references[mikrobus_index]) {
+        if (event_loop_release() < 0)
+            ret = -1;
+        else
+            event_loop_references[mikrobus_index] = false;
+    }
+    pthread_mutex_unlock(&callback_mutex);
+    if (ret < 0)
+        return -1;
+
+    /* Send mutex is always taken first */
+    pthread_mutex_lock(&send_mutexes[mikrobus_index]);
+    pthread_mutex_lock(&receive_mutexes[mikrobus_index]);
+    ret = close_device(mikrobus_index);
+    pthread_mutex_unlock(&receive_mutexes[mikrobus_index]);
+    pthread_mutex_unlock(&send_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
 int uart_init(void)
 {
     if (uart_init_bus(MIKROBUS_1) < 0)
         return -1;
-    uart_select_bus(MIKROBUS_1);
-    if (uart_set_baudrate(UART_BD_9600) < 0)
+    if (uart_bus_set_baudrate(MIKROBUS_1, UART_BD_9600) < 0)
         return -1;
 
     if (uart_init_bus(MIKROBUS_2) < 0)
         return -1;
-    uart_select_bus(MIKROBUS_2);
-    if (uart_set_baudrate(UART_BD_9600) < 0)
+    if (uart_bus_set_baudrate(MIKROBUS_2, UART_BD_9600) < 0)
         return -1;
     uart_select_bus(MIKROBUS_1);
 
@@ -133,27 +199,28 @@ void uart_select_bus(uint8_t mikrobus_index)
     switch (mikrobus_index) {
     case MIKROBUS_1:
     case MIKROBUS_2:
-        current_mikrobus_index = mikrobus_index;
+        __atomic_store_n(&current_mikrobus_index, mikrobus_index, __ATOMIC_RELAXED);
         break;
     }
 }
 
 uint8_t uart_get_current_bus(void)
 {
-    return current_mikrobus_index;
+    return __atomic_load_n(&current_mikrobus_index, __ATOMIC_RELAXED);
 }
 
-int uart_set_baudrate(uint32_t baudrate)
+/* Must be called with send mutex of the device held */
+static int set_baudrate(uint8_t mikrobus_index, uint32_t baudrate)
 {
     struct termios pts;
     speed_t speed;
 
-    if (fds[current_mikrobus_index] < 0) {
-        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", current_mikrobus_index);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", mikrobus_index);
         return -1;
     }
 
-    if (tcgetattr(fds[current_mikrobus_index], &pts) < 0) {
+    if (tcgetattr(fds[mikrobus_index], &pts) < 0) {
         fprintf(stderr, "uart: Failed to get current parameters.\n");
         return -1;
     }
@@ -188,7 +255,7 @@ int uart_set_baudrate(uint32_t baudrate)
     cfsetospeed(&pts, speed);
     cfsetispeed(&pts, speed);
 
-    if (tcsetattr(fds[current_mikrobus_index], TCSANOW, &pts) < 0) {
+    if (tcsetattr(fds[mikrobus_index], TCSANOW, &pts) < 0) {
         fprintf(stderr, "uart: Failed to set baudrate.\n");
         return -1;
     }
@@ -196,21 +263,17 @@ int uart_set_baudrate(uint32_t baudrate)
     return 0;
 }
 
-int uart_get_baudrate(uint32_t *baudrate)
+/* Must be called with send mutex of the device held */
+static int get_baudrate(uint8_t mikrobus_index, uint32_t *baudrate)
 {
     struct termios pts;
 
-    if (baudrate == NULL) {
-        fprintf(stderr, "uart: Cannot set baudrate using null pointer.\n");
-        return -1;
-    }
-
-    if (fds[current_mikrobus_index] < 0) {
-        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", current_mikrobus_index);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", mikrobus_index);
         return -1;
     }
 
-    if (tcgetattr(fds[current_mikrobus_index], &pts) < 0) {
+    if (tcgetattr(fds[mikrobus_index], &pts) < 0) {
         fprintf(stderr, "uart: Failed to get current parameters.\n");
         return -1;
     }
@@ -245,25 +308,18 @@ int uart_get_baudrate(uint32_t *baudrate)
     return 0;
 }
 
-int uart_send(const uint8_t *buffer, uint32_t count)
+/* Must be called with send mutex of the device held */
+static int send_bytes(uint8_t mikrobus_index, const uint8_t *buffer, uint32_t count)
 {
     uint32_t sent_cnt = 0;
 
-    if (buffer == NULL) {
-        fprintf(stderr, "uart: Cannot send data from null buffer.\n");
-        return -1;
-    }
-
-    if (count == 0)
-        return 0;
-
-    if (fds[current_mikrobus_index] < 0) {
-        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", current_mikrobus_index);
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "uart: device %d must be initialised before sending data.\n", mikrobus_index);
         return -1;
     }
 
     while (sent_cnt < count) {
-        int ret = write(fds[current_mikrobus_index], &buffer[sent_cnt], count - sent_cnt);
+        int ret = write(fds[mikrobus_index], &buffer[sent_cnt], count - sent_cnt);
         if (ret < 0) {
             fprintf(stderr, "uart: Failed to write.\n");
             return -1;
@@ -274,10 +330,87 @@ int uart_send(const uint8_t *buffer, uint32_t count)
     return sent_cnt;
 }
 
-int uart_receive(uint8_t *buffer, uint32_t count)
+/* Must be called with receive mutex of the device held */
+static int receive_bytes(uint8_t mikrobus_index, uint8_t *buffer, uint32_t count)
 {
     uint32_t received_cnt = 0;
 
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "uart: device %d must be initialised before receiving data.\n", mikrobus_index);
+        return -1;
+    }
+
+    while (received_cnt < count) {
+        int ret = read(fds[mikrobus_index], &buffer[received_cnt], count - received_cnt);
+        if (ret < 0) {
+            fprintf(stderr, "uart: Failed to read\n");
+            return -1;
+        }
+        received_cnt += ret;
+    }
+
+    return received_cnt;
+}
+
+int uart_bus_set_baudrate(uint8_t mikrobus_index, uint32_t baudrate)
+{
+    int ret;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&send_mutexes[mikrobus_index]);
+    ret = set_baudrate(mikrobus_index, baudrate);
+    pthread_mutex_unlock(&send_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
+int uart_bus_get_baudrate(uint8_t mikrobus_index, uint32_t *baudrate)
+{
+    int ret;
+
+    if (baudrate == NULL) {
+        fprintf(stderr, "uart: Cannot set baudrate using null pointer.\n");
+        return -1;
+    }
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&send_mutexes[mikrobus_index]);
+    ret = get_baudrate(mikrobus_index, baudrate);
+    pthread_mutex_unlock(&send_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
+int uart_bus_send(uint8_t mikrobus_index, const uint8_t *buffer, uint32_t count)
+{
+    int ret;
+
+    if (buffer == NULL) {
+        fprintf(stderr, "uart: Cannot send data from null buffer.\n");
+        return -1;
+    }
+
+    if (count == 0)
+        return 0;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&send_mutexes[mikrobus_index]);
+    ret = send_bytes(mikrobus_index, buffer, count);
+    pthread_mutex_unlock(&send_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
+int uart_bus_receive(uint8_t mikrobus_index, uint8_t *buffer, uint32_t count)
+{
+    int ret;
+
     if (buffer == NULL) {
         fprintf(stderr, "uart: Cannot store data to null buffer.\n");
         return -1;
@@ -286,21 +419,85 @@ int uart_receive(uint8_t *buffer, uint32_t count)
     if (count == 0)
         return 0;
 
-    if (fds[current_mikrobus_index] < 0) {
-        fprintf(stderr, "uart: device %d must be initialised before receiving data.\n", current_mikrobus_index);
+    if (!check_mikrobus_index(mikrobus_index))
         return -1;
+
+    pthread_mutex_lock(&receive_mutexes[mikrobus_index]);
+    ret = receive_bytes(mikrobus_index, buffer, count);
+    pthread_mutex_unlock(&receive_mutexes[mikrobus_index]);
+
+    return ret;
+}
+
+/* Must be called with callback mutex held */
+static int set_receive_callback(uint8_t mikrobus_index, void (*callback)(const uint8_t *buffer, uint32_t count))
+{
+    if (receive_callbacks[mikrobus_index] != NULL) {
+        if (event_loop_remove_fd(fds[mikrobus_index]) < 0)
+            return -1;
+        receive_callbacks[mikrobus_index] = NULL;
     }
 
-    while (received_cnt < count) {
-        int ret = read(fds[current_mikrobus_index], &buffer[received_cnt], count - received_cnt);
-        if (ret < 0) {
-            fprintf(stderr, "uart: Failed to read\n");
+    if (callback == NULL)
+        return 0;
+
+    if (fds[mikrobus_index] < 0) {
+        fprintf(stderr, "uart: device %d must be initialised before receiving data.\n", mikrobus_index);
+        return -1;
+    }
+
+    if (!event_loop_references[mikrobus_index]) {
+        if (event_loop_init() < 0)
             return -1;
-        }
-        received_cnt += ret;
+        event_loop_references[mikrobus_index] = true;
     }
 
-    return received_cnt;
+    receive_callbacks[mikrobus_index] = callback;
+    if (event_loop_add_fd(fds[mikrobus_index], EPOLLIN, receive_data, (void *)(uintptr_t)mikrobus_index) < 0) {
+        receive_callbacks[mikrobus_index] = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int uart_bus_set_receive_callback(uint8_t mikrobus_index, void (*callback)(const uint8_t *buffer, uint32_t count))
+{
+    int ret;
+
+    if (!check_mikrobus_index(mikrobus_index))
+        return -1;
+
+    pthread_mutex_lock(&callback_mutex);
+    ret = set_receive_callback(mikrobus_index, callback);
+    pthread_mutex_unlock(&callback_mutex);
+
+    return ret;
+}
+
+int uart_set_baudrate(uint32_t baudrate)
+{
+    return uart_bus_set_baudrate(uart_get_current_bus(), baudrate);
+}
+
+int uart_get_baudrate(uint32_t *baudrate)
+{
+    return uart_bus_get_baudrate(uart_get_current_bus(), baudrate);
+}
+
+int uart_send(const uint8_t *buffer, uint32_t count)
+{
+    return uart_bus_send(uart_get_current_bus(), buffer, count);
+}
+
+int uart_receive(uint8_t *buffer, uint32_t count)
+{
+    return uart_bus_receive(uart_get_current_bus(), buffer, count);
+}
+
+int uart_set_receive_callback(void (*callback)(const uint8_t *buffer, uint32_t count))
+{
+    return uart_bus_set_receive_callback(uart_get_current_bus(), callback);
 }
 
 int uart_release(void)
@@ -0,0 +1,304 @@
+/**
+ * @brief Stand-in for /dev/gpiochipN, to test GPIO character device backend without gpio-sim.
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ *
+ * Preload this library to simulate GPIO chips at the ioctl level:
+ *
+ *   LD_PRELOAD=libgpiochip_stub.so ./test_gpio_chardev
+ *
+ * Each chip has 16 lines. Outputs read back the last value written, inputs
+ * always read 0. Requesting a line which is already requested fails with
+ * EBUSY, like the kernel does. Closing a line request turns its lines back
+ * into inputs, and outputs released this way are counted in
+ * gpiochip_stub_released_output_cnt.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#define CHIP_CNT            (8)
+#define LINES_PER_CHIP      (16)
+#define MAX_FD              (1024)
+
+struct line {
+    int owner;              /* File descriptor of line request, -1 if free */
+    bool output;
+    bool value;
+};
+
+struct fake_fd {
+    bool used;
+    bool is_request;
+    int chip;
+    uint32_t num_lines;
+    uint32_t offsets[GPIO_V2_LINES_MAX];
+};
+
+static struct line lines[CHIP_CNT][LINES_PER_CHIP];
+static struct fake_fd fake_fds[MAX_FD];
+static bool initialised = false;
+
+unsigned int gpiochip_stub_released_output_cnt = 0;
+
+static void init_lines(void)
+{
+    int chip, offset;
+
+    if (initialised)
+        return;
+
+    for (chip = 0; chip < CHIP_CNT; ++chip)
+        for (offset = 0; offset < LINES_PER_CHIP; ++offset)
+            lines[chip][offset].owner = -1;
+    initialised = true;
+}
+
+static int create_fake_fd(int chip, bool is_request)
+{
+    int fd = eventfd(0, 0);
+
+    if (fd < 0 || fd >= MAX_FD)
+        return -1;
+
+    memset(&fake_fds[fd], 0, sizeof(struct fake_fd));
+    fake_fds[fd].used = true;
+    fake_fds[fd].is_request = is_request;
+    fake_fds[fd].chip = chip;
+
+    return fd;
+}
+
+static int open_chip(const char *path)
+{
+    int chip;
+
+    if (sscanf(path, "/dev/gpiochip%d", &chip) != 1 || chip < 0 || chip >= CHIP_CNT) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    init_lines();
+    return create_fake_fd(chip, false);
+}
+
+int open(const char *path, int flags, ...)
+{
+    static int (*real_open)(const char *, int, ...) = NULL;
+    mode_t mode = 0;
+
+    if (strncmp(path, "/dev/gpiochip", 13) == 0)
+        return open_chip(path);
+
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    if (real_open == NULL)
+        real_open = dlsym(RTLD_NEXT, "open");
+
+    return real_open(path, flags, mode);
+}
+
+int open64(const char *path, int flags, ...)
+{
+    static int (*real_open64)(const char *, int, ...) = NULL;
+    mode_t mode = 0;
+
+    if (strncmp(path, "/dev/gpiochip", 13) == 0)
+        return open_chip(path);
+
+    if (flags & O_CREAT) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+
+    if (real_open64 == NULL)
+        real_open64 = dlsym(RTLD_NEXT, "open64");
+
+    return real_open64(path, flags, mode);
+}
+
+int close(int fd)
+{
+    static int (*real_close)(int) = NULL;
+
+    if (fd >= 0 && fd < MAX_FD && fake_fds[fd].used) {
+        if (fake_fds[fd].is_request) {
+            uint32_t i;
+            for (i = 0; i < fake_fds[fd].num_lines; ++i) {
+                struct line *line = &lines[fake_fds[fd].chip][fake_fds[fd].offsets[i]];
+
+                if (line->output)
+                    ++gpiochip_stub_released_output_cnt;
+                line->owner = -1;
+                line->output = false;
+                line->value = false;
+            }
+        }
+        fake_fds[fd].used = false;
+    }
+
+    if (real_close == NULL)
+        real_close = dlsym(RTLD_NEXT, "close");
+
+    return real_close(fd);
+}
+
+static void apply_config(int fd, const struct gpio_v2_line_config *config)
+{
+    struct fake_fd *request = &fake_fds[fd];
+    uint32_t i, j;
+
+    for (i = 0; i < request->num_lines; ++i) {
+        struct line *line = &lines[request->chip][request->offsets[i]];
+        uint64_t flags = config->flags;
+        bool flags_found = false, value_found = false;
+
+        /* First attribute associated with a line has precedence */
+        for (j = 0; j < config->num_attrs; ++j) {
+            const struct gpio_v2_line_config_attribute *attr = &config->attrs[j];
+            if ((attr->mask & (1ULL << i)) == 0)
+                continue;
+
+            if (attr->attr.id == GPIO_V2_LINE_ATTR_ID_FLAGS && !flags_found) {
+                flags = attr->attr.flags;
+                flags_found = true;
+            } else if (attr->attr.id == GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES && !value_found) {
+                line->value = (attr->attr.values >> i) & 1;
+                value_found = true;
+            }
+        }
+
+        line->output = (flags & GPIO_V2_LINE_FLAG_OUTPUT) != 0;
+        if (!line->output)
+            line->value = false;
+    }
+}
+
+static int get_line(int chip_fd, struct gpio_v2_line_request *req)
+{
+    int chip = fake_fds[chip_fd].chip;
+    uint32_t i;
+    int fd;
+
+    if (req->num_lines == 0 || req->num_lines > GPIO_V2_LINES_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < req->num_lines; ++i) {
+        if (req->offsets[i] >= LINES_PER_CHIP) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (lines[chip][req->offsets[i]].owner >= 0) {
+            errno = EBUSY;
+            return -1;
+        }
+    }
+
+    if ((fd = create_fake_fd(chip, true)) < 0)
+        return -1;
+
+    fake_fds[fd].num_lines = req->num_lines;
+    memcpy(fake_fds[fd].offsets, req->offsets, req->num_lines * sizeof(uint32_t));
+    for (i = 0; i < req->num_lines; ++i)
+        lines[chip][req->offsets[i]].owner = fd;
+
+    apply_config(fd, &req->config);
+    req->fd = fd;
+
+    return 0;
+}
+
+static int get_values(int fd, struct gpio_v2_line_values *values)
+{
+    struct fake_fd *request = &fake_fds[fd];
+    uint32_t i;
+
+    values->bits = 0;
+    for (i = 0; i < request->num_lines; ++i) {
+        if ((values->mask & (1ULL << i)) == 0)
+            continue;
+
+        if (lines[request->chip][request->offsets[i]].value)
+            values->bits |= 1ULL << i;
+    }
+
+    return 0;
+}
+
+static int set_values(int fd, const struct gpio_v2_line_values *values)
+{
+    struct fake_fd *request = &fake_fds[fd];
+    uint32_t i;
+
+    for (i = 0; i < request->num_lines; ++i) {
+        if ((values->mask & (1ULL << i)) == 0)
+            continue;
+
+        if (!lines[request->chip][request->offsets[i]].output) {
+            errno = EPERM;
+            return -1;
+        }
+    }
+
+    for (i = 0; i < request->num_lines; ++i) {
+        if (values->mask & (1ULL << i))
+            lines[request->chip][request->offsets[i]].value = (values->bits >> i) & 1;
+    }
+
+    return 0;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    static int (*real_ioctl)(int, unsigned long, ...) = NULL;
+    va_list args;
+    void *arg;
+
+    va_start(args, request);
+    arg = va_arg(args, void *);
+    va_end(args);
+
+    if (fd >= 0 && fd < MAX_FD && fake_fds[fd].used) {
+        bool is_request = fake_fds[fd].is_request;
+
+        if (request == GPIO_V2_GET_LINE_IOCTL && !is_request)
+            return get_line(fd, arg);
+        if (request == GPIO_V2_LINE_SET_CONFIG_IOCTL && is_request) {
+            apply_config(fd, arg);
+            return 0;
+        }
+        if (request == GPIO_V2_LINE_GET_VALUES_IOCTL && is_request)
+            return get_values(fd, arg);
+        if (request == GPIO_V2_LINE_SET_VALUES_IOCTL && is_request)
+            return set_values(fd, arg);
+
+        errno = ENOTTY;
+        return -1;
+    }
+
+    if (real_ioctl == NULL)
+        real_ioctl = dlsym(RTLD_NEXT, "ioctl");
+
+    return real_ioctl(fd, request, arg);
+}
@@ -96,11 +96,17 @@ static bool test_adc_null_value(void)
     return adc_get_value(MIKROBUS_1, NULL) == -1;
 }
 
+static bool test_adc_release(void)
+{
+    return adc_release() == 0
+        && adc_release() == 0;
+}
+
 int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(adc, 8)
+    CREATE_TEST(adc, 9)
     ADD_TEST_CASE(adc, mikrobus_1_gnd);
     ADD_TEST_CASE(adc, mikrobus_1_3v3);
     ADD_TEST_CASE(adc, mikrobus_1_5v);
@@ -109,6 +115,7 @@ int main(void)
     ADD_TEST_CASE(adc, mikrobus_2_5v);
     ADD_TEST_CASE(adc, invalid_mikrobus_index);
     ADD_TEST_CASE(adc, null_value);
+    ADD_TEST_CASE(adc, release);
 
     ret = run_test(test_adc);
     free(test_adc.cases);
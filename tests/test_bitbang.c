@@ -0,0 +1,186 @@
+/**
+ * @brief Implement BITBANG section of miscellaneous/testing_plan
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "letmecreate/core/bitbang.h"
+#include "letmecreate/core/gpio.h"
+
+#define SPI_SPEED       (100000)
+#define I2C_SPEED       (100000)
+
+static bool test_bitbang_transfer_before_init(void)
+{
+    uint8_t buffer = 0;
+    return bitbang_spi_transfer(&buffer, &buffer, 1) == -1
+        && bitbang_i2c_write(0x12, &buffer, 1) == -1
+        && bitbang_i2c_read(0x12, &buffer, 1) == -1
+        && bitbang_onewire_reset() == -1
+        && bitbang_onewire_write(&buffer, 1) == -1
+        && bitbang_onewire_read(&buffer, 1) == -1;
+}
+
+static bool test_bitbang_spi_init_invalid_arguments(void)
+{
+    return bitbang_spi_init(GPIO_80, GPIO_81, GPIO_82, GPIO_83, 4, SPI_SPEED) == -1
+        && bitbang_spi_init(GPIO_80, GPIO_81, GPIO_82, GPIO_83, 0, 0) == -1
+        && bitbang_spi_init(200, GPIO_81, GPIO_82, GPIO_83, 0, SPI_SPEED) == -1;
+}
+
+/* Chip select is acquired by another driver, and must stay acquired */
+static bool test_bitbang_spi_init_failure_keeps_pins(void)
+{
+    if (gpio_acquire(GPIO_83, GPIO_OUTPUT) < 0
+    ||  bitbang_spi_init(GPIO_80, 200, GPIO_82, GPIO_83, 0, SPI_SPEED) != -1)
+        return false;
+
+    return gpio_relinquish(GPIO_83) == 0
+        && gpio_relinquish(GPIO_83) == -1;
+}
+
+static bool test_bitbang_spi_init(void)
+{
+    return bitbang_spi_init(GPIO_80, GPIO_81, GPIO_82, GPIO_83, 0, SPI_SPEED) == 0
+        && bitbang_spi_init(GPIO_80, GPIO_81, GPIO_82, GPIO_83, 0, SPI_SPEED) == -1;
+}
+
+static bool test_bitbang_spi_transfer_zero_byte(void)
+{
+    return bitbang_spi_transfer(NULL, NULL, 0) == 0;
+}
+
+static bool test_bitbang_spi_transfer_null_buffers(void)
+{
+    return bitbang_spi_transfer(NULL, NULL, 1) == -1;
+}
+
+static bool test_bitbang_spi_loopback(void)
+{
+    uint8_t tx_buffer[] = { 0xA5, 0x3C, 0x00, 0xFF };
+    uint8_t rx_buffer[sizeof(tx_buffer)];
+
+    printf("Connect GPIO_81 (MOSI) to GPIO_82 (MISO).\n");
+    printf("Press a switch when this is done.\n");
+    if (wait_for_switch(30) < 0)
+        return false;
+
+    if (bitbang_spi_transfer(tx_buffer, rx_buffer, sizeof(tx_buffer)) != sizeof(tx_buffer))
+        return false;
+
+    return memcmp(tx_buffer, rx_buffer, sizeof(tx_buffer)) == 0;
+}
+
+static bool test_bitbang_spi_release(void)
+{
+    return bitbang_spi_release() == 0
+        && bitbang_spi_release() == 0;
+}
+
+static bool test_bitbang_i2c_init(void)
+{
+    return bitbang_i2c_init(GPIO_84, GPIO_85, 0) == -1
+        && bitbang_i2c_init(GPIO_84, GPIO_85, I2C_SPEED) == 0;
+}
+
+static bool test_bitbang_i2c_invalid_arguments(void)
+{
+    uint8_t buffer = 0;
+    return bitbang_i2c_write(0x12, NULL, 1) == -1
+        && bitbang_i2c_read(0x12, NULL, 1) == -1
+        && bitbang_i2c_write(0x80, &buffer, 1) == -1;
+}
+
+static bool test_bitbang_i2c_no_slave(void)
+{
+    uint8_t buffer = 0;
+
+    printf("Connect pull-up resistors to GPIO_84 (SDA) and GPIO_85 (SCL), without any slave.\n");
+    printf("Press a switch when this is done.\n");
+    if (wait_for_switch(30) < 0)
+        return false;
+
+    return bitbang_i2c_write(0x12, &buffer, 1) == -1
+        && bitbang_i2c_read(0x12, &buffer, 1) == -1;
+}
+
+static bool test_bitbang_i2c_release(void)
+{
+    return bitbang_i2c_release() == 0
+        && bitbang_i2c_release() == 0;
+}
+
+/* 1-Wire bus requires the character device backend */
+static bool test_bitbang_onewire_init(void)
+{
+    if (gpio_select_backend(GPIO_BACKEND_SYSFS) < 0
+    ||  bitbang_onewire_init(GPIO_88) != -1)
+        return false;
+
+    return gpio_select_backend(GPIO_BACKEND_CHARDEV) == 0
+        && bitbang_onewire_init(GPIO_88) == 0
+        && bitbang_onewire_init(GPIO_88) == -1;
+}
+
+static bool test_bitbang_onewire_invalid_arguments(void)
+{
+    return bitbang_onewire_write(NULL, 1) == -1
+        && bitbang_onewire_read(NULL, 1) == -1;
+}
+
+static bool test_bitbang_onewire_no_device(void)
+{
+    const uint8_t skip_rom = 0xCC;
+    uint8_t buffer = 0;
+
+    printf("Connect a pull-up resistor to GPIO_88, without any device.\n");
+    printf("Press a switch when this is done.\n");
+    if (wait_for_switch(30) < 0)
+        return false;
+
+    /* Without any device, the line stays high */
+    return bitbang_onewire_reset() == 0
+        && bitbang_onewire_write(&skip_rom, 1) == 1
+        && bitbang_onewire_read(&buffer, 1) == 1
+        && buffer == 0xFF;
+}
+
+static bool test_bitbang_onewire_release(void)
+{
+    return bitbang_onewire_release() == 0
+        && bitbang_onewire_release() == 0
+        && gpio_select_backend(GPIO_BACKEND_SYSFS) == 0;
+}
+
+int main(void)
+{
+    int ret = -1;
+
+    CREATE_TEST(bitbang, 16)
+    ADD_TEST_CASE(bitbang, transfer_before_init);
+    ADD_TEST_CASE(bitbang, spi_init_invalid_arguments);
+    ADD_TEST_CASE(bitbang, spi_init_failure_keeps_pins);
+    ADD_TEST_CASE(bitbang, spi_init);
+    ADD_TEST_CASE(bitbang, spi_transfer_zero_byte);
+    ADD_TEST_CASE(bitbang, spi_transfer_null_buffers);
+    ADD_TEST_CASE(bitbang, spi_loopback);
+    ADD_TEST_CASE(bitbang, spi_release);
+    ADD_TEST_CASE(bitbang, i2c_init);
+    ADD_TEST_CASE(bitbang, i2c_invalid_arguments);
+    ADD_TEST_CASE(bitbang, i2c_no_slave);
+    ADD_TEST_CASE(bitbang, i2c_release);
+    ADD_TEST_CASE(bitbang, onewire_init);
+    ADD_TEST_CASE(bitbang, onewire_invalid_arguments);
+    ADD_TEST_CASE(bitbang, onewire_no_device);
+    ADD_TEST_CASE(bitbang, onewire_release);
+
+    ret = run_test(test_bitbang);
+    free(test_bitbang.cases);
+
+    return ret;
+}
@@ -0,0 +1,234 @@
+/**
+ * @brief Implement DEVICE ROOT section of miscellaneous/testing_plan
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ *
+ * This test does not need a Ci40: gpio files are faked in a temporary
+ * directory which is used as device root.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "letmecreate/core/common.h"
+#include "letmecreate/core/gpio.h"
+
+static char root[] = "/tmp/letmecreate_XXXXXX";
+static char gpio_dir_path[MAX_STR_LENGTH];
+static char pin_dir_path[2 * MAX_STR_LENGTH];
+
+static bool create_file(const char *dir_path, const char *file_name, const char *content)
+{
+    char path[MAX_STR_LENGTH];
+    FILE *file;
+
+    snprintf(path, MAX_STR_LENGTH, "%s/%s", dir_path, file_name);
+    if ((file = fopen(path, "w")) == NULL)
+        return false;
+
+    fputs(content, file);
+    fclose(file);
+
+    return true;
+}
+
+static void remove_file(const char *dir_path, const char *file_name)
+{
+    char path[MAX_STR_LENGTH];
+
+    snprintf(path, MAX_STR_LENGTH, "%s/%s", dir_path, file_name);
+    unlink(path);
+}
+
+/* Content of the file is compared up to the null character written by the library */
+static bool check_file(const char *dir_path, const char *file_name, const char *content)
+{
+    char path[MAX_STR_LENGTH];
+    char str[MAX_STR_LENGTH];
+    FILE *file;
+    size_t length;
+
+    snprintf(path, MAX_STR_LENGTH, "%s/%s", dir_path, file_name);
+    if ((file = fopen(path, "r")) == NULL)
+        return false;
+
+    length = fread(str, 1, MAX_STR_LENGTH - 1, file);
+    str[length] = '\0';
+    fclose(file);
+
+    return strcmp(str, content) == 0;
+}
+
+static bool test_device_root_set_too_long(void)
+{
+    char str[MAX_STR_LENGTH + 1];
+
+    memset(str, 'a', MAX_STR_LENGTH);
+    str[MAX_STR_LENGTH] = '\0';
+
+    return set_device_root(str) == -1;
+}
+
+static bool test_device_root_set(void)
+{
+    char path[MAX_STR_LENGTH];
+
+    if (mkdtemp(root) == NULL)
+        return false;
+
+    snprintf(path, MAX_STR_LENGTH, "%s/sys", root);
+    mkdir(path, 0755);
+    snprintf(path, MAX_STR_LENGTH, "%s/sys/class", root);
+    mkdir(path, 0755);
+    snprintf(gpio_dir_path, MAX_STR_LENGTH, "%s/sys/class/gpio", root);
+    mkdir(gpio_dir_path, 0755);
+    snprintf(pin_dir_path, sizeof(pin_dir_path), "%s/gpio%d", gpio_dir_path, MIKROBUS_1_INT);
+    if (mkdir(pin_dir_path, 0755) < 0)
+        return false;
+
+    if (!create_file(gpio_dir_path, "export", "")
+    ||  !create_file(gpio_dir_path, "unexport", "")
+    ||  !create_file(pin_dir_path, "direction", "in")
+    ||  !create_file(pin_dir_path, "value", "0"))
+        return false;
+
+    if (set_device_root(root) < 0
+    ||  gpio_select_backend(GPIO_BACKEND_SYSFS) < 0)
+        return false;
+
+    return strcmp(get_device_root(), root) == 0;
+}
+
+static bool test_device_root_create_device_path(void)
+{
+    char path[MAX_STR_LENGTH];
+    char expected_path[MAX_STR_LENGTH];
+
+    if (create_device_path(path, "/dev/i2c-%d", 0) < 0)
+        return false;
+
+    snprintf(expected_path, MAX_STR_LENGTH, "%s/dev/i2c-0", root);
+
+    return strcmp(path, expected_path) == 0;
+}
+
+/* No gpio folder is created by the fake export file */
+static bool test_device_root_gpio_export(void)
+{
+    char str[MAX_STR_LENGTH];
+
+    if (gpio_init(MIKROBUS_2_INT) != -1)
+        return false;
+
+    snprintf(str, MAX_STR_LENGTH, "%d", MIKROBUS_2_INT);
+
+    return check_file(gpio_dir_path, "export", str);
+}
+
+static bool test_device_root_uninitialised_gpio(void)
+{
+    uint8_t direction, value;
+
+    return gpio_get_direction(MIKROBUS_2_INT, &direction) == -1
+        && gpio_set_value(MIKROBUS_2_INT, 1) == -1
+        && gpio_get_value(MIKROBUS_2_INT, &value) == -1;
+}
+
+static bool test_device_root_gpio_init(void)
+{
+    uint8_t direction;
+
+    if (gpio_init(MIKROBUS_1_INT) < 0)
+        return false;
+
+    if (gpio_get_direction(MIKROBUS_1_INT, &direction) < 0)
+        return false;
+
+    return direction == GPIO_INPUT;
+}
+
+static bool test_device_root_gpio_direction(void)
+{
+    if (gpio_set_direction(MIKROBUS_1_INT, GPIO_OUTPUT) < 0)
+        return false;
+
+    return check_file(pin_dir_path, "direction", "out");
+}
+
+static bool test_device_root_gpio_value(void)
+{
+    uint8_t value;
+
+    if (gpio_set_value(MIKROBUS_1_INT, 1) < 0)
+        return false;
+    if (!check_file(pin_dir_path, "value", "1"))
+        return false;
+
+    if (!create_file(pin_dir_path, "value", "0"))
+        return false;
+    if (gpio_get_value(MIKROBUS_1_INT, &value) < 0)
+        return false;
+
+    return value == 0;
+}
+
+static bool test_device_root_gpio_release(void)
+{
+    char str[MAX_STR_LENGTH];
+
+    if (gpio_release(MIKROBUS_1_INT) < 0)
+        return false;
+
+    snprintf(str, MAX_STR_LENGTH, "%d", MIKROBUS_1_INT);
+
+    return check_file(gpio_dir_path, "unexport", str);
+}
+
+static bool test_device_root_reset(void)
+{
+    char path[MAX_STR_LENGTH];
+
+    remove_file(pin_dir_path, "direction");
+    remove_file(pin_dir_path, "value");
+    rmdir(pin_dir_path);
+    remove_file(gpio_dir_path, "export");
+    remove_file(gpio_dir_path, "unexport");
+    rmdir(gpio_dir_path);
+    snprintf(path, MAX_STR_LENGTH, "%s/sys/class", root);
+    rmdir(path);
+    snprintf(path, MAX_STR_LENGTH, "%s/sys", root);
+    rmdir(path);
+    if (rmdir(root) < 0)
+        return false;
+
+    if (set_device_root(NULL) < 0)
+        return false;
+
+    return strcmp(get_device_root(), "") == 0;
+}
+
+int main(void)
+{
+    int ret = -1;
+
+    CREATE_TEST(device_root, 10)
+    ADD_TEST_CASE(device_root, set_too_long);
+    ADD_TEST_CASE(device_root, set);
+    ADD_TEST_CASE(device_root, create_device_path);
+    ADD_TEST_CASE(device_root, gpio_export);
+    ADD_TEST_CASE(device_root, uninitialised_gpio);
+    ADD_TEST_CASE(device_root, gpio_init);
+    ADD_TEST_CASE(device_root, gpio_direction);
+    ADD_TEST_CASE(device_root, gpio_value);
+    ADD_TEST_CASE(device_root, gpio_release);
+    ADD_TEST_CASE(device_root, reset);
+
+    ret = run_test(test_device_root);
+    free(test_device_root.cases);
+
+    return ret;
+}
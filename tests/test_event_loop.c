@@ -0,0 +1,190 @@
+/**
+ * @brief Implement EVENT LOOP section of miscellaneous/testing_plan
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "letmecreate/core/event_loop.h"
+
+static int fd = -1;
+static uint32_t handled_events;
+static uint64_t wakeup_time;
+
+static uint64_t get_timestamp(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void handler(uint32_t events, void *arg)
+{
+    eventfd_t value;
+
+    eventfd_read(fd, &value);
+    handled_events = events;
+    wakeup_time = event_loop_get_wakeup_time();
+}
+
+static bool test_event_loop_poll_before_init(void)
+{
+    return letmecreate_poll(0) == -1;
+}
+
+static bool test_event_loop_add_fd_before_init(void)
+{
+    if ((fd = eventfd(0, EFD_NONBLOCK)) < 0)
+        return false;
+
+    return event_loop_add_fd(fd, EPOLLIN, handler, NULL) == -1;
+}
+
+static bool test_event_loop_select_mode(void)
+{
+    return event_loop_get_mode() == EVENT_LOOP_THREAD
+        && event_loop_select_mode(2) == -1
+        && event_loop_select_mode(EVENT_LOOP_POLL) == 0
+        && event_loop_get_mode() == EVENT_LOOP_POLL;
+}
+
+static bool test_event_loop_thread_attributes(void)
+{
+    return event_loop_set_thread_scheduling(3, 0) == -1
+        && event_loop_set_thread_scheduling(THREAD_POLICY_FIFO, 0) == -1
+        && event_loop_set_thread_stack_size(1) == -1
+        && event_loop_set_thread_scheduling(THREAD_POLICY_DEFAULT, 0) == 0
+        && event_loop_set_thread_affinity(0) == 0
+        && event_loop_set_thread_stack_size(0) == 0;
+}
+
+static bool test_event_loop_init(void)
+{
+    return event_loop_init() == 0
+        && event_loop_init() == 0
+        && event_loop_select_mode(EVENT_LOOP_THREAD) == -1
+        && event_loop_set_thread_affinity(1) == -1;
+}
+
+static bool test_event_loop_add_fd_invalid(void)
+{
+    return event_loop_add_fd(-1, EPOLLIN, handler, NULL) == -1
+        && event_loop_add_fd(fd, EPOLLIN, NULL, NULL) == -1;
+}
+
+static bool test_event_loop_add_fd(void)
+{
+    return event_loop_add_fd(fd, EPOLLIN, handler, NULL) == 0;
+}
+
+static bool test_event_loop_poll(void)
+{
+    uint64_t before, after;
+
+    handled_events = 0;
+    if (letmecreate_poll(0) != 0 || handled_events != 0)
+        return false;
+
+    if (eventfd_write(fd, 1) < 0)
+        return false;
+
+    before = get_timestamp();
+    if (letmecreate_poll(100) != 1)
+        return false;
+    after = get_timestamp();
+
+    return handled_events == EPOLLIN
+        && wakeup_time >= before
+        && wakeup_time <= after
+        && letmecreate_poll(0) == 0;
+}
+
+static void* poll_from_thread(void *arg)
+{
+    *(int *)arg = letmecreate_poll(1000);
+
+    return NULL;
+}
+
+static bool test_event_loop_poll_from_two_threads(void)
+{
+    struct timespec delay = { 0, 50000000 };
+    pthread_t thread;
+    int thread_ret = -1;
+    bool ret;
+
+    if (pthread_create(&thread, NULL, poll_from_thread, &thread_ret) != 0)
+        return false;
+
+    /* Give the thread time to wait for events */
+    nanosleep(&delay, NULL);
+    ret = letmecreate_poll(0) == -1;
+
+    eventfd_write(fd, 1);
+    pthread_join(thread, NULL);
+
+    return ret && thread_ret == 1;
+}
+
+static bool test_event_loop_remove_fd(void)
+{
+    return event_loop_remove_fd(fd) == 0
+        && event_loop_remove_fd(fd) == -1;
+}
+
+static bool test_event_loop_poll_after_remove_fd(void)
+{
+    handled_events = 0;
+    if (eventfd_write(fd, 1) < 0)
+        return false;
+
+    return letmecreate_poll(0) == 0
+        && handled_events == 0;
+}
+
+static bool test_event_loop_release(void)
+{
+    bool ret = event_loop_release() == 0
+            && event_loop_release() == 0
+            && event_loop_release() == 0
+            && letmecreate_poll(0) == -1
+            && event_loop_select_mode(EVENT_LOOP_THREAD) == 0;
+
+    close(fd);
+
+    return ret;
+}
+
+int main(void)
+{
+    int ret = -1;
+
+    CREATE_TEST(event_loop, 12)
+    ADD_TEST_CASE(event_loop, poll_before_init);
+    ADD_TEST_CASE(event_loop, add_fd_before_init);
+    ADD_TEST_CASE(event_loop, select_mode);
+    ADD_TEST_CASE(event_loop, thread_attributes);
+    ADD_TEST_CASE(event_loop, init);
+    ADD_TEST_CASE(event_loop, add_fd_invalid);
+    ADD_TEST_CASE(event_loop, add_fd);
+    ADD_TEST_CASE(event_loop, poll);
+    ADD_TEST_CASE(event_loop, poll_from_two_threads);
+    ADD_TEST_CASE(event_loop, remove_fd);
+    ADD_TEST_CASE(event_loop, poll_after_remove_fd);
+    ADD_TEST_CASE(event_loop, release);
+
+    ret = run_test(test_event_loop);
+    free(test_event_loop.cases);
+
+    return ret;
+}
@@ -0,0 +1,277 @@
+/**
+ * @brief Implement GPIO CHARDEV section of miscellaneous/testing_plan
+ * @author agent
+ * @date 2026
+ * @copyright 3-clause BSD
+ *
+ * When tests/gpiochip_stub.c is preloaded, this test also checks that outputs
+ * are never released while they are used.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "letmecreate/core/gpio.h"
+#include "letmecreate/core/gpio_monitor.h"
+
+/* Outputs released by gpiochip_stub, null without the stub */
+static unsigned int *released_output_cnt = NULL;
+
+static unsigned int get_released_output_cnt(void)
+{
+    return released_output_cnt ? *released_output_cnt : 0;
+}
+
+static bool test_gpio_chardev_select_backend(void)
+{
+    return gpio_select_backend(5) == -1
+        && gpio_select_backend(GPIO_BACKEND_CHARDEV) == 0
+        && gpio_get_backend() == GPIO_BACKEND_CHARDEV;
+}
+
+static bool test_gpio_chardev_uninitialised_gpio(void)
+{
+    uint8_t value;
+    return gpio_get_value(MIKROBUS_1_INT, &value) == -1
+        && gpio_set_direction(MIKROBUS_1_INT, GPIO_OUTPUT) == -1;
+}
+
+static bool test_gpio_chardev_init(void)
+{
+    uint8_t direction;
+
+    if (gpio_init(MIKROBUS_1_INT) < 0
+    ||  gpio_init(MIKROBUS_1_INT) < 0)
+        return false;
+
+    if (gpio_get_direction(MIKROBUS_1_INT, &direction) < 0)
+        return false;
+
+    return direction == GPIO_INPUT;
+}
+
+static void callback(uint8_t event)
+{
+}
+
+static bool test_gpio_chardev_monitor(void)
+{
+    bool ret;
+
+    if (gpio_monitor_init() < 0)
+        return false;
+
+    ret = gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_EDGE, callback) == -1
+       && gpio_counter_start(MIKROBUS_1_INT, GPIO_EDGE) == -1;
+
+    return gpio_monitor_release() == 0 && ret;
+}
+
+static bool test_gpio_chardev_set_value_invalid_direction(void)
+{
+    return gpio_set_value(MIKROBUS_1_INT, 1) == -1;
+}
+
+static bool test_gpio_chardev_output(void)
+{
+    uint8_t direction, value;
+
+    if (gpio_set_direction(MIKROBUS_1_INT, GPIO_OUTPUT) < 0
+    ||  gpio_get_direction(MIKROBUS_1_INT, &direction) < 0
+    ||  direction != GPIO_OUTPUT)
+        return false;
+
+    if (gpio_set_value(MIKROBUS_1_INT, 1) < 0
+    ||  gpio_get_value(MIKROBUS_1_INT, &value) < 0
+    ||  value != 1)
+        return false;
+
+    if (gpio_set_value(MIKROBUS_1_INT, 0) < 0
+    ||  gpio_get_value(MIKROBUS_1_INT, &value) < 0
+    ||  value != 0)
+        return false;
+
+    return gpio_set_value(MIKROBUS_1_INT, 1) == 0;
+}
+
+/* MIKROBUS_1_AN and MIKROBUS_1_INT belong to the same gpiochip */
+static bool test_gpio_chardev_output_kept_on_new_request(void)
+{
+    unsigned int cnt = get_released_output_cnt();
+    uint8_t direction, value;
+
+    if (gpio_init(MIKROBUS_1_AN) < 0
+    ||  get_released_output_cnt() != cnt)
+        return false;
+
+    if (gpio_get_direction(MIKROBUS_1_AN, &direction) < 0
+    ||  direction != GPIO_INPUT)
+        return false;
+
+    if (gpio_get_direction(MIKROBUS_1_INT, &direction) < 0
+    ||  direction != GPIO_OUTPUT)
+        return false;
+
+    if (gpio_get_value(MIKROBUS_1_INT, &value) < 0)
+        return false;
+
+    return value == 1;
+}
+
+static bool test_gpio_chardev_uninitialised_gpio_values(void)
+{
+    uint32_t values;
+    return gpio_get_values(MIKROBUS_1_MASK, &values) == -1
+        && gpio_set_values(MIKROBUS_1_PWM_MASK, 0) == -1;
+}
+
+/* MIKROBUS_1_PWM belongs to another gpiochip than MIKROBUS_1_AN and MIKROBUS_1_INT */
+static bool test_gpio_chardev_values(void)
+{
+    uint32_t mask = MIKROBUS_1_AN_MASK | MIKROBUS_1_PWM_MASK;
+    uint32_t values;
+
+    if (gpio_init(MIKROBUS_1_PWM) < 0
+    ||  gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT) < 0)
+        return false;
+
+    /* MIKROBUS_1_AN is an input */
+    if (gpio_set_values(mask, mask) != -1
+    ||  gpio_set_direction(MIKROBUS_1_AN, GPIO_OUTPUT) < 0)
+        return false;
+
+    if (gpio_set_values(mask, mask) < 0
+    ||  gpio_get_values(MIKROBUS_1_MASK & ~MIKROBUS_1_RST_MASK, &values) < 0
+    ||  values != (mask | MIKROBUS_1_INT_MASK))
+        return false;
+
+    if (gpio_set_values(mask, MIKROBUS_1_PWM_MASK) < 0
+    ||  gpio_get_values(MIKROBUS_1_MASK & ~MIKROBUS_1_RST_MASK, &values) < 0
+    ||  values != (MIKROBUS_1_PWM_MASK | MIKROBUS_1_INT_MASK))
+        return false;
+
+    return gpio_get_values(ALL_GPIO_MASK + 1, &values) == -1
+        && gpio_release(MIKROBUS_1_PWM) == 0;
+}
+
+static bool test_gpio_chardev_snapshot(void)
+{
+    struct gpio_snapshot snapshot;
+
+    if (gpio_snapshot(NULL) != -1
+    ||  gpio_snapshot(&snapshot) < 0)
+        return false;
+
+    return snapshot.initialised == (MIKROBUS_1_AN_MASK | MIKROBUS_1_INT_MASK)
+        && snapshot.outputs == (MIKROBUS_1_AN_MASK | MIKROBUS_1_INT_MASK)
+        && snapshot.values == MIKROBUS_1_INT_MASK
+        && snapshot.timestamp != 0;
+}
+
+static bool test_gpio_chardev_acquire(void)
+{
+    uint8_t direction, value;
+
+    if (gpio_acquire(MIKROBUS_2_PWM, GPIO_OUTPUT) < 0
+    ||  gpio_acquire(MIKROBUS_2_PWM, GPIO_OUTPUT) < 0
+    ||  gpio_acquire(MIKROBUS_2_PWM, GPIO_INPUT) != -1
+    ||  gpio_release(MIKROBUS_2_PWM) != -1)
+        return false;
+
+    if (gpio_relinquish(MIKROBUS_2_PWM) < 0
+    ||  gpio_get_direction(MIKROBUS_2_PWM, &direction) < 0
+    ||  direction != GPIO_OUTPUT)
+        return false;
+
+    return gpio_relinquish(MIKROBUS_2_PWM) == 0
+        && gpio_get_value(MIKROBUS_2_PWM, &value) == -1
+        && gpio_relinquish(MIKROBUS_2_PWM) == -1;
+}
+
+/*
+ * MIKROBUS_1_PWM and MIKROBUS_2_PWM belong to the same gpiochip, and are
+ * initialised before being configured as outputs.
+ */
+static bool test_gpio_chardev_release_keeps_outputs(void)
+{
+    unsigned int cnt;
+    uint8_t direction, value;
+
+    if (gpio_init(MIKROBUS_1_PWM) < 0
+    ||  gpio_init(MIKROBUS_2_PWM) < 0
+    ||  gpio_set_direction(MIKROBUS_1_PWM, GPIO_OUTPUT) < 0
+    ||  gpio_set_direction(MIKROBUS_2_PWM, GPIO_OUTPUT) < 0
+    ||  gpio_set_values(MIKROBUS_1_PWM_MASK | MIKROBUS_2_PWM_MASK,
+                        MIKROBUS_1_PWM_MASK | MIKROBUS_2_PWM_MASK) < 0)
+        return false;
+
+    cnt = get_released_output_cnt();
+    if (gpio_release(MIKROBUS_1_PWM) < 0
+    ||  gpio_get_value(MIKROBUS_2_PWM, &value) < 0
+    ||  value != 1
+    ||  get_released_output_cnt() != cnt)
+        return false;
+
+    if (gpio_init(MIKROBUS_1_PWM) < 0
+    ||  gpio_get_direction(MIKROBUS_1_PWM, &direction) < 0
+    ||  direction != GPIO_INPUT)
+        return false;
+
+    /* Only MIKROBUS_2_PWM is released */
+    if (gpio_release(MIKROBUS_2_PWM) < 0
+    ||  gpio_get_value(MIKROBUS_1_PWM, &value) < 0
+    ||  (released_output_cnt != NULL && get_released_output_cnt() != cnt + 1))
+        return false;
+
+    return gpio_release(MIKROBUS_1_PWM) == 0;
+}
+
+static bool test_gpio_chardev_select_backend_while_initialised(void)
+{
+    return gpio_select_backend(GPIO_BACKEND_SYSFS) == -1;
+}
+
+static bool test_gpio_chardev_release(void)
+{
+    uint8_t value;
+
+    if (gpio_release(MIKROBUS_1_AN) < 0
+    ||  gpio_get_value(MIKROBUS_1_INT, &value) < 0
+    ||  value != 1)
+        return false;
+
+    return gpio_release(MIKROBUS_1_INT) == 0
+        && gpio_release(MIKROBUS_1_INT) == 0
+        && gpio_select_backend(GPIO_BACKEND_SYSFS) == 0;
+}
+
+int main(void)
+{
+    int ret = -1;
+
+    released_output_cnt = dlsym(RTLD_DEFAULT, "gpiochip_stub_released_output_cnt");
+
+    CREATE_TEST(gpio_chardev, 14)
+    ADD_TEST_CASE(gpio_chardev, select_backend);
+    ADD_TEST_CASE(gpio_chardev, uninitialised_gpio);
+    ADD_TEST_CASE(gpio_chardev, init);
+    ADD_TEST_CASE(gpio_chardev, monitor);
+    ADD_TEST_CASE(gpio_chardev, set_value_invalid_direction);
+    ADD_TEST_CASE(gpio_chardev, output);
+    ADD_TEST_CASE(gpio_chardev, output_kept_on_new_request);
+    ADD_TEST_CASE(gpio_chardev, uninitialised_gpio_values);
+    ADD_TEST_CASE(gpio_chardev, values);
+    ADD_TEST_CASE(gpio_chardev, snapshot);
+    ADD_TEST_CASE(gpio_chardev, acquire);
+    ADD_TEST_CASE(gpio_chardev, release_keeps_outputs);
+    ADD_TEST_CASE(gpio_chardev, select_backend_while_initialised);
+    ADD_TEST_CASE(gpio_chardev, release);
+
+    ret = run_test(test_gpio_chardev);
+    free(test_gpio_chardev.cases);
+
+    return ret;
+}
@@ -5,22 +5,127 @@
  * @copyright 3-clause BSD
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "common.h"
 #include "letmecreate/core/gpio.h"
 #include "letmecreate/core/gpio_monitor.h"
 
+#define STABLE_TIME     (200)       /* in ms */
+#define COUNTED_EDGE_CNT    (5)
+#define WORKER_CNT          (2)
+#define ORDERED_EDGE_CNT    (10)
+
 static int callback_ID;
 static uint8_t gpio_event;
 
+static int self_removing_callback_ID;
+static volatile int self_removing_ret;
+static volatile unsigned int self_removing_call_cnt;
+
+static uint8_t ordered_events[64];
+static pthread_t ordered_threads[64];
+static volatile unsigned int ordered_event_cnt;
+
+static volatile uint8_t debounced_event;
+static volatile unsigned int debounced_call_cnt;
+static volatile uint64_t debounced_call_time;
+
+static uint64_t get_timestamp(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
 static void callback(uint8_t event_type)
 {
     gpio_event = event_type;
 }
 
+static void self_removing_callback(uint8_t event_type)
+{
+    ++self_removing_call_cnt;
+    self_removing_ret = gpio_monitor_remove_callback(self_removing_callback_ID);
+}
+
+/* Slow callback, so that edges are queued to the worker while it runs */
+static void ordered_callback(uint8_t event_type)
+{
+    unsigned int i = ordered_event_cnt;
+
+    if (i < 64) {
+        ordered_events[i] = event_type;
+        ordered_threads[i] = pthread_self();
+        ordered_event_cnt = i + 1;
+    }
+    usleep(50000);
+}
+
+/* Wait until callback is called with an event */
+static bool wait_for_event(uint8_t event_type)
+{
+    unsigned int timeout = 30;
+
+    while (gpio_event != event_type && timeout > 0) {
+        sleep(1);
+        --timeout;
+    }
+
+    if (timeout == 0) {
+        printf("Timeout.\n");
+        return false;
+    }
+
+    return true;
+}
+
+static void debounced_callback(uint8_t event_type)
+{
+    debounced_call_time = get_timestamp();
+    debounced_event = event_type;
+    ++debounced_call_cnt;
+}
+
+/* Return true if the debounced callback was called once, at least STABLE_TIME after the last edge */
+static bool check_debounced_call(uint8_t event_type)
+{
+    struct gpio_event events[256];
+    unsigned int timeout = 30;
+    uint64_t last_edge = 0;
+    int i, event_cnt;
+
+    while (debounced_event != event_type && timeout > 0) {
+        sleep(1);
+        --timeout;
+    }
+
+    if (timeout == 0) {
+        printf("Timeout.\n");
+        return false;
+    }
+
+    /* Bounces after the call would trigger a second call */
+    sleep(2);
+    if (debounced_call_cnt != 1)
+        return false;
+
+    if ((event_cnt = gpio_monitor_read_events(events, 256)) < 1)
+        return false;
+
+    for (i = 0; i < event_cnt; ++i) {
+        if (events[i].timestamp <= debounced_call_time)
+            last_edge = events[i].timestamp;
+    }
+
+    return debounced_call_time - last_edge >= STABLE_TIME * 1000000ULL;
+}
+
 static bool test_gpio_monitor_add_callback_before_init(void)
 {
     return gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_EDGE, callback) == -1;
@@ -71,6 +176,67 @@ static bool test_gpio_monitor_add_callback(void)
     return true;
 }
 
+static bool test_gpio_monitor_read_events(void)
+{
+    struct gpio_event events[256];
+    struct gpio_monitor_stats stats;
+    uint32_t overflow_cnt, inferred_cnt = 0;
+    int i, event_cnt;
+    bool falling = false;
+
+    if (gpio_monitor_read_events(NULL, 1) != -1
+    ||  gpio_monitor_get_stats(NULL) != -1)
+        return false;
+
+    if (gpio_monitor_get_overflow_count(&overflow_cnt) < 0
+    ||  gpio_monitor_get_stats(&stats) < 0)
+        return false;
+
+    /* Edges of previous test: at least one falling edge followed by a raising edge */
+    if ((event_cnt = gpio_monitor_read_events(events, 256)) < 2)
+        return false;
+
+    /* No edge was dropped, but bounces may have been merged and inferred */
+    if (overflow_cnt != 0 || stats.ring_drop_cnt != 0 || stats.queue_drop_cnt != 0)
+        return false;
+
+    for (i = 0; i < event_cnt; ++i) {
+        if (events[i].gpio_pin != MIKROBUS_1_INT)
+            return false;
+        if (i > 0 && events[i].timestamp < events[i-1].timestamp)
+            return false;
+        if (events[i].type == GPIO_FALLING)
+            falling = true;
+        if (events[i].inferred)
+            ++inferred_cnt;
+    }
+
+    return falling
+        && inferred_cnt == stats.inferred_cnt
+        && events[event_cnt-1].type == GPIO_RAISING
+        && gpio_monitor_read_events(events, 256) == 0;
+}
+
+static bool test_gpio_monitor_get_dispatch_latency(void)
+{
+    struct gpio_monitor_latency report;
+
+    if (gpio_monitor_get_dispatch_latency(NULL) != -1)
+        return false;
+
+    /* Callback was called at least twice during previous tests */
+    if (gpio_monitor_get_dispatch_latency(&report) < 0
+    ||  report.count < 2
+    ||  report.min > report.avg
+    ||  report.avg > report.max
+    ||  report.p99 > report.max)
+        return false;
+
+    return gpio_monitor_reset_dispatch_latency() == 0
+        && gpio_monitor_get_dispatch_latency(&report) == 0
+        && report.count == 0;
+}
+
 static bool test_gpio_monitor_remove_callback_invalid_id(void)
 {
     return gpio_monitor_remove_callback(callback_ID+1) == -1;
@@ -87,24 +253,234 @@ static bool test_gpio_monitor_remove_twice_callback(void)
     return gpio_monitor_remove_callback(callback_ID) == -1;
 }
 
+static bool test_gpio_monitor_add_debounced_callback_invalid(void)
+{
+    return gpio_monitor_add_debounced_callback(MIKROBUS_1_INT, 0, 0, STABLE_TIME, debounced_callback) == -1
+        && gpio_monitor_add_debounced_callback(MIKROBUS_1_INT, GPIO_EDGE, 0, STABLE_TIME, NULL) == -1;
+}
+
+static bool test_gpio_monitor_debounced_callback(void)
+{
+    int ID;
+
+    if ((ID = gpio_monitor_add_debounced_callback(MIKROBUS_1_INT, GPIO_EDGE, 0, STABLE_TIME,
+                                                  debounced_callback)) < 0)
+        return false;
+
+    printf("Connect Mikrobus 1 INT gpio to GND, touching it several times before leaving it connected.\n");
+    debounced_event = 0;
+    debounced_call_cnt = 0;
+    if (!check_debounced_call(GPIO_FALLING)) {
+        gpio_monitor_remove_callback(ID);
+        return false;
+    }
+
+    printf("Connect Mikrobus 1 INT gpio to 3V3, touching it several times before leaving it connected.\n");
+    debounced_event = 0;
+    debounced_call_cnt = 0;
+    if (!check_debounced_call(GPIO_RAISING)) {
+        gpio_monitor_remove_callback(ID);
+        return false;
+    }
+
+    return gpio_monitor_remove_callback(ID) == 0;
+}
+
+static bool test_gpio_monitor_counter_invalid(void)
+{
+    uint64_t count, period;
+    float frequency;
+
+    return gpio_counter_start(MIKROBUS_1_INT, 0) == -1
+        && gpio_counter_read(MIKROBUS_1_INT, &count, &period) == -1
+        && gpio_counter_get_frequency(MIKROBUS_1_INT, &frequency) == -1
+        && gpio_counter_stop(MIKROBUS_1_INT) == -1;
+}
+
+static bool test_gpio_monitor_counter(void)
+{
+    struct gpio_event events[256];
+    uint64_t count = 0, period = 0;
+    uint64_t falling_cnt = 0;
+    unsigned int timeout = 30;
+    float frequency;
+    int i, event_cnt;
+
+    if (gpio_counter_start(MIKROBUS_1_INT, GPIO_FALLING) < 0)
+        return false;
+
+    if (gpio_counter_start(MIKROBUS_1_INT, GPIO_FALLING) != -1
+    ||  gpio_counter_read(MIKROBUS_1_INT, NULL, &period) != -1
+    ||  gpio_counter_read(MIKROBUS_1_INT, &count, NULL) != -1
+    ||  gpio_counter_get_frequency(MIKROBUS_1_INT, NULL) != -1)
+        return false;
+
+    printf("Connect Mikrobus 1 INT gpio to GND then to 3V3 %d times, about once per second.\n",
+           COUNTED_EDGE_CNT);
+    while (count < COUNTED_EDGE_CNT && timeout > 0) {
+        sleep(1);
+        --timeout;
+        if (gpio_counter_read(MIKROBUS_1_INT, &count, &period) < 0)
+            return false;
+    }
+
+    if (timeout == 0) {
+        printf("Timeout.\n");
+        return false;
+    }
+
+    /* Counter must match falling edges recorded, and the period only grows once edges stop */
+    sleep(2);
+    if (gpio_counter_read(MIKROBUS_1_INT, &count, &period) < 0
+    ||  gpio_counter_get_frequency(MIKROBUS_1_INT, &frequency) < 0)
+        return false;
+
+    if ((event_cnt = gpio_monitor_read_events(events, 256)) < 0)
+        return false;
+    for (i = 0; i < event_cnt; ++i) {
+        if (events[i].type == GPIO_FALLING)
+            ++falling_cnt;
+    }
+
+    return count == falling_cnt
+        && period > 0
+        && frequency > 0.f
+        && frequency <= 1000000000.f / period;
+}
+
+static bool test_gpio_monitor_counter_stop(void)
+{
+    uint64_t count, period;
+
+    return gpio_counter_stop(MIKROBUS_1_INT) == 0
+        && gpio_counter_stop(MIKROBUS_1_INT) == -1
+        && gpio_counter_read(MIKROBUS_1_INT, &count, &period) == -1;
+}
+
+static bool test_gpio_monitor_remove_callback_from_callback(void)
+{
+    bool success = true;
+
+    if ((callback_ID = gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_EDGE, callback)) < 0)
+        return false;
+
+    self_removing_call_cnt = 0;
+    self_removing_ret = -1;
+    if ((self_removing_callback_ID = gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_FALLING,
+                                                               self_removing_callback)) < 0) {
+        gpio_monitor_remove_callback(callback_ID);
+        return false;
+    }
+
+    /* Other callback must still be called once the first one removed itself */
+    printf("Connect Mikrobus 1 INT gpio to GND.\n");
+    gpio_event = 0;
+    if (!wait_for_event(GPIO_FALLING))
+        success = false;
+
+    printf("Connect Mikrobus 1 INT gpio to 3V3.\n");
+    gpio_event = 0;
+    if (success && !wait_for_event(GPIO_RAISING))
+        success = false;
+
+    printf("Connect Mikrobus 1 INT gpio to GND.\n");
+    gpio_event = 0;
+    if (success && !wait_for_event(GPIO_FALLING))
+        success = false;
+
+    if (gpio_monitor_remove_callback(callback_ID) < 0)
+        return false;
+
+    return success
+        && self_removing_call_cnt == 1
+        && self_removing_ret == 0
+        && gpio_monitor_remove_callback(self_removing_callback_ID) == -1;
+}
+
 static bool test_gpio_monitor_release(void)
 {
     return gpio_monitor_release() == 0
         && gpio_monitor_release() == 0;
 }
 
+static bool test_gpio_monitor_set_worker_count(void)
+{
+    return gpio_monitor_set_worker_count(9) == -1
+        && gpio_monitor_set_worker_count(WORKER_CNT) == 0
+        && gpio_monitor_init() == 0
+        && gpio_monitor_set_worker_count(1) == -1;
+}
+
+static bool test_gpio_monitor_worker_ordering(void)
+{
+    struct gpio_event events[256];
+    unsigned int i, timeout = 30;
+    int ID, event_cnt;
+
+    ordered_event_cnt = 0;
+    if ((ID = gpio_monitor_add_callback(MIKROBUS_1_INT, GPIO_EDGE, ordered_callback)) < 0)
+        return false;
+
+    printf("Connect Mikrobus 1 INT gpio to GND then to 3V3 %d times, as fast as possible.\n",
+           ORDERED_EDGE_CNT / 2);
+    while (ordered_event_cnt < ORDERED_EDGE_CNT && timeout > 0) {
+        sleep(1);
+        --timeout;
+    }
+
+    /* Let the worker empty its queue */
+    sleep(2);
+    if (gpio_monitor_remove_callback(ID) < 0)
+        return false;
+
+    if (timeout == 0) {
+        printf("Timeout.\n");
+        return false;
+    }
+
+    /* Callback must see every edge recorded, in the same order, from a single worker */
+    if ((event_cnt = gpio_monitor_read_events(events, 256)) != ordered_event_cnt)
+        return false;
+
+    for (i = 0; i < ordered_event_cnt; ++i) {
+        if (events[i].type != ordered_events[i]
+        ||  !pthread_equal(ordered_threads[i], ordered_threads[0])
+        ||  pthread_equal(ordered_threads[i], pthread_self()))
+            return false;
+    }
+
+    return true;
+}
+
+static bool test_gpio_monitor_release_workers(void)
+{
+    return gpio_monitor_release() == 0
+        && gpio_monitor_set_worker_count(0) == 0;
+}
+
 int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(gpio_monitor, 7)
+    CREATE_TEST(gpio_monitor, 18)
     ADD_TEST_CASE(gpio_monitor, add_callback_before_init);
     ADD_TEST_CASE(gpio_monitor, init);
     ADD_TEST_CASE(gpio_monitor, add_callback);
+    ADD_TEST_CASE(gpio_monitor, read_events);
+    ADD_TEST_CASE(gpio_monitor, get_dispatch_latency);
     ADD_TEST_CASE(gpio_monitor, remove_callback_invalid_id);
     ADD_TEST_CASE(gpio_monitor, remove_callback);
     ADD_TEST_CASE(gpio_monitor, remove_twice_callback);
+    ADD_TEST_CASE(gpio_monitor, add_debounced_callback_invalid);
+    ADD_TEST_CASE(gpio_monitor, debounced_callback);
+    ADD_TEST_CASE(gpio_monitor, counter_invalid);
+    ADD_TEST_CASE(gpio_monitor, counter);
+    ADD_TEST_CASE(gpio_monitor, counter_stop);
+    ADD_TEST_CASE(gpio_monitor, remove_callback_from_callback);
     ADD_TEST_CASE(gpio_monitor, release);
+    ADD_TEST_CASE(gpio_monitor, set_worker_count);
+    ADD_TEST_CASE(gpio_monitor, worker_ordering);
+    ADD_TEST_CASE(gpio_monitor, release_workers);
 
     ret = run_test(test_gpio_monitor);
     free(test_gpio_monitor.cases);
@@ -5,10 +5,13 @@
  * @copyright 3-clause BSD
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "common.h"
+#include "letmecreate/click/common.h"
+#include "letmecreate/click/proximity.h"
 #include "letmecreate/core/common.h"
 #include "letmecreate/core/i2c.h"
 
@@ -16,6 +19,8 @@
 #define VCNL4010_PRODUCT_ID_REG     (0x81)
 #define VCNL4010_PRODUCT_ID         (0x02)
 
+#define PARALLEL_READ_CNT           (1000)
+
 static bool test_i2c_write_before_init(void)
 {
     uint8_t buffer = 0;
@@ -30,6 +35,14 @@ static bool test_i2c_read_before_init(void)
         && i2c_read_byte(0x12, &buffer) == -1;
 }
 
+static bool test_i2c_transfer_before_init(void)
+{
+    uint8_t buffer = 0;
+    struct i2c_message message = { 0x12, 1, &buffer, 1, 0 };
+
+    return i2c_transfer(MIKROBUS_1, &message, 1) == -1;
+}
+
 static bool test_i2c_init(void)
 {
     if (i2c_init() < 0)
@@ -71,6 +84,61 @@ static bool test_i2c_read_zero_byte(void)
     return i2c_read(0x12, &buffer, 0) == 0;
 }
 
+static bool test_i2c_transfer_invalid(void)
+{
+    struct i2c_message messages[43];
+    uint8_t buffer = 0;
+
+    memset(messages, 0, sizeof(messages));
+    messages[0].slave_address = 0x12;
+    messages[0].read = 1;
+    messages[0].buffer = NULL;
+    messages[0].count = 1;
+
+    if (i2c_transfer(2, messages, 1) != -1
+    ||  i2c_transfer(MIKROBUS_1, NULL, 1) != -1
+    ||  i2c_transfer(MIKROBUS_1, messages, 1) != -1
+    ||  i2c_transfer(MIKROBUS_1, messages, 43) != -1
+    ||  i2c_transfer(MIKROBUS_1, messages, 0) != 0)
+        return false;
+
+    messages[0].buffer = &buffer;
+    messages[0].count = UINT16_MAX + 1;
+    if (i2c_transfer(MIKROBUS_1, messages, 1) != -1)
+        return false;
+
+    /* 10-bit addresses must be flagged */
+    messages[0].count = 1;
+    messages[0].slave_address = 0x80;
+    if (i2c_transfer(MIKROBUS_1, messages, 1) != -1)
+        return false;
+
+    messages[0].slave_address = 0x400;
+    messages[0].ten_bit_address = 1;
+    return i2c_transfer(MIKROBUS_1, messages, 1) == -1;
+}
+
+static bool test_i2c_device_invalid(void)
+{
+    uint8_t buffer = 0;
+    struct i2c_device device = { 2, 0x12 };
+
+    uint16_t value = 0;
+
+    return i2c_device_write(NULL, &buffer, 1) == -1
+        && i2c_device_read(NULL, &buffer, 1) == -1
+        && i2c_device_write(&device, &buffer, 1) == -1
+        && i2c_device_read(&device, &buffer, 1) == -1
+        && i2c_device_write_register(NULL, 0, 0) == -1
+        && i2c_device_read_register(NULL, 0, &buffer) == -1
+        && i2c_device_read_registers(NULL, 0, &buffer, 1) == -1
+        && i2c_device_read_16b_register(NULL, 0, 1, &value) == -1
+        && i2c_device_read_16b_register_burst(NULL, 0, 1, &value) == -1
+        && i2c_device_read_16b_register_burst(&device, 0, 2, &value) == -1
+        && i2c_device_read_register(&device, 0, &buffer) == -1
+        && proximity_click_bus_enable(2) == -1;
+}
+
 static bool read_proximity_product_id(uint8_t mikrobus_index)
 {
     int ret = -1;
@@ -96,6 +164,36 @@ static bool read_proximity_product_id(uint8_t mikrobus_index)
     if (i2c_read_byte(VCNL4010_ADDRESS, &product_ID) < 0)
         return false;
 
+    if ((product_ID >> 4) != VCNL4010_PRODUCT_ID)
+        return false;
+
+    /* Same register, read in one transaction with a repeated start */
+    {
+        uint8_t reg_address = VCNL4010_PRODUCT_ID_REG;
+        struct i2c_message messages[2] = {
+            { VCNL4010_ADDRESS, 0, &reg_address, 1, 0 },
+            { VCNL4010_ADDRESS, 1, &product_ID, 1, 0 }
+        };
+
+        product_ID = 0;
+        if (i2c_transfer(mikrobus_index, messages, 2) < 0)
+            return false;
+    }
+
+    if ((product_ID >> 4) != VCNL4010_PRODUCT_ID)
+        return false;
+
+    /* Same register, read using a device instead of the current bus */
+    {
+        uint8_t reg_address = VCNL4010_PRODUCT_ID_REG;
+        struct i2c_device device = { mikrobus_index, VCNL4010_ADDRESS };
+
+        product_ID = 0;
+        if (i2c_device_write(&device, &reg_address, 1) < 0
+        ||  i2c_device_read(&device, &product_ID, 1) < 0)
+            return false;
+    }
+
     return (product_ID >> 4) == VCNL4010_PRODUCT_ID;
 }
 
@@ -109,6 +207,83 @@ static bool test_i2c_read_id_mikrobus_2(void)
     return read_proximity_product_id(MIKROBUS_2);
 }
 
+/*
+ * Read the product ID and some measures from a Proximity Click, using only
+ * functions taking a bus. Run in one thread for each mikrobus.
+ */
+static void *read_proximity_in_parallel(void *arg)
+{
+    uint8_t mikrobus_index = *(uint8_t *)arg;
+    struct i2c_device device = { mikrobus_index, VCNL4010_ADDRESS };
+    uint8_t product_ID = 0;
+    uint16_t measure = 0;
+    bool *success = malloc(sizeof(bool));
+    unsigned int i;
+
+    if (success == NULL)
+        return NULL;
+    *success = false;
+
+    for (i = 0; i < PARALLEL_READ_CNT; ++i) {
+        product_ID = 0;
+        if (i2c_device_read_register(&device, VCNL4010_PRODUCT_ID_REG, &product_ID) < 0
+        ||  (product_ID >> 4) != VCNL4010_PRODUCT_ID)
+            return success;
+    }
+
+    if (proximity_click_bus_enable(mikrobus_index) < 0)
+        return success;
+
+    for (i = 0; i < 10; ++i) {
+        if (proximity_click_bus_get_measure(mikrobus_index, &measure) < 0) {
+            proximity_click_bus_disable(mikrobus_index);
+            return success;
+        }
+    }
+
+    *success = proximity_click_bus_disable(mikrobus_index) == 0;
+
+    return success;
+}
+
+static bool test_i2c_read_id_both_mikrobus(void)
+{
+    uint8_t mikrobus_indexes[] = { MIKROBUS_1, MIKROBUS_2 };
+    pthread_t threads[2];
+    bool success = true;
+    unsigned int i;
+    int ret;
+
+    ret = ask_question("Do you have two Proximity Clicks ?", 15);
+    if (ret < 0)
+        return false;
+    else if (ret == 2)
+        return true;
+
+    printf("Insert one Proximity Click in each mikrobus\n");
+    if (wait_for_switch(10) < 0)
+        return false;
+
+    for (i = 0; i < 2; ++i) {
+        if (pthread_create(&threads[i], NULL, read_proximity_in_parallel, &mikrobus_indexes[i]) != 0) {
+            if (i == 1)
+                pthread_join(threads[0], NULL);
+            return false;
+        }
+    }
+
+    for (i = 0; i < 2; ++i) {
+        bool *thread_success = NULL;
+
+        pthread_join(threads[i], (void **)&thread_success);
+        if (thread_success == NULL || !*thread_success)
+            success = false;
+        free(thread_success);
+    }
+
+    return success;
+}
+
 static bool test_i2c_release(void)
 {
     return i2c_release() == 0
@@ -119,17 +294,21 @@ int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(i2c, 11)
+    CREATE_TEST(i2c, 15)
     ADD_TEST_CASE(i2c, write_before_init);
     ADD_TEST_CASE(i2c, read_before_init);
+    ADD_TEST_CASE(i2c, transfer_before_init);
     ADD_TEST_CASE(i2c, init);
     ADD_TEST_CASE(i2c, select_invalid_bus);
     ADD_TEST_CASE(i2c, write_null_buffer);
     ADD_TEST_CASE(i2c, read_null_buffer);
     ADD_TEST_CASE(i2c, write_zero_byte);
     ADD_TEST_CASE(i2c, read_zero_byte);
+    ADD_TEST_CASE(i2c, transfer_invalid);
+    ADD_TEST_CASE(i2c, device_invalid);
     ADD_TEST_CASE(i2c, read_id_mikrobus_1);
     ADD_TEST_CASE(i2c, read_id_mikrobus_2);
+    ADD_TEST_CASE(i2c, read_id_both_mikrobus);
     ADD_TEST_CASE(i2c, release);
 
     ret = run_test(test_i2c);
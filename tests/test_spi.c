@@ -33,7 +33,8 @@ static bool test_spi_transfer_before_init(void)
 {
     uint8_t tx_buffer = 0, rx_buffer = 0;
 
-    return spi_transfer(&tx_buffer, &rx_buffer, 1) == -1;
+    return spi_transfer(&tx_buffer, &rx_buffer, 1) == -1
+        && spi_bus_transfer(MIKROBUS_2, &tx_buffer, &rx_buffer, 1) == -1;
 }
 
 static bool test_spi_init(void)
@@ -57,6 +58,15 @@ static bool test_spi_transfer_null_buffers(void)
     return spi_transfer(NULL, NULL, 1) == -1;
 }
 
+static bool test_spi_invalid_bus(void)
+{
+    uint8_t tx_buffer = 0, rx_buffer = 0;
+
+    return spi_set_mode(2, SPI_MODE_0) == -1
+        && spi_set_speed(2, SPI_1M36) == -1
+        && spi_bus_transfer(2, &tx_buffer, &rx_buffer, 1) == -1;
+}
+
 static bool read_accel_product_id(uint8_t mikrobus_index)
 {
     int ret = -1;
@@ -82,6 +92,14 @@ static bool read_accel_product_id(uint8_t mikrobus_index)
     if (spi_transfer(tx_buffer, rx_buffer, 2) < 0)
         return false;
 
+    if (rx_buffer[1] != ADXL345_DEVICE_ID)
+        return false;
+
+    /* Same register, read without using the current bus */
+    rx_buffer[1] = 0;
+    if (spi_bus_transfer(mikrobus_index, tx_buffer, rx_buffer, 2) < 0)
+        return false;
+
     return rx_buffer[1] == ADXL345_DEVICE_ID;
 }
 
@@ -105,13 +123,14 @@ int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(spi, 9);
+    CREATE_TEST(spi, 10);
     ADD_TEST_CASE(spi, set_mode_before_init);
     ADD_TEST_CASE(spi, set_speed_before_init);
     ADD_TEST_CASE(spi, transfer_before_init);
     ADD_TEST_CASE(spi, init);
     ADD_TEST_CASE(spi, transfer_zero_byte);
     ADD_TEST_CASE(spi, transfer_null_buffers);
+    ADD_TEST_CASE(spi, invalid_bus);
     ADD_TEST_CASE(spi, read_id_mikrobus_1);
     ADD_TEST_CASE(spi, read_id_mikrobus_2);
     ADD_TEST_CASE(spi, release);
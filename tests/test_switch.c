@@ -13,6 +13,11 @@
 #include "letmecreate/core/switch.h"
 
 static volatile uint8_t switch_status = 0;
+static volatile uint64_t press_timestamp = 0;
+static volatile uint64_t release_timestamp = 0;
+static volatile uint8_t gesture_status = 0;
+static volatile int self_removing_id = -1;
+static volatile int self_removal_status = 1;
 
 static void sleep_50ms(void)
 {
@@ -46,6 +51,37 @@ static void switch_2_released(void)
     switch_status = SWITCH_2_RELEASED;
 }
 
+static void switch_1_timestamped(uint8_t event, uint64_t timestamp)
+{
+    if (event == SWITCH_1_PRESSED)
+        press_timestamp = timestamp;
+    else if (event == SWITCH_1_RELEASED)
+        release_timestamp = timestamp;
+}
+
+static void switch_gesture(uint8_t switch_index, uint8_t gesture, uint32_t count)
+{
+    if (switch_index == SWITCH_1)
+        gesture_status = gesture;
+}
+
+static void switch_1_pressed_once(void)
+{
+    self_removal_status = switch_remove_callback(self_removing_id);
+}
+
+static bool test_switch_get_state(void)
+{
+    uint8_t mask = 0xFF;
+
+    printf("Do not press any switch.\n");
+
+    return switch_get_state(NULL) == -1
+        && switch_get_state(&mask) == 0
+        && mask == 0
+        && switch_release() == 0;
+}
+
 static bool test_switch_add_callback_before_init(void)
 {
     return switch_add_callback(0xF, switch_1_pressed) == -1;
@@ -129,6 +165,104 @@ static bool test_switch_add_remove_callback(void)
     return true;
 }
 
+static bool test_switch_timestamped_callback(void)
+{
+    unsigned int timeout = 10000; /* 10 000ms */
+    int id;
+
+    if (switch_add_timestamped_callback(0xF, NULL) != -1)
+        return false;
+
+    if ((id = switch_add_timestamped_callback(SWITCH_1_PRESSED | SWITCH_1_RELEASED, switch_1_timestamped)) < 0)
+        return false;
+
+    press_timestamp = 0;
+    release_timestamp = 0;
+    printf("Press and release switch 1\n");
+    while (release_timestamp == 0 && timeout > 0) {
+        sleep_50ms();
+        timeout -= 50;
+    }
+    if (timeout == 0) {
+        printf("Timeout\n");
+        return false;
+    }
+
+    return press_timestamp != 0
+        && press_timestamp < release_timestamp
+        && switch_remove_callback(id) == 0;
+}
+
+static bool test_switch_gesture_callback(void)
+{
+    uint8_t gesture = 0;
+
+    if (switch_add_gesture_callback(2, SWITCH_CLICK, switch_gesture) != -1
+    ||  switch_add_gesture_callback(SWITCH_1, 0, switch_gesture) != -1
+    ||  switch_add_gesture_callback(SWITCH_1, SWITCH_CLICK, NULL) != -1
+    ||  switch_set_gesture_timing(0, 800, 500, 100) != -1
+    ||  switch_set_gesture_timing(300, 800, 500, 100) != 0)
+        return false;
+
+    for (gesture = SWITCH_DOUBLE_CLICK; gesture <= SWITCH_LONG_PRESS; gesture <<= 1) {
+        unsigned int timeout = 10000; /* 10 000ms */
+        int id;
+
+        if ((id = switch_add_gesture_callback(SWITCH_1, gesture, switch_gesture)) < 0)
+            return false;
+
+        gesture_status = 0;
+        switch (gesture) {
+        case SWITCH_DOUBLE_CLICK:
+            printf("Double click switch 1\n");
+            break;
+        case SWITCH_MULTI_CLICK:
+            printf("Click switch 1 three times\n");
+            break;
+        case SWITCH_LONG_PRESS:
+            printf("Hold switch 1 for one second\n");
+            break;
+        }
+
+        while (gesture_status == 0 && timeout > 0) {
+            sleep_50ms();
+            timeout -= 50;
+        }
+        if (timeout == 0) {
+            printf("Timeout\n");
+            return false;
+        }
+
+        if (gesture_status != gesture
+        ||  switch_remove_callback(id) < 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool test_switch_callback_removes_itself(void)
+{
+    unsigned int timeout = 10000; /* 10 000ms */
+
+    self_removal_status = 1;
+    if ((self_removing_id = switch_add_callback(SWITCH_1_PRESSED, switch_1_pressed_once)) < 0)
+        return false;
+
+    printf("Press switch 1\n");
+    while (self_removal_status == 1 && timeout > 0) {
+        sleep_50ms();
+        timeout -= 50;
+    }
+    if (timeout == 0) {
+        printf("Timeout\n");
+        return false;
+    }
+
+    return self_removal_status == 0
+        && switch_remove_callback(self_removing_id) == -1;
+}
+
 static bool test_switch_release(void)
 {
     return switch_release() == 0
@@ -139,13 +273,17 @@ int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(switch, 9)
+    CREATE_TEST(switch, 13)
+    ADD_TEST_CASE(switch, get_state);
     ADD_TEST_CASE(switch, add_callback_before_init);
     ADD_TEST_CASE(switch, init);
     ADD_TEST_CASE(switch, add_callback_invalid_mask);
     ADD_TEST_CASE(switch, add_callback_null_func);
     ADD_TEST_CASE(switch, remove_callback_invalid_id);
     ADD_TEST_CASE(switch, add_remove_callback);
+    ADD_TEST_CASE(switch, timestamped_callback);
+    ADD_TEST_CASE(switch, gesture_callback);
+    ADD_TEST_CASE(switch, callback_removes_itself);
     ADD_TEST_CASE(switch, release);
     ADD_TEST_CASE(switch, init);
     ADD_TEST_CASE(switch, release);
@@ -17,7 +17,9 @@ static bool test_uart_send_receive_without_init(void)
     uint8_t buffer = 0;
 
     return uart_send(&buffer, 1) == -1
-        && uart_receive(&buffer, 1) == -1;
+        && uart_receive(&buffer, 1) == -1
+        && uart_bus_send(MIKROBUS_2, &buffer, 1) == -1
+        && uart_bus_receive(MIKROBUS_2, &buffer, 1) == -1;
 }
 
 static bool test_uart_init(void)
@@ -64,6 +66,18 @@ static bool test_uart_set_invalid_baudrate(void)
         && uart_set_baudrate(115200) == -1;
 }
 
+static bool test_uart_invalid_bus(void)
+{
+    uint8_t buffer = 0;
+    uint32_t baudrate;
+
+    return uart_bus_send(2, &buffer, 1) == -1
+        && uart_bus_receive(2, &buffer, 1) == -1
+        && uart_bus_set_baudrate(2, UART_BD_9600) == -1
+        && uart_bus_get_baudrate(2, &baudrate) == -1
+        && uart_bus_set_receive_callback(2, NULL) == -1;
+}
+
 static bool test_uart_release(void)
 {
     return uart_release() == 0
@@ -147,6 +161,15 @@ static bool test_uart_send_receive(void)
         if (tx_buffer != rx_buffer)
             return false;
 
+        /* Same exchange without selecting devices */
+        rx_buffer = 0;
+        if (uart_bus_send(MIKROBUS_1, &tx_buffer, 1) < 0
+        ||  uart_bus_receive(MIKROBUS_2, &rx_buffer, 1) < 0)
+            return false;
+
+        if (tx_buffer != rx_buffer)
+            return false;
+
         if (uart_release() < 0)
             return false;
     }
@@ -158,7 +181,7 @@ int main(void)
 {
     int ret = -1;
 
-    CREATE_TEST(uart, 10)
+    CREATE_TEST(uart, 11)
     ADD_TEST_CASE(uart, send_receive_without_init);
     ADD_TEST_CASE(uart, init);
     ADD_TEST_CASE(uart, send_null_buffer);
@@ -166,6 +189,7 @@ int main(void)
     ADD_TEST_CASE(uart, receive_null_buffer);
     ADD_TEST_CASE(uart, receive_zero_byte);
     ADD_TEST_CASE(uart, set_invalid_baudrate);
+    ADD_TEST_CASE(uart, invalid_bus);
     ADD_TEST_CASE(uart, release);
     ADD_TEST_CASE(uart, select_invalid_bus);
     ADD_TEST_CASE(uart, send_receive);